@@ -0,0 +1,161 @@
+#include "SpudBulkEntities.h"
+#include "SpudPropertyUtil.h"
+#include "Misc/ScopeRWLock.h"
+
+FSpudBulkEntities::FSpudBulkEntities(FSpudBulkArchetypeMap& InArchetypes, FSpudClassMetadata& InMeta)
+	: Archetypes(InArchetypes), Meta(InMeta)
+{
+}
+
+FSpudBulkEntities::~FSpudBulkEntities()
+{
+	// Columns are usually filled by copying whole structs, padding included, so clear it now it's all there
+	for (const auto& Added : AddedColumns)
+	{
+		FSpudBulkArchetypeData* Archetype = Archetypes.Contents.Find(Added.Key);
+		const FSpudStructLayout* Layout = Meta.StructLayouts.Contents.Find(Added.Value);
+		if (!Archetype || !Layout)
+			continue;
+		for (auto&& Column : Archetype->Columns)
+		{
+			if (Column.LayoutHash == Added.Value && Column.Stride == Layout->Size)
+				Layout->ZeroPadding(Column.Data.GetData(), Archetype->NumEntities);
+		}
+	}
+}
+
+FSpudBulkArchetypeData& FSpudBulkEntities::AddArchetype(const FString& Name, int32 NumEntities)
+{
+	auto& Archetype = Archetypes.Contents.FindOrAdd(Name);
+	Archetype.Name = Name;
+	Archetype.NumEntities = FMath::Max(NumEntities, 0);
+	Archetype.Columns.Reset();
+	return Archetype;
+}
+
+uint8* FSpudBulkEntities::AddColumn(FSpudBulkArchetypeData& Archetype, const UScriptStruct* Struct)
+{
+	const TSharedPtr<const FSpudStructLayout> Layout = SpudPropertyUtil::GetBlittableStructLayout(Struct);
+	if (!Layout)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Cannot add bulk column of %s to %s, it is not registered as a blittable struct"),
+		       Struct ? *Struct->GetName() : TEXT("null"), *Archetype.Name);
+		return nullptr;
+	}
+	if (Archetype.Columns.ContainsByPredicate([Layout](const FSpudBulkColumn& C) { return C.LayoutHash == Layout->LayoutHash; }))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Bulk archetype %s already has a column of %s"), *Archetype.Name, *Struct->GetName());
+		return nullptr;
+	}
+	const int64 Size = static_cast<int64>(Archetype.NumEntities) * Layout->Size;
+	if (Size > MAX_int32)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Bulk column of %s for %s is too large, split the archetype"), *Struct->GetName(),
+		       *Archetype.Name);
+		return nullptr;
+	}
+
+	// Layout goes in the metadata once, so the data can be converted if the struct changes later
+	if (!Meta.StructLayouts.Contents.Contains(Layout->LayoutHash))
+		Meta.StructLayouts.Contents.Add(Layout->LayoutHash, *Layout);
+
+	AddedColumns.Emplace(Archetype.Name, Layout->LayoutHash);
+	auto& Column = Archetype.Columns.AddDefaulted_GetRef();
+	Column.LayoutHash = Layout->LayoutHash;
+	Column.Stride = Layout->Size;
+	Column.Data.SetNumUninitialized(static_cast<int32>(Size));
+	return Column.Data.GetData();
+}
+
+bool FSpudBulkEntities::ReadColumn(const FSpudBulkArchetypeData& Archetype, const UScriptStruct* Struct,
+                                   void* OutValues) const
+{
+	const TSharedPtr<const FSpudStructLayout> Layout = SpudPropertyUtil::GetBlittableStructLayout(Struct);
+	if (!Layout)
+		return false;
+
+	for (auto&& Column : Archetype.Columns)
+	{
+		if (Column.LayoutHash == Layout->LayoutHash && Column.Stride == Layout->Size)
+		{
+			// Layout unchanged, one copy for the whole column
+			FMemory::Memcpy(OutValues, Column.Data.GetData(), Column.Data.Num());
+			return true;
+		}
+
+		const FSpudStructLayout* StoredLayout = Meta.StructLayouts.Contents.Find(Column.LayoutHash);
+		if (StoredLayout && StoredLayout->StructName == Layout->StructName)
+		{
+			UE_LOG(LogSpudData, Verbose, TEXT("Converting bulk column of %s in %s from old layout"), *Struct->GetName(),
+			       *Archetype.Name);
+			uint8* Out = static_cast<uint8*>(OutValues);
+			for (int32 i = 0; i < Archetype.NumEntities; ++i)
+			{
+				SpudPropertyUtil::ConvertBlittableStructData(*StoredLayout, Column.Data.GetData() + i * Column.Stride,
+				                                             *Layout, Out + i * Layout->Size);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+
+FRWLock& FSpudBulkEntityHandlers::GetLock()
+{
+	static FRWLock Lock;
+	return Lock;
+}
+
+TArray<TSharedRef<ISpudBulkEntityHandler>>& FSpudBulkEntityHandlers::GetHandlers()
+{
+	static TArray<TSharedRef<ISpudBulkEntityHandler>> Handlers;
+	return Handlers;
+}
+
+void FSpudBulkEntityHandlers::Register(TSharedRef<ISpudBulkEntityHandler> Handler)
+{
+	FWriteScopeLock Lock(GetLock());
+	GetHandlers().AddUnique(Handler);
+}
+
+void FSpudBulkEntityHandlers::Unregister(TSharedRef<ISpudBulkEntityHandler> Handler)
+{
+	FWriteScopeLock Lock(GetLock());
+	GetHandlers().Remove(Handler);
+}
+
+void FSpudBulkEntityHandlers::Store(ULevel* Level, FSpudLevelData& LevelData)
+{
+	TArray<TSharedRef<ISpudBulkEntityHandler>> Handlers;
+	{
+		FReadScopeLock Lock(GetLock());
+		Handlers = GetHandlers();
+	}
+	if (Handlers.Num() == 0)
+		return;
+
+	FSpudBulkEntities Entities(LevelData.BulkEntities, LevelData.Metadata);
+	for (auto&& Handler : Handlers)
+	{
+		Handler->StoreBulkEntities(Level, Entities);
+	}
+}
+
+void FSpudBulkEntityHandlers::Restore(ULevel* Level, FSpudLevelData& LevelData)
+{
+	TArray<TSharedRef<ISpudBulkEntityHandler>> Handlers;
+	{
+		FReadScopeLock Lock(GetLock());
+		Handlers = GetHandlers();
+	}
+	if (Handlers.Num() == 0)
+		return;
+
+	const FSpudBulkEntities Entities(LevelData.BulkEntities, LevelData.Metadata);
+	for (auto&& Handler : Handlers)
+	{
+		Handler->RestoreBulkEntities(Level, Entities);
+	}
+}
@@ -0,0 +1,180 @@
+#include "SpudCompiledSerializer.h"
+#include "Misc/ScopeRWLock.h"
+
+/// Collects the top-level properties reflection would store, and whether compiled serializers can handle them all
+class FSpudCompiledPropertyCollector : public SpudPropertyUtil::PropertyVisitor
+{
+public:
+	TArray<FProperty*> Properties;
+	FString UnsupportedReason;
+
+	virtual bool VisitProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID, void* ContainerPtr,
+	                           int Depth) override
+	{
+		const FProperty* ValueProp = Property;
+		if (const auto AProp = CastField<FArrayProperty>(Property))
+			ValueProp = AProp->Inner;
+
+		const auto SProp = CastField<FStructProperty>(ValueProp);
+		if (SProp && !SpudPropertyUtil::IsBuiltInStructProperty(SProp))
+		{
+			UnsupportedReason = FString::Printf(TEXT("%s is a struct"), *Property->GetNameCPP());
+		}
+		else if (CastField<FObjectPropertyBase>(ValueProp))
+		{
+			UnsupportedReason = FString::Printf(TEXT("%s is an object reference"), *Property->GetNameCPP());
+		}
+		else
+		{
+			Properties.Add(Property);
+			return true;
+		}
+		return false;
+	}
+
+	virtual void UnsupportedProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID,
+	                                 int Depth) override
+	{
+		UnsupportedReason = FString::Printf(TEXT("%s is not supported"), *Property->GetNameCPP());
+	}
+
+	virtual uint32 GetNestedPrefix(FProperty* Prop, uint32 CurrentPrefixID) override
+	{
+		// Structs are rejected anyway, don't cascade
+		return SPUDDATA_PREFIXID_NONE;
+	}
+};
+
+bool FSpudCompiledSerializer::Validate()
+{
+	UClass* Class = GetClass();
+	TArray<FFieldDesc> Fields;
+	GetFields(Fields);
+
+	FSpudCompiledPropertyCollector Collector;
+	SpudPropertyUtil::VisitPersistentProperties(Class, Collector);
+
+	FString Problem = Collector.UnsupportedReason;
+	if (Problem.IsEmpty() && Collector.Properties.Num() != Fields.Num())
+	{
+		Problem = FString::Printf(TEXT("%d fields declared but class has %d persistent properties"),
+		                          Fields.Num(), Collector.Properties.Num());
+	}
+	for (int i = 0; Problem.IsEmpty() && i < Fields.Num(); ++i)
+	{
+		FProperty* Prop = Collector.Properties[i];
+		FProperty* ValueProp = Prop;
+		if (const auto AProp = CastField<FArrayProperty>(Prop))
+			ValueProp = AProp->Inner;
+
+		const FFieldDesc& Field = Fields[i];
+		if (Prop->GetNameCPP() != Field.Name)
+		{
+			Problem = FString::Printf(TEXT("field %d is %s but expected %s"), i, *Field.Name, *Prop->GetNameCPP());
+		}
+		else if (SpudPropertyUtil::GetPropertyDataType(Prop) != Field.DataType ||
+			(CastField<FBoolProperty>(ValueProp) != nullptr) != Field.bIsBool)
+		{
+			Problem = FString::Printf(TEXT("field %s type does not match the property"), *Field.Name);
+		}
+	}
+
+	if (!Problem.IsEmpty())
+	{
+		UE_LOG(LogSpudProps, Warning, TEXT("Compiled serializer for %s is not usable, falling back to reflection: %s"),
+		       *Class->GetName(), *Problem);
+		return false;
+	}
+
+	Properties = MoveTemp(Collector.Properties);
+	return true;
+}
+
+bool FSpudCompiledSerializer::CanUseDirectIndex(TSharedPtr<FSpudClassDef> ClassDef,
+                                                const FSpudClassMetadata& Meta) const
+{
+	return ClassDef->Properties.Num() == Properties.Num() && ClassDef->MatchesRuntimeClass(Meta);
+}
+
+void FSpudCompiledSerializer::RegisterField(int32 Index, bool bDirectIndex, TSharedPtr<FSpudClassDef> ClassDef,
+                                            TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta,
+                                            FArchive& Out) const
+{
+	if (bDirectIndex)
+	{
+		// Class def properties are exactly our fields in order, skip the lookups
+		if (PropertyOffsets.Num() < Index + 1)
+			PropertyOffsets.SetNum(Index + 1);
+		PropertyOffsets[Index] = Out.Tell();
+	}
+	else
+	{
+		SpudPropertyUtil::RegisterProperty(Properties[Index], SPUDDATA_PREFIXID_NONE, ClassDef, PropertyOffsets, Meta,
+		                                   Out);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+FRWLock& FSpudCompiledSerializers::GetLock()
+{
+	static FRWLock Lock;
+	return Lock;
+}
+
+TArray<TSharedRef<FSpudCompiledSerializer>>& FSpudCompiledSerializers::GetPending()
+{
+	static TArray<TSharedRef<FSpudCompiledSerializer>> Pending;
+	return Pending;
+}
+
+TMap<const UClass*, TSharedRef<FSpudCompiledSerializer>>& FSpudCompiledSerializers::GetSerializers()
+{
+	static TMap<const UClass*, TSharedRef<FSpudCompiledSerializer>> Serializers;
+	return Serializers;
+}
+
+void FSpudCompiledSerializers::Register(TSharedRef<FSpudCompiledSerializer> Serializer)
+{
+	// Can't touch UClasses yet during static init, so resolve on first use
+	FWriteScopeLock Lock(GetLock());
+	GetPending().Add(Serializer);
+}
+
+void FSpudCompiledSerializers::Unregister(TSharedRef<FSpudCompiledSerializer> Serializer)
+{
+	FWriteScopeLock Lock(GetLock());
+	GetPending().Remove(Serializer);
+	for (auto It = GetSerializers().CreateIterator(); It; ++It)
+	{
+		if (It.Value() == Serializer)
+			It.RemoveCurrent();
+	}
+}
+
+void FSpudCompiledSerializers::ResolvePending()
+{
+	FWriteScopeLock Lock(GetLock());
+	for (const auto& Serializer : GetPending())
+	{
+		if (Serializer->Validate())
+			GetSerializers().Add(Serializer->GetClass(), Serializer);
+	}
+	GetPending().Empty();
+}
+
+TSharedPtr<const FSpudCompiledSerializer> FSpudCompiledSerializers::Find(const UClass* Class)
+{
+	bool bHasPending;
+	{
+		FReadScopeLock Lock(GetLock());
+		bHasPending = GetPending().Num() > 0;
+	}
+	if (bHasPending)
+		ResolvePending();
+
+	FReadScopeLock Lock(GetLock());
+	// Shared so it stays alive if it's unregistered while being used
+	const auto Serializer = GetSerializers().Find(Class);
+	return Serializer ? TSharedPtr<const FSpudCompiledSerializer>(*Serializer) : TSharedPtr<const FSpudCompiledSerializer>();
+}
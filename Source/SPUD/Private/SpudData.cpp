@@ -3,17 +3,84 @@
 #include <algorithm>
 #include "Async/Async.h"
 #include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
 #include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
 #include "SpudPropertyUtil.h"
 
 DEFINE_LOG_CATEGORY(LogSpudData)
 
-// System version covers our internal format changes
-#define SPUD_CURRENT_SYSTEM_VERSION 2
-
 // int32 so that Blueprint-compatible. 2 billion should be enough anyway and you can always use the negatives
 int32 GCurrentUserDataModelVersion = 0;
+// Fixed width unless opted in, so that saves remain readable by older versions of SPUD
+ESpudDataFormat GSpudDataFormat = SDF_FixedWidth;
+// Released levels go straight to disk unless a budget is set
+int64 GSpudCompressedLevelDataBudget = 0;
+bool GSpudCanonicalOutput = false;
+// Enough for a title change or custom info edits; a new screenshot will usually need relocating
+int64 GSpudSaveInfoPadding = 4096;
+
+std::atomic<bool> GSpudCollectContentionStats { false };
+FSpudLockStats GSpudLevelDataMapLockStats;
+FSpudLockStats GSpudLevelLockStats;
+FSpudTimingStats GSpudBackgroundWriteStats;
+
+static thread_local uint64 GSpudThreadLockWaitCycles = 0;
+
+uint64 SpudGetThreadLockWaitCycles()
+{
+	return GSpudThreadLockWaitCycles;
+}
+
+void FSpudTimingStats::Add(uint64 Cycles)
+{
+	++Count;
+	TotalCycles += Cycles;
+	uint64 PrevMax = MaxCycles;
+	while (Cycles > PrevMax && !MaxCycles.compare_exchange_weak(PrevMax, Cycles))
+	{
+	}
+}
+
+void FSpudTimingStats::Reset()
+{
+	Count = 0;
+	TotalCycles = 0;
+	MaxCycles = 0;
+}
+
+FSpudScopeLock::FSpudScopeLock(FCriticalSection* InMutex, FSpudLockStats* InStats) : Mutex(InMutex)
+{
+	// Only a switch, so no ordering is needed with other memory
+	if (GSpudCollectContentionStats.load(std::memory_order_relaxed))
+		Stats = InStats;
+
+	// Only time the wait when there is one, uncontended locking is the common case
+	if (!Mutex->TryLock())
+	{
+		const uint64 WaitStart = FPlatformTime::Cycles64();
+		Mutex->Lock();
+		AcquiredCycles = FPlatformTime::Cycles64();
+		GSpudThreadLockWaitCycles += AcquiredCycles - WaitStart;
+		if (Stats)
+			Stats->Waits.Add(AcquiredCycles - WaitStart);
+	}
+	else if (Stats)
+	{
+		AcquiredCycles = FPlatformTime::Cycles64();
+	}
+}
+
+FSpudScopeLock::~FSpudScopeLock()
+{
+	if (Stats)
+		Stats->Holds.Add(FPlatformTime::Cycles64() - AcquiredCycles);
+	Mutex->Unlock();
+}
+
 //------------------------------------------------------------------------------
 
 bool FSpudChunkedDataArchive::PreviewNextChunk(FSpudChunkHeader& OutHeader, bool SeekBackToHeader)
@@ -62,6 +129,8 @@ void FSpudChunkedDataArchive::SkipNextChunk()
 
 	if (PreviewNextChunk(Header, false))
 	{
+		if (Header.Magic != FSpudChunkHeader::EncodeMagic(SPUDDATA_SAVEINFOPADDING_MAGIC))
+			SkippedChunks.Add(FSpudChunkHeader::MagicToString(Header.MagicFriendly));
 		// Length is after header so we can just seek from here
 		Seek(Tell() + Header.Length);
 	}
@@ -75,6 +144,11 @@ void FSpudChunkedDataArchive::SkipNextChunk()
 //------------------------------------------------------------------------------
 
 bool FSpudChunk::ChunkStart(FArchive& Ar)
+{
+	return ChunkStart(Ar, Ar.IsLoading() ? 0 : EstimateSize());
+}
+
+bool FSpudChunk::ChunkStart(FArchive& Ar, int64 EstimatedSize)
 {
 	ChunkHeaderStart = Ar.Tell();
 	if (Ar.IsLoading())
@@ -93,8 +167,8 @@ bool FSpudChunk::ChunkStart(FArchive& Ar)
 	}
 	else
 	{
-		// We fill length in properly later
-		ChunkHeader.Set(GetMagic(), 0);
+		// We fill length in properly later, but header size has to be decided now
+		ChunkHeader.Set(GetMagic(), 0, EstimatedSize >= SPUDDATA_LARGE_CHUNK_THRESHOLD);
 		Ar << ChunkHeader;
 		ChunkDataStart = Ar.Tell();
 	}
@@ -116,6 +190,13 @@ void FSpudChunk::ChunkEnd(FArchive& Ar)
 		int64 CurrentPos = Ar.Tell();
 		ChunkDataEnd = CurrentPos;
 		ChunkHeader.Length = ChunkDataEnd - ChunkDataStart;
+		if (!ChunkHeader.bLarge && ChunkHeader.Length >= SPUDDATA_LARGE_CHUNK_LENGTH)
+		{
+			// The length can't be recorded, fail the write rather than produce something unreadable
+			UE_LOG(LogSpudData, Error, TEXT("Chunk %s is %llu bytes but was started with a standard header, the write has failed. "
+				"EstimateSize() needs to account for this data."), *FSpudChunkHeader::MagicToString(GetMagic()), ChunkHeader.Length);
+			Ar.SetError();
+		}
 		Ar.Seek(ChunkHeaderStart);
 		Ar << ChunkHeader;
 		Ar.Seek(CurrentPos);
@@ -159,13 +240,27 @@ void FSpudClassDef::WriteToArchive(FSpudChunkedDataArchive& Ar)
 		Ar << ClassName;
 		// Convert our map to a flat structure
 		// We won't use chunks for each child struct, so write the length first
-		uint16 NumProperties = static_cast<uint16>(Properties.Num());
-		Ar << NumProperties;
-		for (auto && Def : Properties)
+		if (Ar.IsCompact())
+		{
+			// IDs are zig-zag encoded as signed so that the NONE values (all bits set) are a single byte
+			SpudWriteVarUInt(Ar, Properties.Num());
+			for (auto && Def : Properties)
+			{
+				SpudWriteVarInt(Ar, static_cast<int32>(Def.PropertyID));
+				SpudWriteVarInt(Ar, static_cast<int32>(Def.PrefixID));
+				SpudWriteVarUInt(Ar, Def.DataType);
+			}
+		}
+		else
 		{
-			Ar << Def.PropertyID;
-			Ar << Def.PrefixID;
-			Ar << Def.DataType;
+			uint16 NumProperties = static_cast<uint16>(Properties.Num());
+			Ar << NumProperties;
+			for (auto && Def : Properties)
+			{
+				Ar << Def.PropertyID;
+				Ar << Def.PrefixID;
+				Ar << Def.DataType;
+			}
 		}
 		ChunkEnd(Ar);
 	}	
@@ -178,20 +273,35 @@ void FSpudClassDef::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSy
 		Ar << ClassName;
 		// Convert from a flat array to a map
 		// Length was first
-		uint16 NumProperties;
-		Ar << NumProperties;
 		Properties.Empty();
 		PropertyLookup.Empty();
-		for (uint16 i = 0; i < NumProperties; ++i)
+		if (Ar.IsCompact())
 		{
-			uint32 PropertyID;
-			uint32 PrefixID;
-			uint16 DataType;
-			Ar << PropertyID;
-			Ar << PrefixID;
-			Ar << DataType;
+			const uint64 NumProperties = SpudReadVarUInt(Ar);
+			for (uint64 i = 0; i < NumProperties; ++i)
+			{
+				const uint32 PropertyID = static_cast<uint32>(static_cast<int32>(SpudReadVarInt(Ar)));
+				const uint32 PrefixID = static_cast<uint32>(static_cast<int32>(SpudReadVarInt(Ar)));
+				const uint16 DataType = static_cast<uint16>(SpudReadVarUInt(Ar));
 
-			AddProperty(PropertyID, PrefixID, DataType);
+				AddProperty(PropertyID, PrefixID, DataType);
+			}
+		}
+		else
+		{
+			uint16 NumProperties;
+			Ar << NumProperties;
+			for (uint16 i = 0; i < NumProperties; ++i)
+			{
+				uint32 PropertyID;
+				uint32 PrefixID;
+				uint16 DataType;
+				Ar << PropertyID;
+				Ar << PrefixID;
+				Ar << DataType;
+
+				AddProperty(PropertyID, PrefixID, DataType);
+			}
 		}
 		RuntimeMatchState = NotChecked;
 		ChunkEnd(Ar);
@@ -205,6 +315,8 @@ int FSpudClassDef::AddProperty(uint32 InPropNameID, uint32 InPrefixID, uint16 In
 
 	auto& InnerMap = PropertyLookup.FindOrAdd(InPrefixID);
 	InnerMap.Add(InPropNameID, Index);
+	// Any previous comparison with the runtime class is no longer valid
+	RuntimeMatchState = NotChecked;
 
 	return Index;
 }
@@ -256,6 +368,8 @@ bool FSpudClassDef::RenameProperty(uint32 OldPropID, uint32 OldPrefixID, uint32
 
 		auto& NewInnerMap = PropertyLookup.FindOrAdd(NewPrefixID);
 		NewInnerMap.Add(NewPropID, Index);
+		// May not match the runtime class any more
+		RuntimeMatchState = NotChecked;
 
 		return true;
 		
@@ -283,8 +397,24 @@ void FSpudPropertyData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
 	if (ChunkStart(Ar))
 	{
-		Ar << PropertyOffsets;
-		Ar << Data;
+		if (Ar.IsCompact())
+		{
+			// Offsets are mostly ascending so store as signed deltas from the previous one
+			SpudWriteVarUInt(Ar, PropertyOffsets.Num());
+			int64 PrevOffset = 0;
+			for (const uint32 Offset : PropertyOffsets)
+			{
+				SpudWriteVarInt(Ar, static_cast<int64>(Offset) - PrevOffset);
+				PrevOffset = Offset;
+			}
+			SpudWriteVarUInt(Ar, Data.Num());
+			Ar.Serialize(Data.GetData(), Data.Num());
+		}
+		else
+		{
+			Ar << PropertyOffsets;
+			Ar << Data;
+		}
 		ChunkEnd(Ar);
 	}
 }
@@ -302,8 +432,23 @@ void FSpudPropertyData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Stor
 	PropertyOffsets.Empty();
 	if (ChunkStart(Ar))
 	{
-		Ar << PropertyOffsets;
-		Ar << Data;
+		if (Ar.IsCompact())
+		{
+			PropertyOffsets.SetNum(static_cast<int32>(SpudReadVarUInt(Ar)));
+			int64 PrevOffset = 0;
+			for (uint32& Offset : PropertyOffsets)
+			{
+				PrevOffset += SpudReadVarInt(Ar);
+				Offset = static_cast<uint32>(PrevOffset);
+			}
+			Data.SetNumUninitialized(static_cast<int32>(SpudReadVarUInt(Ar)));
+			Ar.Serialize(Data.GetData(), Data.Num());
+		}
+		else
+		{
+			Ar << PropertyOffsets;
+			Ar << Data;
+		}
 		ChunkEnd(Ar);
 	}
 }
@@ -383,182 +528,978 @@ void FSpudDestroyedLevelActor::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint
 }
 
 //------------------------------------------------------------------------------
-void FSpudNamedObjectData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+/// Serialized size of a string, assuming it isn't stored as ANSI
+static int64 SpudEstimateStringSize(const FString& Str)
+{
+	return sizeof(int32) + (Str.Len() + 1) * sizeof(TCHAR);
+}
+
+void FSpudInstanceComponentData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
 	if (ChunkStart(Ar))
 	{
 		Ar << Name;
-		CoreData.WriteToArchive(Ar);
-		Properties.WriteToArchive(Ar);
-		CustomData.WriteToArchive(Ar);
+		Ar << NumInstances;
+
+		// Removed instances are (start, count) runs, harvesting tends to remove clusters
+		TArray<int32> Runs;
+		for (TConstSetBitIterator<> It(Removed); It; ++It)
+		{
+			const int32 Index = It.GetIndex();
+			if (Runs.Num() > 0 && Runs[Runs.Num() - 2] + Runs.Last() == Index)
+				++Runs.Last();
+			else
+			{
+				Runs.Add(Index);
+				Runs.Add(1);
+			}
+		}
+		int32 NumRuns = Runs.Num() / 2;
+		Ar << NumRuns;
+		for (int32& Value : Runs)
+		{
+			Ar << Value;
+		}
+
+		// Sorted so the output doesn't depend on the order instances were moved in
+		TArray<int32> ModifiedIndices;
+		Modified.GetKeys(ModifiedIndices);
+		ModifiedIndices.Sort();
+		int32 NumModified = ModifiedIndices.Num();
+		Ar << NumModified;
+		for (int32 Index : ModifiedIndices)
+		{
+			Ar << Index;
+			SpudPropertyUtil::WriteRaw(Modified[Index], Ar);
+		}
 		ChunkEnd(Ar);
 	}
 }
 
-void FSpudNamedObjectData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+int64 FSpudInstanceComponentData::EstimateSize() const
+{
+	// Worst case every removed instance is its own run
+	return SpudEstimateStringSize(Name) + 3 * sizeof(int32) + Removed.CountSetBits() * 2 * sizeof(int32) +
+		Modified.Num() * (sizeof(int32) + sizeof(FTransform));
+}
+
+void FSpudInstanceComponentData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
 {
 	if (ChunkStart(Ar))
 	{
 		Ar << Name;
-		CoreData.ReadFromArchive(Ar, StoredSystemVersion);
-		Properties.ReadFromArchive(Ar, StoredSystemVersion);
-		CustomData.ReadFromArchive(Ar, StoredSystemVersion);
+		Ar << NumInstances;
+		Modified.Empty();
+		if (NumInstances < 0 || NumInstances > MaxInstances)
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Instance count %d of %s is corrupt, ignoring"), NumInstances, *Name);
+			NumInstances = 0;
+			Removed.Empty();
+			ChunkEnd(Ar);
+			return;
+		}
+		Removed.Init(false, NumInstances);
+
+		int32 NumRuns = 0;
+		Ar << NumRuns;
+		for (int32 i = 0; i < NumRuns && !Ar.IsError(); ++i)
+		{
+			int32 Start, Count;
+			Ar << Start;
+			Ar << Count;
+			// Not Start + Count, which can overflow
+			if (Start < 0 || Count < 0 || Start > Removed.Num() || Count > Removed.Num() - Start)
+			{
+				UE_LOG(LogSpudData, Error, TEXT("Removed instances of %s are out of range, ignoring"), *Name);
+				continue;
+			}
+			Removed.SetRange(Start, Count, true);
+		}
+
+		int32 NumModified = 0;
+		Ar << NumModified;
+		for (int32 i = 0; i < NumModified && !Ar.IsError(); ++i)
+		{
+			int32 Index;
+			Ar << Index;
+			FTransform Transform;
+			SpudPropertyUtil::ReadRaw(Transform, Ar);
+			if (Index < 0 || Index >= NumInstances)
+			{
+				UE_LOG(LogSpudData, Error, TEXT("Modified instance %d of %s is out of range, ignoring"), Index, *Name);
+				continue;
+			}
+			Modified.Add(Index, Transform);
+		}
 		ChunkEnd(Ar);
 	}
 }
+
 //------------------------------------------------------------------------------
-void FSpudSpawnedActorData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+void FSpudBlobData::SetData(const TArray<uint8>& Data, bool bCompress)
 {
-	if (ChunkStart(Ar))
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> NewPayload = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	bCompressed = false;
+	if (bCompress && Data.Num() > 0)
 	{
-		Ar << ClassID;
-		Ar << Guid;
-		CoreData.WriteToArchive(Ar);
-		Properties.WriteToArchive(Ar);
-		CustomData.WriteToArchive(Ar);
-		ChunkEnd(Ar);
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Data.Num());
+		NewPayload->SetNumUninitialized(CompressedSize);
+		if (FCompression::CompressMemory(NAME_Zlib, NewPayload->GetData(), CompressedSize, Data.GetData(), Data.Num()) &&
+			CompressedSize < Data.Num())
+		{
+			NewPayload->SetNum(CompressedSize);
+			bCompressed = true;
+		}
 	}
+	if (!bCompressed)
+		*NewPayload = Data;
+
+	UncompressedSize = Data.Num();
+	PayloadSize = NewPayload->Num();
+	Payload = NewPayload;
+	SourceFile.Empty();
+	SourceOffset = 0;
 }
 
-void FSpudSpawnedActorData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+bool FSpudBlobData::LoadPayload()
 {
-	if (ChunkStart(Ar))
+	if (Payload.IsValid())
+		return true;
+
+	IFileManager& FileMgr = IFileManager::Get();
+	const auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*SourceFile));
+	if (!Archive)
 	{
-		Ar << ClassID;
-		Ar << Guid;
-		CoreData.ReadFromArchive(Ar, StoredSystemVersion);
-		Properties.ReadFromArchive(Ar, StoredSystemVersion);
-		CustomData.ReadFromArchive(Ar, StoredSystemVersion);
-		ChunkEnd(Ar);
+		UE_LOG(LogSpudData, Error, TEXT("Unable to open %s to read blob %s"), *SourceFile, *Name);
+		return false;
+	}
+
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> NewPayload = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	NewPayload->SetNumUninitialized(PayloadSize);
+	Archive->Seek(SourceOffset);
+	Archive->Serialize(NewPayload->GetData(), PayloadSize);
+	Archive->Close();
+	if (Archive->IsError())
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error while reading blob %s from %s"), *Name, *SourceFile);
+		return false;
 	}
+	Payload = NewPayload;
+	return true;
 }
 
-//------------------------------------------------------------------------------
+bool FSpudBlobData::GetData(TArray<uint8>& OutData)
+{
+	return LoadPayload() && DecodePayload(*Payload, bCompressed, UncompressedSize, OutData);
+}
 
-bool FSpudNamedObjectMap::RenameObject(const FString& OldName, const FString& NewName)
+bool FSpudBlobData::DecodePayload(const TArray<uint8>& InPayload, bool bIsCompressed, int32 InUncompressedSize,
+                                  TArray<uint8>& OutData)
 {
-	FSpudNamedObjectData ObjData;
-	if(Contents.RemoveAndCopyValue(OldName, ObjData))
+	if (!bIsCompressed)
 	{
-		ObjData.Name = NewName;
-		Contents.Add(NewName, ObjData);
+		OutData = InPayload;
 		return true;
 	}
-	return false;
-}
 
-//------------------------------------------------------------------------------
+	OutData.SetNumUninitialized(InUncompressedSize);
+	if (!FCompression::UncompressMemory(NAME_Zlib, OutData.GetData(), InUncompressedSize, InPayload.GetData(), InPayload.Num()))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Unable to decompress blob data"));
+		OutData.Empty();
+		return false;
+	}
+	return true;
+}
 
-void FSpudDestroyedActorArray::Add(const FString& Name)
+void FSpudBlobData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
+	// Blobs which were never requested are copied straight from the file they were read from
+	if (!LoadPayload())
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Blob %s could not be read, it will be missing from the level data"), *Name);
+		return;
+	}
 
-	Values.Add(MakeShareable(new FSpudDestroyedLevelActor(Name)));
-	
+	if (ChunkStart(Ar))
+	{
+		Ar << Name;
+		Ar << Owner;
+		uint8 CompressedFlag = bCompressed ? 1 : 0;
+		Ar << CompressedFlag;
+		Ar << UncompressedSize;
+		Ar << PayloadSize;
+		Ar.Serialize(const_cast<uint8*>(Payload->GetData()), PayloadSize);
+		ChunkEnd(Ar);
+	}
 }
-//------------------------------------------------------------------------------
 
-void FSpudClassMetadata::WriteToArchive(FSpudChunkedDataArchive& Ar)
+void FSpudBlobData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
 {
 	if (ChunkStart(Ar))
 	{
-		UserDataModelVersion.Version = GCurrentUserDataModelVersion;
-		UserDataModelVersion.WriteToArchive(Ar);
-		
-		ClassNameIndex.WriteToArchive(Ar);
-		ClassDefinitions.WriteToArchive(Ar);
-		PropertyNameIndex.WriteToArchive(Ar);
-
+		Ar << Name;
+		Ar << Owner;
+		uint8 CompressedFlag;
+		Ar << CompressedFlag;
+		bCompressed = CompressedFlag != 0;
+		Ar << UncompressedSize;
+		Ar << PayloadSize;
+
+		Payload.Reset();
+		SourceFile = Ar.LazyBlobSource;
+		SourceOffset = Ar.Tell();
+		if (SourceFile.IsEmpty())
+		{
+			TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> NewPayload = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+			NewPayload->SetNumUninitialized(PayloadSize);
+			Ar.Serialize(NewPayload->GetData(), PayloadSize);
+			Payload = NewPayload;
+			SourceOffset = 0;
+		}
+		// Otherwise leave the payload in the file, ChunkEnd skips over it
 		ChunkEnd(Ar);
 	}
 }
 
-void FSpudClassMetadata::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+bool FSpudBlobMap::HasUnloadedPayloads() const
+{
+	for (auto& KV : Contents)
+	{
+		if (!KV.Value.Payload.IsValid())
+			return true;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+void FSpudBulkArchetypeData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
 	if (ChunkStart(Ar))
 	{
-		const uint32 VersionID = FSpudChunkHeader::EncodeMagic(SPUDDATA_VERSIONINFO_MAGIC);
-		const uint32 ClassNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSNAMEINDEX_MAGIC);
-		const uint32 ClassDefListID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSDEFINITIONLIST_MAGIC);
-		const uint32 PropertyNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_PROPERTYNAMEINDEX_MAGIC);
-		FSpudChunkHeader Hdr;
-		while (IsStillInChunk(Ar))
+		Ar << Name;
+		Ar << NumEntities;
+		int32 NumColumns = Columns.Num();
+		Ar << NumColumns;
+		for (auto&& Column : Columns)
 		{
-			Ar.PreviewNextChunk(Hdr, true);
-			if (Hdr.Magic == VersionID)
-				UserDataModelVersion.ReadFromArchive(Ar, StoredSystemVersion);
-			else if (Hdr.Magic == ClassNameIndexID)
-				ClassNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
-			else if (Hdr.Magic == ClassDefListID)
-				ClassDefinitions.ReadFromArchive(Ar, StoredSystemVersion);
-			else if (Hdr.Magic == PropertyNameIndexID)
-				PropertyNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
-			else
-				Ar.SkipNextChunk();
+			Ar << Column.LayoutHash;
+			Ar << Column.Stride;
+			// Size is implied by NumEntities & Stride
+			Ar.Serialize(Column.Data.GetData(), Column.Data.Num());
 		}
 		ChunkEnd(Ar);
 	}
 }
 
-TSharedPtr<FSpudClassDef> FSpudClassMetadata::FindOrAddClassDef(const FString& ClassName)
+void FSpudBulkArchetypeData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
 {
-	// This adds new entries
-	int Index = ClassNameIndex.FindOrAddIndex(ClassName);
-	if (ClassDefinitions.Values.Num() < Index + 1)
+	if (ChunkStart(Ar))
 	{
-		// Create new entries
-		int OldNum = ClassDefinitions.Values.Num();
-		ClassDefinitions.Values.SetNum(Index + 1);
-		for (int i = OldNum; i < Index + 1; ++i)
+		Ar << Name;
+		Ar << NumEntities;
+		int32 NumColumns = 0;
+		Ar << NumColumns;
+		// Each column has at least a hash & stride
+		bool bCorrupt = NumColumns < 0 || NumColumns * 2 * static_cast<int64>(sizeof(uint32)) > ChunkDataEnd - Ar.Tell();
+		Columns.SetNum(bCorrupt ? 0 : NumColumns);
+		for (auto&& Column : Columns)
 		{
-			ClassDefinitions.Values[i] = MakeShareable(new FSpudClassDef());
+			Ar << Column.LayoutHash;
+			Ar << Column.Stride;
+			const int64 Size = static_cast<int64>(NumEntities) * Column.Stride;
+			if (Size < 0 || Ar.Tell() + Size > ChunkDataEnd)
+			{
+				bCorrupt = true;
+				break;
+			}
+			Column.Data.SetNumUninitialized(static_cast<int32>(Size));
+			Ar.Serialize(Column.Data.GetData(), Size);
 		}
-		// Set ClassName to correct one
-		ClassDefinitions.Values[Index]->ClassName = ClassName;
+		if (bCorrupt)
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Bulk archetype %s is corrupt, columns are larger than its chunk"), *Name);
+			Columns.Empty();
+			NumEntities = 0;
+		}
+		ChunkEnd(Ar);
 	}
-	return ClassDefinitions.Values[Index];
 }
 
-TSharedPtr<const FSpudClassDef> FSpudClassMetadata::GetClassDef(const FString& ClassName) const
+int64 FSpudBulkArchetypeData::EstimateSize() const
 {
-	int Index = ClassNameIndex.GetIndex(ClassName);
-	if (Index != SPUDDATA_INDEX_NONE)
+	int64 Total = Name.Len() + 16;
+	for (auto&& Column : Columns)
 	{
-		return ClassDefinitions.Values[Index];
+		Total += Column.Data.Num() + 8;
 	}
-	return nullptr;
+	return Total;
 }
 
-const FString& FSpudClassMetadata::GetPropertyNameFromID(uint32 ID) const
+//------------------------------------------------------------------------------
+void FSpudStructLayout::CalculateHash()
 {
-	return PropertyNameIndex.GetValue(ID);
+	LayoutHash = FCrc::MemCrc32(&Size, sizeof(Size));
+	for (auto && Field : Fields)
+	{
+		LayoutHash = FCrc::StrCrc32(*Field.Name, LayoutHash);
+		LayoutHash = FCrc::StrCrc32(*Field.TypeName, LayoutHash);
+		LayoutHash = FCrc::MemCrc32(&Field.Offset, sizeof(Field.Offset), LayoutHash);
+		LayoutHash = FCrc::MemCrc32(&Field.Size, sizeof(Field.Size), LayoutHash);
+		LayoutHash = FCrc::MemCrc32(&Field.BoolMask, sizeof(Field.BoolMask), LayoutHash);
+	}
 }
-uint32 FSpudClassMetadata::FindOrAddPropertyIDFromName(const FString& Name)
+
+void FSpudStructLayout::ZeroPadding(uint8* Data, int32 Count) const
 {
-	return PropertyNameIndex.FindOrAddIndex(Name);
+	TArray<uint8, TInlineAllocator<256>> Mask;
+	Mask.SetNumZeroed(Size);
+	for (auto && Field : Fields)
+	{
+		if (Field.Offset + Field.Size > Size)
+			continue;
+		if (Field.BoolMask)
+			Mask[Field.Offset] |= Field.BoolMask;
+		else
+			FMemory::Memset(Mask.GetData() + Field.Offset, 0xFF, Field.Size);
+	}
+	for (int32 i = 0; i < Count; ++i, Data += Size)
+	{
+		for (uint32 b = 0; b < Size; ++b)
+		{
+			Data[b] &= Mask[b];
+		}
+	}
 }
 
-uint32 FSpudClassMetadata::GetPropertyIDFromName(const FString& Name) const
+void FSpudStructLayout::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
-	return PropertyNameIndex.GetIndex(Name);
+	if (ChunkStart(Ar))
+	{
+		Ar << StructName;
+		Ar << LayoutHash;
+		Ar << Size;
+		Ar << Fields;
+		ChunkEnd(Ar);
+	}
 }
 
-uint32 FSpudClassMetadata::FindOrAddPropertyIDFromProperty(const FProperty* Prop)
+void FSpudStructLayout::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
 {
-	return FindOrAddPropertyIDFromName(Prop->GetNameCPP());
+	if (ChunkStart(Ar))
+	{
+		Ar << StructName;
+		Ar << LayoutHash;
+		Ar << Size;
+		Ar << Fields;
+		ChunkEnd(Ar);
+	}
 }
-uint32 FSpudClassMetadata::FindOrAddPrefixID(const FString& Prefix)
-{
-	// Special case blank
-	if (Prefix.IsEmpty())
-		return SPUDDATA_PREFIXID_NONE;
 
-	// Otherwise same as property (helps share names when scope & prop names are their own entries)
-	return FindOrAddPropertyIDFromName(Prefix);	
-}
-uint32 FSpudClassMetadata::GetPrefixID(const FString& Prefix)
+//------------------------------------------------------------------------------
+void FSpudComponentTable::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
-	// Special case blank
-	if (Prefix.IsEmpty())
+	if (ChunkStart(Ar))
+	{
+		if (Ar.IsCompact())
+			SpudWriteVarUInt(Ar, Components.Num());
+		else
+		{
+			int32 Num = Components.Num();
+			Ar << Num;
+		}
+		for (auto && Component : Components)
+		{
+			Ar << Component.Name;
+			Component.Properties.WriteToArchive(Ar);
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudComponentTable::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		int64 Num;
+		if (Ar.IsCompact())
+			Num = static_cast<int64>(FMath::Min<uint64>(SpudReadVarUInt(Ar), MAX_int32));
+		else
+		{
+			int32 Num32;
+			Ar << Num32;
+			Num = Num32;
+		}
+		// Every component has at least a name length and a property data header, don't trust a count which can't fit
+		const int64 MinComponentSize = sizeof(int32) + FSpudChunkHeader::GetHeaderSize();
+		if (Num < 0 || Num * MinComponentSize > ChunkDataEnd - Ar.Tell())
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Component table is corrupt, %lld components can't fit in its chunk"), Num);
+			Num = 0;
+		}
+		Components.SetNum(static_cast<int32>(Num));
+		for (auto && Component : Components)
+		{
+			if (!IsStillInChunk(Ar))
+				break;
+			Ar << Component.Name;
+			Component.Properties.ReadFromArchive(Ar, StoredSystemVersion);
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+int64 FSpudComponentTable::EstimateSize() const
+{
+	int64 Size = 0;
+	for (auto && Component : Components)
+	{
+		Size += Component.Name.Len() + Component.Properties.Data.Num() +
+			Component.Properties.PropertyOffsets.Num() * sizeof(uint32) + 2 * FSpudChunkHeader::GetHeaderSize();
+	}
+	return Size;
+}
+
+//------------------------------------------------------------------------------
+void FSpudObjectData::WriteComponentsToArchive(FSpudChunkedDataArchive& Ar)
+{
+	// Most actors don't store components, leave the chunk out for those so their data is unchanged
+	if (Components.Components.Num() > 0)
+		Components.WriteToArchive(Ar);
+}
+
+void FSpudObjectData::ReadComponentsFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	// Optional, ChunkStart won't match if it's not there
+	Components.Reset();
+	if (IsStillInChunk(Ar))
+		Components.ReadFromArchive(Ar, StoredSystemVersion);
+}
+
+//------------------------------------------------------------------------------
+void FSpudNamedObjectData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		Ar << Name;
+		CoreData.WriteToArchive(Ar);
+		Properties.WriteToArchive(Ar);
+		CustomData.WriteToArchive(Ar);
+		WriteComponentsToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudNamedObjectData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		Ar << Name;
+		CoreData.ReadFromArchive(Ar, StoredSystemVersion);
+		Properties.ReadFromArchive(Ar, StoredSystemVersion);
+		CustomData.ReadFromArchive(Ar, StoredSystemVersion);
+		ReadComponentsFromArchive(Ar, StoredSystemVersion);
+		ChunkEnd(Ar);
+	}
+}
+//------------------------------------------------------------------------------
+void FSpudSpawnedActorData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		Ar << ClassID;
+		Ar << Guid;
+		CoreData.WriteToArchive(Ar);
+		Properties.WriteToArchive(Ar);
+		CustomData.WriteToArchive(Ar);
+		WriteComponentsToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudSpawnedActorData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		Ar << ClassID;
+		Ar << Guid;
+		CoreData.ReadFromArchive(Ar, StoredSystemVersion);
+		Properties.ReadFromArchive(Ar, StoredSystemVersion);
+		CustomData.ReadFromArchive(Ar, StoredSystemVersion);
+		ReadComponentsFromArchive(Ar, StoredSystemVersion);
+		ChunkEnd(Ar);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool FSpudNamedObjectMap::RenameObject(const FString& OldName, const FString& NewName)
+{
+	FSpudNamedObjectData ObjData;
+	if(Contents.RemoveAndCopyValue(OldName, ObjData))
+	{
+		ObjData.Name = NewName;
+		Contents.Add(NewName, ObjData);
+		return true;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+
+void FSpudGlobalObjectDirectory::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		uint32 Count = Entries.Num();
+		Ar << Count;
+		for (auto& Entry : Entries)
+		{
+			Ar << Entry;
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudGlobalObjectDirectory::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		uint32 Count;
+		Ar << Count;
+		Entries.SetNum(Count);
+		for (auto& Entry : Entries)
+		{
+			Ar << Entry;
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+FSpudNamedObjectData* FSpudGlobalObjectMap::Find(const FString& Name)
+{
+	if (auto Ret = Contents.Find(Name))
+		return Ret;
+
+	const auto Enc = Encoded.Find(Name);
+	if (!Enc)
+		return nullptr;
+
+	// First request for this object, decode it now
+	FMemoryReader Reader(*Enc->Buffer, true);
+	Reader.Seek(Enc->Offset);
+	FSpudChunkedDataArchive ChunkedAr(Reader);
+	ChunkedAr.DataFormat = EncodedFormat;
+	FSpudNamedObjectData& Data = Contents.Add(Name);
+	// Objects from older system versions are decoded as soon as they're read, so these are always current
+	Data.ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+	if (ChunkedAr.IsError() || Data.Name != Name)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Global object %s could not be decoded"), *Name);
+		Contents.Remove(Name);
+		Encoded.Remove(Name);
+		return nullptr;
+	}
+	return &Data;
+}
+
+FSpudNamedObjectData& FSpudGlobalObjectMap::FindOrAdd(const FString& Name)
+{
+	if (auto Ret = Find(Name))
+		return *Ret;
+
+	FSpudNamedObjectData& Data = Contents.Add(Name);
+	Data.Name = Name;
+	return Data;
+}
+
+int32 FSpudGlobalObjectMap::Num() const
+{
+	int32 Count = Encoded.Num();
+	for (auto&& KV : Contents)
+	{
+		if (!Encoded.Contains(KV.Key))
+			++Count;
+	}
+	return Count;
+}
+
+void FSpudGlobalObjectMap::GetNames(TArray<FString>& OutNames) const
+{
+	Encoded.GetKeys(OutNames);
+	for (auto&& KV : Contents)
+	{
+		if (!Encoded.Contains(KV.Key))
+			OutNames.Add(KV.Key);
+	}
+}
+
+void FSpudGlobalObjectMap::Empty()
+{
+	Contents.Empty();
+	Encoded.Empty();
+	Dirty.Empty();
+	Directory.Entries.Empty();
+}
+
+void FSpudGlobalObjectMap::DecodeAll()
+{
+	TArray<FString> Names;
+	Encoded.GetKeys(Names);
+	for (const auto& Name : Names)
+	{
+		Find(Name);
+	}
+}
+
+bool FSpudGlobalObjectMap::RenameObject(const FString& OldName, const FString& NewName)
+{
+	// Name is inside the encoded data, so must be decoded & re-encoded
+	Find(OldName);
+	Encoded.Remove(OldName);
+	Dirty.Remove(OldName);
+	if (FSpudNamedObjectMap::RenameObject(OldName, NewName))
+	{
+		Encoded.Remove(NewName);
+		MarkDirty(NewName);
+		return true;
+	}
+	return false;
+}
+
+int64 FSpudGlobalObjectMap::EstimateSize() const
+{
+	int64 Total = 0;
+	for (auto&& KV : Encoded)
+	{
+		if (!Dirty.Contains(KV.Key))
+			Total += KV.Value.Length;
+	}
+	for (auto&& KV : Contents)
+	{
+		if (Dirty.Contains(KV.Key) || !Encoded.Contains(KV.Key))
+			Total += KV.Value.EstimateSize() + FSpudChunkHeader::GetHeaderSize();
+	}
+	return Total;
+}
+
+void FSpudGlobalObjectMap::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	// Encoded objects can only be copied as-is to the same format
+	if (EncodedFormat != Ar.DataFormat)
+	{
+		DecodeAll();
+		for (auto&& KV : Contents)
+		{
+			MarkDirty(KV.Key);
+		}
+		EncodedFormat = Ar.DataFormat;
+	}
+
+	// Re-encode changed & new objects
+	for (auto&& KV : Contents)
+	{
+		if (Dirty.Contains(KV.Key) || !Encoded.Contains(KV.Key))
+		{
+			auto Buffer = MakeShared<TArray<uint8>>();
+			FMemoryWriter Writer(*Buffer, true);
+			FSpudChunkedDataArchive ChunkedAr(Writer);
+			ChunkedAr.DataFormat = Ar.DataFormat;
+			KV.Value.WriteToArchive(ChunkedAr);
+			Encoded.Add(KV.Key, FEncodedObject { Buffer, 0, Buffer->Num() });
+		}
+	}
+	Dirty.Empty();
+	TArray<FString> Names;
+	Encoded.GetKeys(Names);
+	if (GSpudCanonicalOutput)
+		Names.Sort();
+
+	// Everything is encoded now, so the directory is known up-front
+	Directory.Entries.Empty(Encoded.Num());
+	uint64 Offset = 0;
+	for (const auto& Name : Names)
+	{
+		const FEncodedObject& Enc = Encoded.FindChecked(Name);
+		Directory.Entries.Add(FSpudGlobalObjectDirectoryEntry { Name, Offset, static_cast<uint64>(Enc.Length) });
+		Offset += Enc.Length;
+	}
+	Directory.WriteToArchive(Ar);
+	Directory.Entries.Empty();
+
+	if (ChunkStart(Ar, Offset))
+	{
+		for (const auto& Name : Names)
+		{
+			const FEncodedObject& Enc = Encoded.FindChecked(Name);
+			Ar.Serialize(Enc.Buffer->GetData() + Enc.Offset, Enc.Length);
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudGlobalObjectMap::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	const int64 Start = Ar.Tell();
+	if (ChunkStart(Ar))
+	{
+		const int64 Length = ChunkDataEnd - ChunkDataStart;
+		if (Length > MAX_int32)
+		{
+			// Too big to hold in one buffer, decode everything the old way
+			Ar.Seek(Start);
+			FSpudNamedObjectMap::ReadFromArchive(Ar, StoredSystemVersion);
+			Encoded.Empty();
+			Dirty.Empty();
+			Directory.Entries.Empty();
+			return;
+		}
+
+		Contents.Empty();
+		Encoded.Empty();
+		Dirty.Empty();
+		EncodedFormat = Ar.DataFormat;
+
+		// Read all the object chunks in one go, they're only decoded on request
+		auto Buffer = MakeShared<TArray<uint8>>();
+		Buffer->SetNumUninitialized(Length);
+		Ar.Serialize(Buffer->GetData(), Length);
+
+		bool bDirectoryValid = Directory.Entries.Num() > 0;
+		for (const auto& Entry : Directory.Entries)
+		{
+			if (Entry.Offset + Entry.Length > static_cast<uint64>(Length))
+			{
+				UE_LOG(LogSpudData, Warning, TEXT("Global object directory is invalid, ignoring it"));
+				bDirectoryValid = false;
+				break;
+			}
+			Encoded.Add(Entry.Name, FEncodedObject { Buffer, static_cast<int64>(Entry.Offset), static_cast<int64>(Entry.Length) });
+		}
+
+		if (!bDirectoryValid)
+		{
+			// No directory (older save), just find the object chunks & their names
+			Encoded.Empty();
+			FMemoryReader Reader(*Buffer, true);
+			FSpudChunkedDataArchive ChunkedAr(Reader);
+			const uint32 ChildMagicID = FSpudChunkHeader::EncodeMagic(GetChildMagic());
+			while (Reader.Tell() < Length && !Reader.IsError())
+			{
+				const int64 ChildStart = Reader.Tell();
+				FSpudChunkHeader Hdr;
+				ChunkedAr << Hdr;
+				const int64 ChildEnd = Reader.Tell() + Hdr.Length;
+				if (ChildEnd > Length)
+				{
+					UE_LOG(LogSpudData, Error, TEXT("Global object list is corrupt, some objects will be missing"));
+					break;
+				}
+				if (Hdr.Magic == ChildMagicID)
+				{
+					FString Name;
+					ChunkedAr << Name;
+					Encoded.Add(Name, FEncodedObject { Buffer, ChildStart, ChildEnd - ChildStart });
+				}
+				Reader.Seek(ChildEnd);
+			}
+		}
+		Directory.Entries.Empty();
+
+		ChunkEnd(Ar);
+
+		if (StoredSystemVersion != SPUD_CURRENT_SYSTEM_VERSION)
+		{
+			// Can't copy older versions back out as-is
+			DecodeAll();
+			for (auto&& KV : Contents)
+			{
+				MarkDirty(KV.Key);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void FSpudDestroyedActorArray::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (!GSpudCanonicalOutput)
+	{
+		FSpudArray<FSpudDestroyedLevelActor>::WriteToArchive(Ar);
+		return;
+	}
+
+	// Sort a copy, writing shouldn't change the order destructions were recorded in
+	TArray<TSharedPtr<FSpudDestroyedLevelActor>> Sorted = Values;
+	Sorted.StableSort([](const TSharedPtr<FSpudDestroyedLevelActor>& A, const TSharedPtr<FSpudDestroyedLevelActor>& B)
+	{
+		return A->Name < B->Name;
+	});
+	if (ChunkStart(Ar))
+	{
+		for (auto&& Item : Sorted)
+		{
+			Item->WriteToArchive(Ar);
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+int64 FSpudDestroyedActorArray::EstimateSize() const
+{
+	int64 Total = 0;
+	for (auto&& Item : Values)
+	{
+		Total += SpudEstimateStringSize(Item->Name) + FSpudChunkHeader::GetHeaderSize();
+	}
+	return Total;
+}
+
+void FSpudDestroyedActorArray::Add(const FString& Name)
+{
+
+	Values.Add(MakeShareable(new FSpudDestroyedLevelActor(Name)));
+	
+}
+//------------------------------------------------------------------------------
+
+FSpudClassMetadata::FSpudClassMetadata()
+{
+	DataFormat.Version = GSpudDataFormat;
+}
+
+void FSpudClassMetadata::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		// Format goes first since it determines how the rest of the chunks in here are read
+		// Not written at all for fixed width, which is what readers assume when it's missing
+		if (IsCompact())
+			DataFormat.WriteToArchive(Ar);
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		Ar.DataFormat = GetDataFormat();
+
+		UserDataModelVersion.Version = GCurrentUserDataModelVersion;
+		UserDataModelVersion.WriteToArchive(Ar);
+		
+		ClassNameIndex.WriteToArchive(Ar);
+		ClassDefinitions.WriteToArchive(Ar);
+		PropertyNameIndex.WriteToArchive(Ar);
+		if (StructLayouts.Contents.Num() > 0)
+			StructLayouts.WriteToArchive(Ar);
+
+		Ar.DataFormat = PrevFormat;
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudClassMetadata::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		// Class IDs are only meaningful within the metadata they came from
+		ResolvedClasses.Empty();
+		const uint32 VersionID = FSpudChunkHeader::EncodeMagic(SPUDDATA_VERSIONINFO_MAGIC);
+		const uint32 DataFormatID = FSpudChunkHeader::EncodeMagic(SPUDDATA_DATAFORMAT_MAGIC);
+		const uint32 ClassNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSNAMEINDEX_MAGIC);
+		const uint32 ClassDefListID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSDEFINITIONLIST_MAGIC);
+		const uint32 PropertyNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_PROPERTYNAMEINDEX_MAGIC);
+		const uint32 StructLayoutListID = FSpudChunkHeader::EncodeMagic(SPUDDATA_STRUCTLAYOUTLIST_MAGIC);
+		StructLayouts.Empty();
+		// No format chunk means fixed width
+		DataFormat.Version = SDF_FixedWidth;
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		Ar.DataFormat = SDF_FixedWidth;
+		FSpudChunkHeader Hdr;
+		while (IsStillInChunk(Ar))
+		{
+			Ar.PreviewNextChunk(Hdr, true);
+			if (Hdr.Magic == DataFormatID)
+			{
+				DataFormat.ReadFromArchive(Ar, StoredSystemVersion);
+				Ar.DataFormat = GetDataFormat();
+			}
+			else if (Hdr.Magic == VersionID)
+				UserDataModelVersion.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == ClassNameIndexID)
+				ClassNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == ClassDefListID)
+				ClassDefinitions.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == PropertyNameIndexID)
+				PropertyNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == StructLayoutListID)
+				StructLayouts.ReadFromArchive(Ar, StoredSystemVersion);
+			else
+				Ar.SkipNextChunk();
+		}
+		Ar.DataFormat = PrevFormat;
+		ChunkEnd(Ar);
+	}
+}
+
+TSharedPtr<FSpudClassDef> FSpudClassMetadata::FindOrAddClassDef(const FString& ClassName)
+{
+	// This adds new entries
+	int Index = ClassNameIndex.FindOrAddIndex(ClassName);
+	if (ClassDefinitions.Values.Num() < Index + 1)
+	{
+		// Create new entries
+		int OldNum = ClassDefinitions.Values.Num();
+		ClassDefinitions.Values.SetNum(Index + 1);
+		for (int i = OldNum; i < Index + 1; ++i)
+		{
+			ClassDefinitions.Values[i] = MakeShareable(new FSpudClassDef());
+		}
+		// Set ClassName to correct one
+		ClassDefinitions.Values[Index]->ClassName = ClassName;
+	}
+	return ClassDefinitions.Values[Index];
+}
+
+TSharedPtr<const FSpudClassDef> FSpudClassMetadata::GetClassDef(const FString& ClassName) const
+{
+	int Index = ClassNameIndex.GetIndex(ClassName);
+	if (Index != SPUDDATA_INDEX_NONE)
+	{
+		return ClassDefinitions.Values[Index];
+	}
+	return nullptr;
+}
+
+const FString& FSpudClassMetadata::GetPropertyNameFromID(uint32 ID) const
+{
+	return PropertyNameIndex.GetValue(ID);
+}
+uint32 FSpudClassMetadata::FindOrAddPropertyIDFromName(const FString& Name)
+{
+	return PropertyNameIndex.FindOrAddIndex(Name);
+}
+
+uint32 FSpudClassMetadata::GetPropertyIDFromName(const FString& Name) const
+{
+	return PropertyNameIndex.GetIndex(Name);
+}
+
+uint32 FSpudClassMetadata::FindOrAddPropertyIDFromProperty(const FProperty* Prop)
+{
+	return FindOrAddPropertyIDFromName(Prop->GetNameCPP());
+}
+uint32 FSpudClassMetadata::FindOrAddPrefixID(const FString& Prefix)
+{
+	// Special case blank
+	if (Prefix.IsEmpty())
+		return SPUDDATA_PREFIXID_NONE;
+
+	// Otherwise same as property (helps share names when scope & prop names are their own entries)
+	return FindOrAddPropertyIDFromName(Prefix);	
+}
+uint32 FSpudClassMetadata::GetPrefixID(const FString& Prefix)
+{
+	// Special case blank
+	if (Prefix.IsEmpty())
 		return SPUDDATA_PREFIXID_NONE;
 	
 	// Prefixes share the property name lookup
@@ -583,11 +1524,59 @@ uint32 FSpudClassMetadata::GetClassIDFromName(const FString& Name) const
 	return ClassNameIndex.GetIndex(Name);
 }
 
+UClass* FSpudClassMetadata::ResolveClass(uint32 ClassID) const
+{
+	if (const auto Cached = ResolvedClasses.Find(ClassID))
+	{
+		if (Cached->IsValid())
+			return Cached->Get();
+	}
+
+	const FSoftClassPath CP(GetClassNameFromID(ClassID));
+	UClass* Class = CP.TryLoadClass<UObject>();
+	// Don't cache failures, the class could be loaded later
+	if (Class)
+		ResolvedClasses.Add(ClassID, Class);
+	return Class;
+}
+
+int64 FSpudClassMetadata::EstimateSize() const
+{
+	// Version & format chunks, plus the headers of the lists
+	int64 Total = 8 * FSpudChunkHeader::GetHeaderSize();
+	for (auto&& Def : ClassDefinitions.Values)
+	{
+		Total += SpudEstimateStringSize(Def->ClassName) + FSpudChunkHeader::GetHeaderSize() + sizeof(uint16) +
+			Def->Properties.Num() * (2 * sizeof(uint32) + sizeof(uint16));
+	}
+	for (auto&& Name : ClassNameIndex.UniqueValues)
+	{
+		Total += SpudEstimateStringSize(Name);
+	}
+	for (auto&& Name : PropertyNameIndex.UniqueValues)
+	{
+		Total += SpudEstimateStringSize(Name);
+	}
+	for (auto&& KV : StructLayouts.Contents)
+	{
+		Total += SpudEstimateStringSize(KV.Value.StructName) + FSpudChunkHeader::GetHeaderSize() + 12;
+		for (auto&& Field : KV.Value.Fields)
+		{
+			Total += SpudEstimateStringSize(Field.Name) + SpudEstimateStringSize(Field.TypeName) + 9;
+		}
+	}
+	return Total;
+}
+
 void FSpudClassMetadata::Reset()
 {
+	ResolvedClasses.Empty();
 	ClassDefinitions.Reset();
 	PropertyNameIndex.Empty();
 	ClassNameIndex.Empty();	
+	StructLayouts.Empty();
+	// Everything described by this metadata is about to be regenerated, so can switch format
+	DataFormat.Version = GSpudDataFormat;
 }
 
 bool FSpudClassMetadata::RenameClass(const FString& OldClassName, const FString& NewClassName)
@@ -595,6 +1584,7 @@ bool FSpudClassMetadata::RenameClass(const FString& OldClassName, const FString&
 	uint32 Index = ClassNameIndex.Rename(OldClassName, NewClassName);
 	if (Index != SPUDDATA_INDEX_NONE)
 	{
+		ResolvedClasses.Remove(Index);
 		auto ClassDef = ClassDefinitions.Values[Index];
 		ClassDef->ClassName = NewClassName;
 		return true;
@@ -629,7 +1619,7 @@ bool FSpudClassMetadata::RenameProperty(const FString& ClassName, const FString&
 //------------------------------------------------------------------------------
 void FSpudLevelData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
 
 	if (Status == LDS_Unloaded)
 	{
@@ -641,14 +1631,24 @@ void FSpudLevelData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 	{
 		Ar << Name;
 		Metadata.WriteToArchive(Ar);
+		// Object data is in the format of the metadata describing it
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		Ar.DataFormat = Metadata.GetDataFormat();
 		LevelActors.WriteToArchive(Ar);
 		SpawnedActors.WriteToArchive(Ar);
 		DestroyedActors.WriteToArchive(Ar);
+		if (BulkEntities.Contents.Num() > 0)
+			BulkEntities.WriteToArchive(Ar);
+		if (InstanceComponents.Contents.Num() > 0)
+			InstanceComponents.WriteToArchive(Ar);
+		if (Blobs.Contents.Num() > 0)
+			Blobs.WriteToArchive(Ar);
+		Ar.DataFormat = PrevFormat;
 		ChunkEnd(Ar);
 	}
 }
 
-bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool bReturnToStart, FString& OutLevelName, int64& OutDataSize)
+bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool bReturnToStart, FString& OutLevelName, int64& OutChunkSize)
 {
 	// No lock needed as we're not populating anything, this method can  be static
 	// Do part of ChunkStart required to read header
@@ -670,7 +1670,7 @@ bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool
 		return false;
 	}
 
-	OutDataSize = Hdr.Length;
+	OutChunkSize = Hdr.Length + Hdr.GetSerializedSize();
 	Ar << OutLevelName;
 
 	if (bReturnToStart)
@@ -682,7 +1682,7 @@ bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool
 
 void FSpudLevelData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
 	
 	// Separate loading process since it's easier to deal with chunk robustness and versions
 	if (ChunkStart(Ar))
@@ -693,21 +1693,36 @@ void FSpudLevelData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredS
 		const uint32 LevelActorsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELACTORLIST_MAGIC);
 		const uint32 SpawnedActorsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SPAWNEDACTORLIST_MAGIC);
 		const uint32 DestroyedActorsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_DESTROYEDACTORLIST_MAGIC);
+		const uint32 BulkEntitiesID = FSpudChunkHeader::EncodeMagic(SPUDDATA_BULKARCHETYPELIST_MAGIC);
+		const uint32 InstanceComponentsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_INSTANCECOMPONENTLIST_MAGIC);
+		const uint32 BlobsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_BLOBLIST_MAGIC);
+		// Metadata is always written first, and tells us the format of everything after it
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
 		FSpudChunkHeader Hdr;
 		while (IsStillInChunk(Ar))
 		{
 			Ar.PreviewNextChunk(Hdr, true);
 			if (Hdr.Magic == MetadataID)
+			{
 				Metadata.ReadFromArchive(Ar, StoredSystemVersion);
+				Ar.DataFormat = Metadata.GetDataFormat();
+			}
 			else if (Hdr.Magic == LevelActorsID)
 				LevelActors.ReadFromArchive(Ar, StoredSystemVersion);
 			else if (Hdr.Magic == SpawnedActorsID)
 				SpawnedActors.ReadFromArchive(Ar, StoredSystemVersion);
 			else if (Hdr.Magic == DestroyedActorsID)
 				DestroyedActors.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == BulkEntitiesID)
+				BulkEntities.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == InstanceComponentsID)
+				InstanceComponents.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == BlobsID)
+				Blobs.ReadFromArchive(Ar, StoredSystemVersion);
 			else
 				Ar.SkipNextChunk();
 		}
+		Ar.DataFormat = PrevFormat;
 
 		Status = LDS_Loaded;
 		
@@ -717,90 +1732,504 @@ void FSpudLevelData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredS
 
 void FSpudLevelData::PreStoreWorld()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
 
 	// We do NOT empty the destroyed actors list because those are populated as things are removed
 	// Hence why NOT calling Reset()
 	Metadata.Reset();
 	LevelActors.Reset();
 	SpawnedActors.Reset();
+	// Layouts are in the metadata, so these are regenerated too
+	BulkEntities.Reset();
+}
+
+void FSpudLevelData::RemoveOrphanedBlobs()
+{
+	for (auto It = Blobs.Contents.CreateIterator(); It; ++It)
+	{
+		const FString& Owner = It.Value().Owner;
+		if (!LevelActors.Contents.Contains(Owner) && !SpawnedActors.Contents.Contains(Owner))
+		{
+			UE_LOG(LogSpudData, Verbose, TEXT("Removing blob %s from level %s, owner is no longer stored"), *It.Key(), *Name);
+			It.RemoveCurrent();
+		}
+	}
 }
 
 void FSpudLevelData::Reset()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
 	Name = "";
 	Metadata.Reset();
 	LevelActors.Reset();
 	SpawnedActors.Reset();
 	DestroyedActors.Reset();
+	BulkEntities.Reset();
+	InstanceComponents.Reset();
+	Blobs.Reset();
+	CompressedData.Empty();
+	UncompressedSize = 0;
 	Status = LDS_Unloaded;
 }
 bool FSpudLevelData::IsLoaded()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
 	return Status == LDS_Loaded;
 }
 
 void FSpudLevelData::ReleaseMemory()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
 	Metadata.Reset();
 	LevelActors.Reset();
 	SpawnedActors.Reset();
 	DestroyedActors.Reset();
+	BulkEntities.Reset();
+	InstanceComponents.Reset();
+	Blobs.Reset();
+	CompressedData.Empty();
+	UncompressedSize = 0;
 	Status = LDS_Unloaded;
 }
 
+bool FSpudLevelData::Compress()
+{
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
+
+	// Compress exactly what would be written to disk, so it can be spilled to disk later without decoding
+	TArray<uint8> Chunk;
+	FMemoryWriter MemWriter(Chunk, true);
+	FSpudChunkedDataArchive ChunkedAr(MemWriter);
+	WriteToArchive(ChunkedAr);
+	if (ChunkedAr.IsError() || Chunk.Num() == 0)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error while writing level data for %s to memory for compression"), *Name);
+		return false;
+	}
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Chunk.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Chunk.GetData(), Chunk.Num()))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Unable to compress level data for %s"), *Name);
+		return false;
+	}
+	Compressed.SetNum(CompressedSize);
+
+	ReleaseMemory();
+	CompressedData = MoveTemp(Compressed);
+	UncompressedSize = Chunk.Num();
+	Status = LDS_Compressed;
+	UE_LOG(LogSpudData, Verbose, TEXT("Compressed level data for %s from %d to %d bytes"), *Name, UncompressedSize, CompressedData.Num());
+	return true;
+}
+
+bool FSpudLevelData::DecompressChunk(TArray<uint8>& OutChunk)
+{
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
+	OutChunk.SetNumUninitialized(UncompressedSize);
+	if (Status != LDS_Compressed ||
+		!FCompression::UncompressMemory(NAME_Zlib, OutChunk.GetData(), UncompressedSize, CompressedData.GetData(), CompressedData.Num()))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Unable to decompress level data for %s"), *Name);
+		OutChunk.Empty();
+		return false;
+	}
+	return true;
+}
+
+bool FSpudLevelData::Decompress()
+{
+	FSpudScopeLock Lock(&Mutex, &GSpudLevelLockStats);
+	TArray<uint8> Chunk;
+	if (!DecompressChunk(Chunk))
+		return false;
+
+	CompressedData.Empty();
+	UncompressedSize = 0;
+	FMemoryReader MemReader(Chunk, true);
+	FSpudChunkedDataArchive ChunkedAr(MemReader);
+	// Compressed from data in memory, so it's always the current version
+	ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+	return Status == LDS_Loaded;
+}
+
+
+//------------------------------------------------------------------------------
+
+void FSpudGlobalData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		Ar << CurrentLevel;
+		Metadata.WriteToArchive(Ar);
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		Ar.DataFormat = Metadata.GetDataFormat();
+		Objects.WriteToArchive(Ar);
+		Ar.DataFormat = PrevFormat;
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudGlobalData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	// Separate loading process since it's easier to deal with chunk robustness and versions
+	if (ChunkStart(Ar))
+	{
+		Ar << CurrentLevel;
+
+		const uint32 MetadataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_METADATA_MAGIC);
+		const uint32 ObjectsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALOBJECTLIST_MAGIC);
+		const uint32 ObjectsDirectoryID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALOBJECTDIRECTORY_MAGIC);
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		FSpudChunkHeader Hdr;
+		while (IsStillInChunk(Ar))
+		{
+			Ar.PreviewNextChunk(Hdr, true);
+			if (Hdr.Magic == MetadataID)
+			{
+				Metadata.ReadFromArchive(Ar, StoredSystemVersion);
+				Ar.DataFormat = Metadata.GetDataFormat();
+			}
+			else if (Hdr.Magic == ObjectsDirectoryID)
+				Objects.Directory.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == ObjectsID)
+				Objects.ReadFromArchive(Ar, StoredSystemVersion);
+			else
+				Ar.SkipNextChunk();
+		}
+		Ar.DataFormat = PrevFormat;
+
+		ChunkEnd(Ar);
+	}	
+}
+
+void FSpudGlobalData::Reset()
+{
+	CurrentLevel = "";
+	Metadata.Reset();
+	Objects.Empty();
+}
+
+//------------------------------------------------------------------------------
+
+void FSpudSnapshotObjectData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		Properties.WriteToArchive(Ar);
+		CustomData.WriteToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudSnapshotObjectData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		Properties.ReadFromArchive(Ar, StoredSystemVersion);
+		CustomData.ReadFromArchive(Ar, StoredSystemVersion);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudSnapshotObjectData::Reset()
+{
+	// Keep buffers, snapshots are often taken repeatedly
+	Properties.PropertyOffsets.Reset();
+	Properties.Data.Reset();
+	CustomData.Data.Reset();
+}
+
+void FSpudObjectSnapshot::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		SystemVersion.Version = SPUD_CURRENT_SYSTEM_VERSION;
+		SystemVersion.WriteToArchive(Ar);
+		Metadata.WriteToArchive(Ar);
+
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		Ar.DataFormat = Metadata.GetDataFormat();
+		FSpudAdhocWrapperChunk ObjectsChunk(SPUDDATA_SNAPSHOTOBJECTLIST_MAGIC);
+		if (ObjectsChunk.ChunkStart(Ar, EstimateSize()))
+		{
+			// Count first so that reading can allocate once
+			Ar << NumObjects;
+			for (int32 i = 0; i < NumObjects; ++i)
+			{
+				Objects[i].WriteToArchive(Ar);
+			}
+			ObjectsChunk.ChunkEnd(Ar);
+		}
+		Ar.DataFormat = PrevFormat;
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudObjectSnapshot::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		Reset();
+		SystemVersion.Version = StoredSystemVersion;
+
+		const uint32 VersionID = FSpudChunkHeader::EncodeMagic(SPUDDATA_VERSIONINFO_MAGIC);
+		const uint32 MetadataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_METADATA_MAGIC);
+		const uint32 ObjectsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SNAPSHOTOBJECTLIST_MAGIC);
+		const uint32 ObjectID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SNAPSHOTOBJECT_MAGIC);
+		const ESpudDataFormat PrevFormat = Ar.DataFormat;
+		FSpudChunkHeader Hdr;
+		while (IsStillInChunk(Ar))
+		{
+			Ar.PreviewNextChunk(Hdr, true);
+			if (Hdr.Magic == VersionID)
+				SystemVersion.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == MetadataID)
+			{
+				Metadata.ReadFromArchive(Ar, SystemVersion.Version);
+				Ar.DataFormat = Metadata.GetDataFormat();
+			}
+			else if (Hdr.Magic == ObjectsID)
+			{
+				FSpudAdhocWrapperChunk ObjectsChunk(SPUDDATA_SNAPSHOTOBJECTLIST_MAGIC);
+				if (ObjectsChunk.ChunkStart(Ar))
+				{
+					int32 Num = 0;
+					Ar << Num;
+					if (Objects.Num() < Num)
+						Objects.SetNum(Num);
+					while (ObjectsChunk.IsStillInChunk(Ar) && NumObjects < Num)
+					{
+						if (Ar.NextChunkIs(ObjectID))
+						{
+							// Custom data chunk is only present when not empty, so clear what was there before
+							auto& ObjData = Objects[NumObjects++];
+							ObjData.Reset();
+							ObjData.ReadFromArchive(Ar, SystemVersion.Version);
+						}
+						else
+							Ar.SkipNextChunk();
+					}
+					ObjectsChunk.ChunkEnd(Ar);
+				}
+			}
+			else
+				Ar.SkipNextChunk();
+		}
+		Ar.DataFormat = PrevFormat;
+
+		ChunkEnd(Ar);
+	}
+}
+
+int64 FSpudObjectSnapshot::EstimateSize() const
+{
+	int64 Total = 0;
+	for (int32 i = 0; i < NumObjects; ++i)
+	{
+		Total += Objects[i].EstimateSize() + FSpudChunkHeader::GetHeaderSize();
+	}
+	return Total;
+}
+
+void FSpudObjectSnapshot::Reset(int32 Num)
+{
+	Metadata.Reset();
+	// Normally set on write, but snapshots can be restored without ever being written
+	Metadata.UserDataModelVersion.Version = GCurrentUserDataModelVersion;
+	if (Objects.Num() < Num)
+		Objects.SetNum(Num);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		Objects[i].Reset();
+	}
+	NumObjects = Num;
+}
+
+void FSpudObjectSnapshot::WriteToBuffer(TArray<uint8>& OutData)
+{
+	// Size is known to within a few chunk headers & the metadata, avoid growing the buffer repeatedly
+	OutData.Reset(static_cast<int32>(FMath::Min<int64>(EstimateSize() + 1024, MAX_int32)));
+	FMemoryWriter MemWriter(OutData);
+	FSpudChunkedDataArchive ChunkedAr(MemWriter);
+	WriteToArchive(ChunkedAr);
+}
+
+bool FSpudObjectSnapshot::ReadFromBuffer(const TArray<uint8>& InData)
+{
+	FMemoryReader MemReader(InData, true);
+	FSpudChunkedDataArchive ChunkedAr(MemReader);
+	if (!ChunkedAr.NextChunkIs(GetMagic()))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Object snapshot data is invalid, it must start with a %s chunk"),
+		       *FSpudChunkHeader::MagicToString(GetMagic()));
+		return false;
+	}
+	ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+	return !ChunkedAr.IsError();
+}
 
 //------------------------------------------------------------------------------
 
-void FSpudGlobalData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+FSpudLevelSnapshot::FSpudLevelSnapshot() : Level(MakeShared<FSpudLevelData, ESPMode::ThreadSafe>())
+{
+}
+
+void FSpudLevelSnapshot::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		SystemVersion.Version = SPUD_CURRENT_SYSTEM_VERSION;
+		SystemVersion.WriteToArchive(Ar);
+		Level->WriteToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudLevelSnapshot::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		Reset(FString());
+		SystemVersion.Version = StoredSystemVersion;
+
+		const uint32 VersionID = FSpudChunkHeader::EncodeMagic(SPUDDATA_VERSIONINFO_MAGIC);
+		const uint32 LevelID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATA_MAGIC);
+		FSpudChunkHeader Hdr;
+		while (IsStillInChunk(Ar))
+		{
+			Ar.PreviewNextChunk(Hdr, true);
+			if (Hdr.Magic == VersionID)
+				SystemVersion.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == LevelID)
+				Level->ReadFromArchive(Ar, SystemVersion.Version);
+			else
+				Ar.SkipNextChunk();
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudLevelSnapshot::Reset(const FString& LevelName)
+{
+	Level->Reset();
+	Level->Name = LevelName;
+	Level->Status = LDS_Loaded;
+	// Snapshots are meant to be small, and are never restored by older versions
+	Level->Metadata.DataFormat.Version = SDF_Compact;
+	// Normally set on write, but snapshots can be restored without ever being written
+	Level->Metadata.UserDataModelVersion.Version = GCurrentUserDataModelVersion;
+}
+
+/// Whether every value in Prefix has the same index in Index
+template <typename T>
+static bool SpudIndexStartsWith(const FSpudIndex<T>& Index, const FSpudIndex<T>& Prefix)
+{
+	if (Index.UniqueValues.Num() < Prefix.UniqueValues.Num())
+		return false;
+	for (int32 i = 0; i < Prefix.UniqueValues.Num(); ++i)
+	{
+		if (!(Index.UniqueValues[i] == Prefix.UniqueValues[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool SpudIsSameObjectData(const FSpudObjectData& A, const FSpudObjectData& B)
 {
-	if (ChunkStart(Ar))
+	if (A.Components.Components.Num() != B.Components.Components.Num())
+		return false;
+	for (int32 i = 0; i < A.Components.Components.Num(); ++i)
 	{
-		Ar << CurrentLevel;
-		Metadata.WriteToArchive(Ar);
-		Objects.WriteToArchive(Ar);
-		ChunkEnd(Ar);
+		const auto& CA = A.Components.Components[i];
+		const auto& CB = B.Components.Components[i];
+		if (CA.Name != CB.Name || CA.Properties.PropertyOffsets != CB.Properties.PropertyOffsets ||
+			CA.Properties.Data != CB.Properties.Data)
+			return false;
 	}
+	return A.CoreData.Data == B.CoreData.Data &&
+		A.Properties.PropertyOffsets == B.Properties.PropertyOffsets &&
+		A.Properties.Data == B.Properties.Data &&
+		A.CustomData.Data == B.CustomData.Data;
 }
 
-void FSpudGlobalData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+int32 FSpudLevelSnapshot::RemoveUnchangedActors(const FSpudLevelSnapshot& Baseline)
 {
-	// Separate loading process since it's easier to deal with chunk robustness and versions
-	if (ChunkStart(Ar))
+	const FSpudClassMetadata& Meta = Level->Metadata;
+	const FSpudClassMetadata& BaseMeta = Baseline.Level->Metadata;
+
+	// Bytes only mean the same thing if every ID in the baseline still refers to the same name, and classes
+	// described by both have the same properties in the same order
+	bool bCompatible = Meta.GetDataFormat() == BaseMeta.GetDataFormat() &&
+		SpudIndexStartsWith(Meta.ClassNameIndex, BaseMeta.ClassNameIndex) &&
+		SpudIndexStartsWith(Meta.PropertyNameIndex, BaseMeta.PropertyNameIndex);
+	for (int32 i = 0; bCompatible && i < BaseMeta.ClassDefinitions.Values.Num(); ++i)
 	{
-		Ar << CurrentLevel;
+		const auto& BaseDef = BaseMeta.ClassDefinitions.Values[i];
+		const auto Def = Meta.GetClassDef(BaseDef->ClassName);
+		if (!Def.IsValid())
+			continue;
+		bCompatible = Def->Properties.Num() == BaseDef->Properties.Num();
+		for (int32 p = 0; bCompatible && p < Def->Properties.Num(); ++p)
+		{
+			const FSpudPropertyDef& Prop = Def->Properties[p];
+			const FSpudPropertyDef& BaseProp = BaseDef->Properties[p];
+			bCompatible = Prop.PropertyID == BaseProp.PropertyID && Prop.PrefixID == BaseProp.PrefixID &&
+				Prop.DataType == BaseProp.DataType;
+		}
+	}
+	if (!bCompatible)
+	{
+		UE_LOG(LogSpudData, Verbose, TEXT("Level snapshot baseline for %s has different class metadata, keeping all actors"),
+		       *Level->Name);
+		return 0;
+	}
 
-		const uint32 MetadataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_METADATA_MAGIC);
-		const uint32 ObjectsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALOBJECTLIST_MAGIC);
-		FSpudChunkHeader Hdr;
-		while (IsStillInChunk(Ar))
+	int32 Removed = 0;
+	for (auto It = Level->LevelActors.Contents.CreateIterator(); It; ++It)
+	{
+		const auto BaseActor = Baseline.Level->LevelActors.Contents.Find(It.Key());
+		if (BaseActor && SpudIsSameObjectData(It.Value(), *BaseActor))
 		{
-			Ar.PreviewNextChunk(Hdr, true);
-			if (Hdr.Magic == MetadataID)
-				Metadata.ReadFromArchive(Ar, StoredSystemVersion);
-			else if (Hdr.Magic == ObjectsID)
-				Objects.ReadFromArchive(Ar, StoredSystemVersion);
-			else
-				Ar.SkipNextChunk();
+			It.RemoveCurrent();
+			++Removed;
 		}
+	}
+	return Removed;
+}
 
-		ChunkEnd(Ar);
-	}	
+void FSpudLevelSnapshot::WriteToBuffer(TArray<uint8>& OutData)
+{
+	OutData.Reset(static_cast<int32>(FMath::Min<int64>(EstimateSize() + 1024, MAX_int32)));
+	FMemoryWriter MemWriter(OutData);
+	FSpudChunkedDataArchive ChunkedAr(MemWriter);
+	WriteToArchive(ChunkedAr);
 }
 
-void FSpudGlobalData::Reset()
+bool FSpudLevelSnapshot::ReadFromBuffer(const TArray<uint8>& InData)
 {
-	CurrentLevel = "";
-	Metadata.Reset();
-	Objects.Empty();
+	FMemoryReader MemReader(InData, true);
+	FSpudChunkedDataArchive ChunkedAr(MemReader);
+	if (!ChunkedAr.NextChunkIs(GetMagic()))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Level snapshot data is invalid, it must start with a %s chunk"),
+		       *FSpudChunkHeader::MagicToString(GetMagic()));
+		return false;
+	}
+	ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+	return !ChunkedAr.IsError();
 }
 
 //------------------------------------------------------------------------------
 
 void FSpudSaveInfo::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	WriteToArchive(Ar, 0);
+}
+
+void FSpudSaveInfo::WriteToArchive(FSpudChunkedDataArchive& Ar, int64 FullInfoOffset)
 {
 	if (ChunkStart(Ar))
 	{
@@ -809,16 +2238,50 @@ void FSpudSaveInfo::WriteToArchive(FSpudChunkedDataArchive& Ar)
 		FString TimestampStr = Timestamp.ToIso8601(); 
 		Ar << TimestampStr;
 
-		// This won't write anything if there isn't any screenshot data
-		Screenshot.WriteToArchive(Ar);
-		// Ditto, if no custom info this won't do anything
-		CustomInfo.WriteToArchive(Ar);
+		if (FullInfoOffset > 0)
+		{
+			// Stub, the big stuff is in the full info
+			FSpudAdhocWrapperChunk PointerChunk(SPUDDATA_SAVEINFOPOINTER_MAGIC);
+			if (PointerChunk.ChunkStart(Ar))
+			{
+				Ar << FullInfoOffset;
+				PointerChunk.ChunkEnd(Ar);
+			}
+		}
+		else
+		{
+			// This won't write anything if there isn't any screenshot data
+			Screenshot.WriteToArchive(Ar);
+			// Ditto, if no custom info this won't do anything
+			CustomInfo.WriteToArchive(Ar);
+		}
+		// Only recorded if not the default fixed width format
+		if (DataFormat.IsCompact())
+			DataFormat.WriteToArchive(Ar);
+
+		// Reserved space, skipped by readers like any other unknown chunk
+		if (PaddingSize >= FSpudChunkHeader::GetHeaderSize())
+		{
+			FSpudAdhocWrapperChunk PaddingChunk(SPUDDATA_SAVEINFOPADDING_MAGIC);
+			if (PaddingChunk.ChunkStart(Ar, 0))
+			{
+				TArray<uint8> Zeroes;
+				Zeroes.SetNumZeroed(PaddingSize - FSpudChunkHeader::GetHeaderSize());
+				Ar.Serialize(Zeroes.GetData(), Zeroes.Num());
+				PaddingChunk.ChunkEnd(Ar);
+			}
+		}
 	
 		ChunkEnd(Ar);
 	}
 }
 
 void FSpudSaveInfo::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	ReadFromArchive(Ar, StoredSystemVersion, true);
+}
+
+void FSpudSaveInfo::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion, bool bFollowPointer)
 {
 	if (ChunkStart(Ar))
 	{
@@ -830,6 +2293,11 @@ void FSpudSaveInfo::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSy
 
 		const uint32 ScreenshotID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SCREENSHOT_MAGIC);
 		const uint32 CustomInfoID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CUSTOMINFO_MAGIC);
+		const uint32 DataFormatID = FSpudChunkHeader::EncodeMagic(SPUDDATA_DATAFORMAT_MAGIC);
+		const uint32 PointerID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SAVEINFOPOINTER_MAGIC);
+		DataFormat.Version = SDF_FixedWidth;
+		RelocatedOffset = RelocatedSize = 0;
+		int64 FullInfoOffset = 0;
 		FSpudChunkHeader Hdr;
 		while (IsStillInChunk(Ar))
 		{
@@ -838,9 +2306,53 @@ void FSpudSaveInfo::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSy
 				Screenshot.ReadFromArchive(Ar, StoredSystemVersion);
 			else if (Hdr.Magic == CustomInfoID)
 				CustomInfo.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == DataFormatID)
+				DataFormat.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == PointerID)
+			{
+				FSpudAdhocWrapperChunk PointerChunk(SPUDDATA_SAVEINFOPOINTER_MAGIC);
+				if (PointerChunk.ChunkStart(Ar))
+				{
+					Ar << FullInfoOffset;
+					PointerChunk.ChunkEnd(Ar);
+				}
+			}
 			else
 				Ar.SkipNextChunk();
-		}		
+		}
+
+		if (FullInfoOffset != 0 && !bFollowPointer)
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Relocated save info points to more save info, ignoring"));
+		}
+		else if (FullInfoOffset != 0)
+		{
+			// This is a stub, the full info was moved to the end of the file when it outgrew its padding
+			const int64 StubEnd = Ar.Tell();
+			// Only ever moved forward, anything else is corrupt and could point back at this stub
+			const bool bValidOffset = FullInfoOffset > StubEnd && FullInfoOffset < Ar.TotalSize();
+			FSpudSaveInfo FullInfo;
+			if (bValidOffset)
+			{
+				Ar.Seek(FullInfoOffset);
+				FullInfo.ReadFromArchive(Ar, StoredSystemVersion, false);
+			}
+			if (!bValidOffset || Ar.IsError() || Ar.Tell() == FullInfoOffset)
+			{
+				UE_LOG(LogSpudData, Error, TEXT("Save info at offset %lld is missing, only the basic save info is available"), FullInfoOffset);
+			}
+			else
+			{
+				Title = FullInfo.Title;
+				Timestamp = FullInfo.Timestamp;
+				DataFormat = FullInfo.DataFormat;
+				CustomInfo = FullInfo.CustomInfo;
+				Screenshot.ImageData = MoveTemp(FullInfo.Screenshot.ImageData);
+				RelocatedOffset = FullInfoOffset;
+				RelocatedSize = Ar.Tell() - FullInfoOffset;
+			}
+			Ar.Seek(StubEnd);
+		}
 		ChunkEnd(Ar);
 	}
 }
@@ -850,6 +2362,7 @@ void FSpudSaveInfo::Reset()
 	Title = FText();
 	Screenshot.ImageData.Empty();
 	CustomInfo.Reset();
+	RelocatedOffset = RelocatedSize = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -874,7 +2387,7 @@ void FSpudScreenshot::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Stored
 	if (ChunkStart(Ar))
 	{
 		// This chunk ONLY contains PNG data so data size from header is this
-		ImageData.SetNum(ChunkHeader.Length);
+		ImageData.SetNum(static_cast<int32>(ChunkHeader.Length));
 		Ar.Serialize(ImageData.GetData(), ChunkHeader.Length);
 		ChunkEnd(Ar);
 	}
@@ -916,9 +2429,16 @@ void FSpudSaveCustomInfo::Reset()
 }
 
 //------------------------------------------------------------------------------
+FSpudSaveData::~FSpudSaveData()
+{
+	// Background writes refer back to this
+	WaitForBackgroundWrites();
+}
+
 void FSpudSaveData::PrepareForWrite()
 {
 	Info.SystemVersion = SPUD_CURRENT_SYSTEM_VERSION;
+	Info.DataFormat.Version = GSpudDataFormat;
 }
 
 void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar)
@@ -926,24 +2446,58 @@ void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 	WriteToArchive(Ar, "");
 }
 
+int64 FSpudSaveData::EstimateLevelDataSize(const FString& LevelPath)
+{
+	IFileManager& FileMgr = IFileManager::Get();
+	int64 Total = 0;
+	FSpudScopeLock MapLock(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
+	for (auto&& KV : LevelDataMap)
+	{
+		auto& LevelData = KV.Value;
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+		if (LevelData->Status == LDS_Unloaded)
+		{
+			// Will be piped in from the file as-is
+			Total += FMath::Max(FileMgr.FileSize(*GetLevelDataPath(LevelPath, LevelData->Name)), static_cast<int64>(0));
+		}
+		else if (LevelData->Status == LDS_Compressed)
+		{
+			Total += LevelData->UncompressedSize;
+		}
+		else
+		{
+			Total += LevelData->EstimateSize() + FSpudChunkHeader::GetHeaderSize();
+		}
+	}
+	return Total;
+}
+
 void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& LevelPath)
 {
-	if (ChunkStart(Ar))
+	// Sizes are needed up-front to know if we need large chunk headers for the containers
+	const int64 LevelDataSize = EstimateLevelDataSize(LevelPath);
+	if (ChunkStart(Ar, LevelDataSize + GlobalData.EstimateSize()))
 	{
+		// Room to change the info later without rewriting everything else
+		Info.PaddingSize = GSpudSaveInfoPadding;
 		Info.WriteToArchive(Ar);	
 		GlobalData.WriteToArchive(Ar);
 
 		// Manually write the level data because its source could be memory, or piped in from files
 		FSpudAdhocWrapperChunk LevelDataMapChunk(SPUDDATA_LEVELDATAMAP_MAGIC);
-		if (LevelDataMapChunk.ChunkStart(Ar))
+		if (LevelDataMapChunk.ChunkStart(Ar, LevelDataSize))
 		{
-			FScopeLock MapLock(&LevelDataMapMutex);
-			for (auto&& KV : LevelDataMap)
+			FSpudScopeLock MapLock(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
+			TArray<FString> LevelNames;
+			LevelDataMap.GetKeys(LevelNames);
+			if (GSpudCanonicalOutput)
+				LevelNames.Sort();
+			for (const auto& LevelName : LevelNames)
 			{
-				auto& LevelData = KV.Value;
+				auto& LevelData = LevelDataMap.FindChecked(LevelName);
 				// Lock outer so the status check write/copy are all locked together
 				// FCriticalSection is recursive (already locked by same thread is fine)
-				FScopeLock LevelLock(&LevelData->Mutex);
+				FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
 				
 				// For level data that's not loaded, we pipe data directly from the serialized file into
 				switch (LevelData->Status)
@@ -954,6 +2508,20 @@ void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& L
 					// In memory, just write
 					LevelData->WriteToArchive(Ar);
 					break;
+				case LDS_Compressed:
+					{
+						// Already a complete level chunk once decompressed
+						TArray<uint8> Chunk;
+						if (LevelData->DecompressChunk(Chunk))
+						{
+							Ar.Serialize(Chunk.GetData(), Chunk.Num());
+						}
+						else
+						{
+							UE_LOG(LogSpudData, Error, TEXT("Level %s could not be decompressed. This level will be missing from the save"), *LevelData->Name);
+						}
+						break;
+					}
 				case LDS_Unloaded:
 					// This level data is not in memory. We want to pipe level data directly from the level file into
 					// the combined archive so it doesn't have to go through memory
@@ -1023,7 +2591,7 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLe
 				if (LevelDataMapChunk.ChunkStart(Ar))
 				{
 					{
-						FScopeLock MapMutex(&LevelDataMapMutex);					
+						FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);					
 						LevelDataMap.Empty();
 					}
 
@@ -1038,7 +2606,7 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLe
 								TLevelDataPtr LvlData(new FSpudLevelData());
 								LvlData->ReadFromArchive(Ar, Info.SystemVersion);
 								{
-									FScopeLock MapMutex(&LevelDataMapMutex);					
+									FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);					
 									LevelDataMap.Add(LvlData->Key(), LvlData);
 								}
 							}
@@ -1047,21 +2615,20 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLe
 								// Pipe data for this level into its own file rather than load it
 								// We need to know the level name though
 								FString LevelName;
-								int64 LevelDataSize;
-								if (FSpudLevelData::ReadLevelInfoFromArchive(Ar, true, LevelName, LevelDataSize))
+								int64 LevelChunkSize;
+								if (FSpudLevelData::ReadLevelInfoFromArchive(Ar, true, LevelName, LevelChunkSize))
 								{
 									IFileManager& FileMgr = IFileManager::Get();
 									auto OutLevelArchive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*GetLevelDataPath(LevelPath, LevelName)));
 
-									int64 TotalSize = LevelDataSize + FSpudChunkHeader::GetHeaderSize();
-									SpudCopyArchiveData(Ar, *OutLevelArchive.Get(), TotalSize);
+									SpudCopyArchiveData(Ar, *OutLevelArchive.Get(), LevelChunkSize);
 									OutLevelArchive->Close();
 									
                                     TLevelDataPtr LvlData(new FSpudLevelData());
 									LvlData->Name = LevelName;
 									LvlData->Status = LDS_Unloaded;
 									{
-										FScopeLock MapMutex(&LevelDataMapMutex);					
+										FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);					
 										LevelDataMap.Add(LvlData->Key(), LvlData);
 									}
 								}
@@ -1101,13 +2668,71 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSy
 	ReadFromArchive(Ar, true, "");
 }
 
+void FSpudSaveData::WriteGlobalsToArchive(FSpudChunkedDataArchive& Ar, const FDateTime& Timestamp)
+{
+	if (ChunkStart(Ar, GlobalData.EstimateSize()))
+	{
+		// Info is still that of the last full save, which is what globals saves are compared with when loading
+		FSpudSaveInfo GlobalsInfo = Info;
+		GlobalsInfo.Timestamp = Timestamp;
+		// Globals saves are replaced wholesale, no need to reserve space
+		GlobalsInfo.PaddingSize = 0;
+		GlobalsInfo.WriteToArchive(Ar);
+		GlobalData.WriteToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+bool FSpudSaveData::ReadGlobalsFromArchive(FSpudChunkedDataArchive& Ar)
+{
+	bool bReplaced = false;
+	if (ChunkStart(Ar))
+	{
+		if (!Ar.NextChunkIs(SPUDDATA_SAVEINFO_MAGIC))
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Globals save %s is corrupt, first chunk MUST be the INFO chunk."), *Ar.GetArchiveName());
+			ChunkEnd(Ar);
+			return false;
+		}
+
+		FSpudSaveInfo GlobalsInfo;
+		GlobalsInfo.ReadFromArchive(Ar, 0);
+		if (GlobalsInfo.Timestamp <= Info.Timestamp)
+		{
+			// Superseded by a full save
+			UE_LOG(LogSpudData, Verbose, TEXT("Globals save %s is older than the full save, ignoring"), *Ar.GetArchiveName());
+			ChunkEnd(Ar);
+			return false;
+		}
+
+		const uint32 GlobalDataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALDATA_MAGIC);
+		while (IsStillInChunk(Ar))
+		{
+			if (Ar.NextChunkIs(GlobalDataID))
+			{
+				const FString CurrentLevel = GlobalData.CurrentLevel;
+				GlobalData.Reset();
+				GlobalData.ReadFromArchive(Ar, GlobalsInfo.SystemVersion);
+				GlobalData.CurrentLevel = CurrentLevel;
+				bReplaced = true;
+			}
+			else
+			{
+				Ar.SkipNextChunk();
+			}
+		}
+		ChunkEnd(Ar);
+	}
+	return bReplaced;
+}
+
 
 void FSpudSaveData::Reset()
 {
 	Info.Reset();
 	GlobalData.Reset();
 	{
-		FScopeLock MapMutex(&LevelDataMapMutex);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
 		LevelDataMap.Empty();
 	}
 }
@@ -1119,7 +2744,7 @@ FSpudSaveData::TLevelDataPtr FSpudSaveData::CreateLevelData(const FString& Level
 	NewLevelData->Status = LDS_Loaded; // assume loaded if we're creating
 
 	{
-		FScopeLock MapMutex(&LevelDataMapMutex);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
 		LevelDataMap.Add(LevelName, NewLevelData);
 	}
 	
@@ -1147,11 +2772,86 @@ FString FSpudSaveData::GetLevelDataPath(const FString& LevelPath, const FString&
 	return FString::Printf(TEXT("%s%s.lvl"), *LevelPath, *LevelName);		
 }
 
-void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath)
+void FSpudSaveData::WriteCompressedLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath)
 {
+	FSpudScopeLock Lock(&LevelData.Mutex, &GSpudLevelLockStats);
+	TArray<uint8> Chunk;
+	if (!LevelData.DecompressChunk(Chunk))
+	{
+		// Nothing we can do with it now
+		LevelData.ReleaseMemory();
+		return;
+	}
+
 	IFileManager& FileMgr = IFileManager::Get();
 	const FString Filename = GetLevelDataPath(LevelPath, LevelName);
 	const auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*Filename));
+	if (Archive)
+	{
+		Archive->Serialize(Chunk.GetData(), Chunk.Num());
+		Archive->Close();
+		if (Archive->IsError() || Archive->IsCriticalError())
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Error while writing level data to %s"), *Filename);
+		}
+	}
+	else
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error opening level data file for writing: %s"), *Filename);
+	}
+	LevelData.ReleaseMemory();
+}
+
+void FSpudSaveData::EnforceCompressedLevelDataBudget(const FString& LevelPath)
+{
+	FSpudScopeLock MapLock(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
+
+	int64 Total = 0;
+	TArray<TPair<uint64, TLevelDataPtr>> Compressed;
+	for (auto&& KV : LevelDataMap)
+	{
+		auto& LevelData = KV.Value;
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+		if (LevelData->Status == LDS_Compressed)
+		{
+			Total += LevelData->CompressedData.Num();
+			Compressed.Add(TPair<uint64, TLevelDataPtr>(LevelData->CompressedSequence, LevelData));
+		}
+	}
+	if (Total <= GSpudCompressedLevelDataBudget)
+		return;
+
+	// Oldest first
+	Compressed.Sort([](const TPair<uint64, TLevelDataPtr>& A, const TPair<uint64, TLevelDataPtr>& B)
+	{
+		return A.Key < B.Key;
+	});
+	for (auto& Pair : Compressed)
+	{
+		if (Total <= GSpudCompressedLevelDataBudget)
+			break;
+
+		auto& LevelData = Pair.Value;
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+		// May have been loaded again since we looked
+		if (LevelData->Status != LDS_Compressed)
+			continue;
+		
+		Total -= LevelData->CompressedData.Num();
+		UE_LOG(LogSpudData, Verbose, TEXT("Compressed level data over budget, writing %s to disk"), *LevelData->Name);
+		WriteCompressedLevelData(*LevelData, LevelData->Name, LevelPath);
+	}
+}
+
+void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath)
+{
+	IFileManager& FileMgr = IFileManager::Get();
+	const FString Filename = GetLevelDataPath(LevelPath, LevelName);
+	// Blobs which were never requested are still only in the old level file, so write alongside it & then replace it
+	FSpudScopeLock Lock(&LevelData.Mutex, &GSpudLevelLockStats);
+	const bool bViaTempFile = LevelData.Blobs.HasUnloadedPayloads();
+	const FString WriteFilename = bViaTempFile ? Filename + TEXT(".tmp") : Filename;
+	const auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*WriteFilename));
 
 	if (Archive)
 	{
@@ -1162,7 +2862,11 @@ void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& Lev
 
 		if (ChunkedAr.IsError() || ChunkedAr.IsCriticalError())
 		{
-			UE_LOG(LogSpudData, Error, TEXT("Error while writing level data to %s"), *Filename);
+			UE_LOG(LogSpudData, Error, TEXT("Error while writing level data to %s"), *WriteFilename);
+		}
+		else if (bViaTempFile && !FileMgr.Move(*Filename, *WriteFilename, true, true))
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Error replacing level data %s"), *Filename);
 		}
 	}
 	else
@@ -1195,21 +2899,134 @@ bool FSpudSaveData::ReadSaveInfoFromArchive(FSpudChunkedDataArchive& Ar, FSpudSa
 	
 }
 
+/// Serialise save info to exactly TotalSize bytes by padding it. Returns false if it doesn't fit
+static bool SpudWriteSaveInfoExactSize(FSpudSaveInfo& Info, int64 FullInfoOffset, int64 TotalSize, TArray<uint8>& Out)
+{
+	auto Write = [&]()
+	{
+		Out.Reset();
+		FMemoryWriter MemAr(Out);
+		FSpudChunkedDataArchive ChunkedAr(MemAr);
+		Info.WriteToArchive(ChunkedAr, FullInfoOffset);
+	};
+
+	Info.PaddingSize = 0;
+	Write();
+	const int64 Slack = TotalSize - Out.Num();
+	if (Slack == 0)
+		return true;
+	// The padding chunk needs at least room for its header
+	if (Slack < FSpudChunkHeader::GetHeaderSize())
+		return false;
+
+	Info.PaddingSize = Slack;
+	Write();
+	return Out.Num() == TotalSize;
+}
+
+/// Overwrite part of an existing file in place, then optionally truncate the file to NewFileSize
+static bool SpudWriteFileRegion(const FString& Filename, int64 Offset, const TArray<uint8>& Data, int64 NewFileSize = -1)
+{
+	// Opened for append only so the existing contents are kept; every write is positioned explicitly on the handle,
+	// and checked to have landed there
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*Filename, true, true));
+	if (!Handle)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error opening %s for writing save info"), *Filename);
+		return false;
+	}
+	if (!Handle->Seek(Offset) || !Handle->Write(Data.GetData(), Data.Num()) || Handle->Tell() != Offset + Data.Num())
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error writing save info to %s at offset %lld"), *Filename, Offset);
+		return false;
+	}
+	if (NewFileSize >= 0 && !Handle->Truncate(NewFileSize))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error truncating %s to %lld bytes"), *Filename, NewFileSize);
+		return false;
+	}
+	return Handle->Flush();
+}
+
+bool FSpudSaveData::UpdateSaveInfoInFile(const FString& Filename, TFunctionRef<void(FSpudSaveInfo&)> Update)
+{
+	FSpudSaveInfo Info;
+	int64 InfoStart, InfoSize, FileSize;
+	{
+		auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+		if (!Archive)
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Unable to open %s for reading save info"), *Filename);
+			return false;
+		}
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		if (!ReadSaveInfoFromArchive(ChunkedAr, Info))
+			return false;
+		// The info at the start of the file, which may be a stub
+		InfoStart = Info.ChunkHeaderStart;
+		InfoSize = Info.ChunkDataEnd - Info.ChunkHeaderStart;
+		FileSize = Archive->TotalSize();
+	}
+
+	Update(Info);
+
+	// A previously relocated info is the last thing in the file, so its space can be given back or reused freely.
+	// If anything has been appended after it, it's left alone (and only reused if the new info is the same size)
+	const bool bRelocatedAtEnd = Info.RelocatedOffset > 0 && Info.RelocatedOffset + Info.RelocatedSize == FileSize;
+
+	// Usually it'll fit back where it was (if it was relocated, this moves it back and drops the relocated copy)
+	TArray<uint8> InfoData;
+	if (SpudWriteSaveInfoExactSize(Info, 0, InfoSize, InfoData))
+		return SpudWriteFileRegion(Filename, InfoStart, InfoData, bRelocatedAtEnd ? Info.RelocatedOffset : -1);
+
+	// Otherwise the full info goes at the end, replacing the previous relocated copy if possible
+	int64 FullInfoOffset = FileSize;
+	int64 NewFileSize = -1;
+	if (Info.RelocatedOffset > 0 && SpudWriteSaveInfoExactSize(Info, 0, Info.RelocatedSize, InfoData))
+	{
+		FullInfoOffset = Info.RelocatedOffset;
+	}
+	else
+	{
+		Info.PaddingSize = GSpudSaveInfoPadding;
+		InfoData.Reset();
+		FMemoryWriter MemAr(InfoData);
+		FSpudChunkedDataArchive ChunkedAr(MemAr);
+		Info.WriteToArchive(ChunkedAr, 0);
+		if (bRelocatedAtEnd)
+		{
+			FullInfoOffset = Info.RelocatedOffset;
+			NewFileSize = FullInfoOffset + InfoData.Num();
+		}
+	}
+
+	TArray<uint8> StubData;
+	if (!SpudWriteSaveInfoExactSize(Info, FullInfoOffset, InfoSize, StubData))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Unable to update save info in %s, even the title doesn't fit in the space reserved for it"), *Filename);
+		return false;
+	}
+	// Full info first, so that the stub never points at nothing
+	UE_LOG(LogSpudData, Verbose, TEXT("Save info in %s outgrew its padding, moved to offset %lld"), *Filename, FullInfoOffset);
+	return SpudWriteFileRegion(Filename, FullInfoOffset, InfoData, NewFileSize) &&
+		SpudWriteFileRegion(Filename, InfoStart, StubData);
+}
 
-FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath)
+FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath, int64* OutBytesRead)
 {
 	TLevelDataPtr Ret;
 	{
 		// Only lock the map while looking up
 		// We get a shared pointer back (threadsafe) and lock its own mutex before changing the instance state
-		FScopeLock MapMutex(&LevelDataMapMutex);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
 		const auto Found = LevelDataMap.Find(LevelName);
 		if (Found)
 			Ret = *Found;
 	}
 	if (Ret.IsValid() && bLoadIfNeeded)
 	{
-		FScopeLock LevelLock(&Ret->Mutex);
+		FSpudScopeLock LevelLock(&Ret->Mutex, &GSpudLevelLockStats);
 		switch (Ret->Status)
 		{
 		case LDS_Unloaded:
@@ -1222,10 +3039,14 @@ FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelNam
 				if (Archive)
 				{
 					FSpudChunkedDataArchive ChunkedAr(*Archive);
+					// Blobs stay in the file until requested
+					ChunkedAr.LazyBlobSource = Filename;
 
 					// We have to assume that leveldata has been upgraded at load time if system version was incorrect
 					Ret->ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
 					ChunkedAr.Close();
+					if (OutBytesRead)
+						*OutBytesRead += ChunkedAr.BytesRead;
 
 					if (ChunkedAr.IsError() || ChunkedAr.IsCriticalError())
 					{
@@ -1238,6 +3059,14 @@ FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelNam
 				}
 				break;
 			}
+		case LDS_Compressed:
+			// Still in memory, just needs decoding
+			if (!Ret->Decompress())
+			{
+				UE_LOG(LogSpudData, Error, TEXT("Error decompressing level data for %s, state has been lost"), *LevelName);
+				Ret->ReleaseMemory();
+			}
+			break;
 		case LDS_BackgroundWriteAndUnload:
 			// Loading in this state is just flipping back to loaded, because all the state is still in memory
 			// We're just waiting for it to be written out and released
@@ -1256,19 +3085,50 @@ FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelNam
 
 void FSpudSaveData::WriteAndReleaseAllLevelData(const FString& LevelPath)
 {
-	FScopeLock MapLock(&LevelDataMapMutex);
+	FSpudScopeLock MapLock(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
 	for (auto && Pair : LevelDataMap)
 	{
-		WriteAndReleaseLevelData(Pair.Key, LevelPath, true);
+		// Everything goes to disk here, including levels which were only compressed
+		auto& LevelData = Pair.Value;
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+		switch (LevelData->Status)
+		{
+		case LDS_Loaded:
+		case LDS_BackgroundWriteAndUnload:
+			WriteLevelData(*LevelData, Pair.Key, LevelPath);
+			LevelData->ReleaseMemory();
+			break;
+		case LDS_Compressed:
+			WriteCompressedLevelData(*LevelData, Pair.Key, LevelPath);
+			break;
+		default:
+		case LDS_Unloaded:
+			break;
+		}
+	}
+}
+
+bool FSpudSaveData::PageOutLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath)
+{
+	FSpudScopeLock LevelLock(&LevelData.Mutex, &GSpudLevelLockStats);
+	if (GSpudCompressedLevelDataBudget > 0)
+	{
+		LevelData.CompressedSequence = NextCompressedSequence++;
+		if (LevelData.Compress())
+			return true;
 	}
+	WriteLevelData(LevelData, LevelName, LevelPath);
+	LevelData.ReleaseMemory();
+	return false;
 }
 
 bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FString& LevelPath, bool bBlocking)
 {
 	auto LevelData = GetLevelData(LevelName, false, "");
+	bool bPagedOut = false;
 	if (LevelData.IsValid())
 	{
-		FScopeLock LevelLock(&LevelData->Mutex);
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
 		if (LevelData->Status == LDS_Loaded ||
 			// If we've queued a background write & unload but this is now requesting a blocking write, we
 			// should upgrade it and do it NOW. When the status is changed to LDS_Unloaded the background worker will ignore it
@@ -1276,8 +3136,8 @@ bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FSt
 		{
 			if (bBlocking)
 			{
-				WriteLevelData(*LevelData, LevelName, LevelPath);
-				LevelData->ReleaseMemory();
+				PageOutLevelData(*LevelData, LevelName, LevelPath);
+				bPagedOut = true;
 			}
 			else
 			{
@@ -1296,32 +3156,52 @@ bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FSt
 				
 				LevelData->Status = LDS_BackgroundWriteAndUnload;
 
-				// Write this level data to disk in a background thread
+				// Write this level data to disk (or compress it) in a background thread
 				// Only pass the level name and not the pointer, this is then safe from the list being cleared
-				AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, LevelName, LevelPath]()
+				++PendingBackgroundWrites;
+				const uint64 QueuedCycles = FPlatformTime::Cycles64();
+				AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, LevelName, LevelPath, QueuedCycles]()
                 {
 					auto LevelData = GetLevelData(LevelName, false, "");
+					bool bReleased = false;
                     if (LevelData.IsValid())
                     {
 	                    // Re-acquire lock and check still unloading
-                        FScopeLock LevelLock(&LevelData->Mutex);
+                        FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
                         if (LevelData->Status == LDS_BackgroundWriteAndUnload)
                         {
-                            WriteLevelData(*LevelData, LevelName, LevelPath);
-                            LevelData->ReleaseMemory();
+                            PageOutLevelData(*LevelData, LevelName, LevelPath);
+                            bReleased = true;
                         }
                     }
+					// Level lock must be released first, budget takes the map lock
+					if (bReleased)
+						EnforceCompressedLevelDataBudget(LevelPath);
+					if (GSpudCollectContentionStats.load(std::memory_order_relaxed))
+						GSpudBackgroundWriteStats.Add(FPlatformTime::Cycles64() - QueuedCycles);
+					--PendingBackgroundWrites;
                 });
 			}
 		}
 	}
+	// Also picks up the budget having been reduced since other levels were compressed
+	if (bPagedOut)
+		EnforceCompressedLevelDataBudget(LevelPath);
 	return true;
 }
 
+void FSpudSaveData::WaitForBackgroundWrites()
+{
+	while (PendingBackgroundWrites > 0)
+	{
+		FPlatformProcess::Sleep(0.001f);
+	}
+}
+
 void FSpudSaveData::DeleteLevelData(const FString& LevelName, const FString& LevelPath)
 {
 	{
-		FScopeLock MapMutex(&LevelDataMapMutex);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex, &GSpudLevelDataMapLockStats);
 		LevelDataMap.Remove(LevelName);
 	}
 
@@ -1367,4 +3247,42 @@ int64 SpudCopyArchiveData(FArchive& InArchive, FArchive& OutArchive, int64 Lengt
 		UE_LOG(LogSpudData, Error, TEXT("Cannot copy archive data from %s to %s, mismatched loading/saving status"), *InArchive.GetArchiveName(), *OutArchive.GetArchiveName());
 	}
 	return BytesCopied;
-}
\ No newline at end of file
+}
+
+void SpudWriteVarUInt(FArchive& Ar, uint64 Value)
+{
+	do
+	{
+		uint8 Byte = Value & 0x7F;
+		Value >>= 7;
+		if (Value)
+			Byte |= 0x80;
+		Ar << Byte;
+	} while (Value);
+}
+
+uint64 SpudReadVarUInt(FArchive& Ar)
+{
+	uint64 Value = 0;
+	// 10 bytes max for 64 bits, stop there if data is corrupt
+	for (int Shift = 0; Shift < 64; Shift += 7)
+	{
+		uint8 Byte = 0;
+		Ar << Byte;
+		Value |= static_cast<uint64>(Byte & 0x7F) << Shift;
+		if (!(Byte & 0x80) || Ar.IsError())
+			break;
+	}
+	return Value;
+}
+
+void SpudWriteVarInt(FArchive& Ar, int64 Value)
+{
+	SpudWriteVarUInt(Ar, (static_cast<uint64>(Value) << 1) ^ static_cast<uint64>(Value >> 63));
+}
+
+int64 SpudReadVarInt(FArchive& Ar)
+{
+	const uint64 ZigZag = SpudReadVarUInt(Ar);
+	return static_cast<int64>(ZigZag >> 1) ^ -static_cast<int64>(ZigZag & 1);
+}
@@ -1,6 +1,7 @@
 #include "SpudPropertyUtil.h"
 #include <limits>
 #include "ISpudObject.h"
+#include "Misc/ScopeRWLock.h"
 
 DEFINE_LOG_CATEGORY(LogSpudProps)
 
@@ -27,14 +28,13 @@ bool SpudPropertyUtil::IsPropertySupported(FProperty* Property)
 
 bool SpudPropertyUtil::IsValidArrayType(FArrayProperty* AProp)
 {
-	// We cannot support arrays of custom structs
-	// This is because we're relying on iterating through the UObject's properties and looking up from the state data,
-	// and to support this with all the issues of backwards compatibility would require such detailed offset data that
-	// it would make the whole thing very unwieldy. Arrays can only be primitive types or builtin structs
-	if (const auto SProp = CastField<FStructProperty>(AProp->Inner))
+	// Arrays of custom structs can't be visited property by property like single structs, since the class def would
+	// need an entry per element. Instead they're stored as columns with their own layout, which is only possible if
+	// every leaf field is plain data or a string
+	// Blittable structs don't need this since they're stored as a single value
+	if (IsCustomStructProperty(AProp->Inner))
 	{
-		if (!IsBuiltInStructProperty(SProp))
-			return false;
+		return GetColumnarStructLayout(CastFieldChecked<FStructProperty>(AProp->Inner)->Struct) != nullptr;
 	}
 	else if (IsNestedUObjectProperty(AProp->Inner))
 	{
@@ -58,11 +58,415 @@ bool SpudPropertyUtil::IsCustomStructProperty(const FProperty* Property)
 {
 	if (const auto SProp = CastField<FStructProperty>(Property))
 	{
-		return !IsBuiltInStructProperty(SProp);
+		return !IsBuiltInStructProperty(SProp) && !IsBlittableStruct(SProp->Struct);
 	}
 	return false;
 }
 
+TMap<const UScriptStruct*, TSharedPtr<const FSpudStructLayout>>& SpudPropertyUtil::GetBlittableStructs()
+{
+	static TMap<const UScriptStruct*, TSharedPtr<const FSpudStructLayout>> BlittableStructs;
+	return BlittableStructs;
+}
+
+FRWLock& SpudPropertyUtil::GetStructLayoutLock()
+{
+	static FRWLock Lock;
+	return Lock;
+}
+
+bool SpudPropertyUtil::RegisterBlittableStruct(const UScriptStruct* Struct)
+{
+	if (!Struct)
+		return false;
+
+	auto Layout = MakeShared<FSpudStructLayout>();
+	Layout->StructName = Struct->GetPathName();
+	Layout->Size = Struct->GetStructureSize();
+	// Used to find where bools live, since they can be bitfields
+	TArray<uint8> ProbeBuffer;
+	ProbeBuffer.SetNumZeroed(Layout->Size);
+	if (!BuildStructLayout(Struct, FString(), 0, ProbeBuffer, *Layout))
+	{
+		UE_LOG(LogSpudProps, Error, TEXT("Cannot register %s as blittable, it contains properties which are not plain data"), *Layout->StructName);
+		return false;
+	}
+	Layout->CalculateHash();
+	FWriteScopeLock Lock(GetStructLayoutLock());
+	GetBlittableStructs().Add(Struct, Layout);
+	return true;
+}
+
+void SpudPropertyUtil::UnregisterBlittableStruct(const UScriptStruct* Struct)
+{
+	FWriteScopeLock Lock(GetStructLayoutLock());
+	GetBlittableStructs().Remove(Struct);
+}
+
+bool SpudPropertyUtil::IsBlittableStruct(const UScriptStruct* Struct)
+{
+	FReadScopeLock Lock(GetStructLayoutLock());
+	return GetBlittableStructs().Contains(Struct);
+}
+
+bool SpudPropertyUtil::IsBlittableStructProperty(const FProperty* Property)
+{
+	if (const auto SProp = CastField<FStructProperty>(Property))
+	{
+		return IsBlittableStruct(SProp->Struct);
+	}
+	return false;
+}
+
+TSharedPtr<const FSpudStructLayout> SpudPropertyUtil::GetBlittableStructLayout(const UScriptStruct* Struct)
+{
+	// Shared so the layout outlives the lock, even if the struct is registered again or unregistered while in use
+	FReadScopeLock Lock(GetStructLayoutLock());
+	const auto Found = GetBlittableStructs().Find(Struct);
+	return Found ? *Found : TSharedPtr<const FSpudStructLayout>();
+}
+
+TMap<const UScriptStruct*, TSharedPtr<FSpudStructLayout>>& SpudPropertyUtil::GetColumnarStructs()
+{
+	static TMap<const UScriptStruct*, TSharedPtr<FSpudStructLayout>> ColumnarStructs;
+	return ColumnarStructs;
+}
+
+const FSpudStructLayout* SpudPropertyUtil::GetColumnarStructLayout(const UScriptStruct* Struct)
+{
+	if (!Struct)
+		return nullptr;
+
+	// Cache ineligible structs too, this is asked every time a class with the array is visited
+	// Layouts are shared pointers and never removed, so they stay valid after the lock is released
+	{
+		FReadScopeLock Lock(GetStructLayoutLock());
+		if (const auto Existing = GetColumnarStructs().Find(Struct))
+			return Existing->Get();
+	}
+
+	auto Layout = MakeShared<FSpudStructLayout>();
+	Layout->StructName = Struct->GetPathName();
+	Layout->Size = Struct->GetStructureSize();
+	TArray<uint8> ProbeBuffer;
+	ProbeBuffer.SetNumZeroed(Layout->Size);
+	if (!BuildStructLayout(Struct, FString(), 0, ProbeBuffer, *Layout, true))
+	{
+		UE_LOG(LogSpudProps, Warning, TEXT("Arrays of %s cannot be stored, it contains properties which are not plain data or strings"),
+		       *Layout->StructName);
+		FWriteScopeLock Lock(GetStructLayoutLock());
+		GetColumnarStructs().FindOrAdd(Struct);
+		return nullptr;
+	}
+	Layout->CalculateHash();
+	// Another thread may have got there first, in which case use theirs
+	FWriteScopeLock Lock(GetStructLayoutLock());
+	return GetColumnarStructs().FindOrAdd(Struct, Layout).Get();
+}
+
+bool SpudPropertyUtil::BuildStructLayout(const UStruct* Struct, const FString& NamePrefix, uint32 BaseOffset,
+                                         TArray<uint8>& ProbeBuffer, FSpudStructLayout& Layout, bool bAllowStrings)
+{
+	for (TFieldIterator<FProperty> PIT(Struct, EFieldIteratorFlags::IncludeSuper); PIT; ++PIT)
+	{
+		const FProperty* Property = *PIT;
+		const FString Name = NamePrefix + Property->GetName();
+		const uint32 Offset = BaseOffset + Property->GetOffset_ForInternal();
+
+		if (const auto SProp = CastField<FStructProperty>(Property))
+		{
+			if (Property->ArrayDim != 1 ||
+				!BuildStructLayout(SProp->Struct, Name + TEXT("."), Offset, ProbeBuffer, Layout, bAllowStrings))
+				return false;
+			continue;
+		}
+
+		FSpudStructLayoutField Field;
+		Field.Name = Name;
+		Field.TypeName = Property->GetClass()->GetName();
+		Field.Offset = Offset;
+		Field.Size = Property->GetSize();
+
+		if (const auto BProp = CastField<FBoolProperty>(Property))
+		{
+			if (Property->ArrayDim != 1)
+				return false;
+			// Set the bool in an empty buffer to find which byte & bit(s) it uses
+			uint8* ContainerPtr = ProbeBuffer.GetData() + BaseOffset;
+			BProp->SetPropertyValue_InContainer(ContainerPtr, true);
+			for (int32 i = 0; i < ProbeBuffer.Num(); ++i)
+			{
+				if (ProbeBuffer[i])
+				{
+					Field.Offset = i;
+					Field.Size = 1;
+					Field.BoolMask = ProbeBuffer[i];
+					ProbeBuffer[i] = 0;
+					break;
+				}
+			}
+		}
+		else if (const auto EProp = CastField<FEnumProperty>(Property))
+		{
+			Field.TypeName = EProp->GetEnum() ? EProp->GetEnum()->GetName() : Field.TypeName;
+		}
+		else if (bAllowStrings && (Property->IsA<FStrProperty>() || Property->IsA<FNameProperty>()))
+		{
+			if (Property->ArrayDim != 1)
+				return false;
+		}
+		else if (!Property->IsA<FNumericProperty>())
+		{
+			UE_LOG(LogSpudProps, Verbose, TEXT("Property %s of type %s is not plain data"), *Name, *Field.TypeName);
+			return false;
+		}
+		Layout.Fields.Add(Field);
+	}
+	return true;
+}
+
+void SpudPropertyUtil::WriteBlittableStructPropertyData(FStructProperty* SProp,
+                                                        uint32 PrefixID,
+                                                        const void* Data,
+                                                        bool bIsArrayElement,
+                                                        int Depth,
+                                                        TSharedPtr<FSpudClassDef> ClassDef,
+                                                        TArray<uint32>& PropertyOffsets,
+                                                        FSpudClassMetadata& Meta,
+                                                        FArchive& Out)
+{
+	const TSharedPtr<const FSpudStructLayout> Layout = GetBlittableStructLayout(SProp->Struct);
+	check(Layout);
+	if (!bIsArrayElement)
+		RegisterProperty(SProp, PrefixID, ClassDef, PropertyOffsets, Meta, Out);
+
+	// Layout goes in the metadata once, so the data can be converted if the struct changes later
+	if (!Meta.StructLayouts.Contents.Contains(Layout->LayoutHash))
+		Meta.StructLayouts.Contents.Add(Layout->LayoutHash, *Layout);
+
+	// Data is the layout hash, then size, then the memory block, from a copy without padding so identical state is
+	// stored identically
+	TArray<uint8, TInlineAllocator<256>> Block;
+	Block.SetNumUninitialized(Layout->Size);
+	FMemory::Memcpy(Block.GetData(), Data, Layout->Size);
+	Layout->ZeroPadding(Block.GetData());
+	uint32 LayoutHash = Layout->LayoutHash;
+	WriteRaw(LayoutHash, Out);
+	WriteEncoded(Layout->Size, Out, Meta);
+	Out.Serialize(Block.GetData(), Layout->Size);
+	UE_LOG(LogSpudProps, Verbose, TEXT("%s = [%u bytes]"), *GetLogPrefix(SProp, Depth), Layout->Size);
+}
+
+bool SpudPropertyUtil::TryReadBlittableStructPropertyData(FStructProperty* SProp, void* Data,
+                                                          const FSpudPropertyDef& StoredProperty, int Depth,
+                                                          const FSpudClassMetadata& Meta, FArchive& In)
+{
+	const TSharedPtr<const FSpudStructLayout> Layout = GetBlittableStructLayout(SProp->Struct);
+	if (!Layout || !StoredPropertyTypeMatchesRuntime(SProp, StoredProperty, true))
+		return false;
+
+	uint32 LayoutHash;
+	uint32 Size;
+	ReadRaw(LayoutHash, In);
+	ReadEncoded(Size, In, Meta);
+
+	if (LayoutHash == Layout->LayoutHash && Size == Layout->Size)
+	{
+		// Layout unchanged, read straight into the struct
+		In.Serialize(Data, Size);
+		UE_LOG(LogSpudProps, Verbose, TEXT("%s = [%u bytes]"), *GetLogPrefix(SProp, Depth), Size);
+		return true;
+	}
+
+	// Layout has changed since this was stored, convert field by field
+	TArray<uint8> OldData;
+	OldData.SetNumUninitialized(Size);
+	In.Serialize(OldData.GetData(), Size);
+	if (const auto OldLayout = Meta.StructLayouts.Contents.Find(LayoutHash))
+	{
+		UE_LOG(LogSpudProps, Verbose, TEXT("%s = [%u bytes, converted from old layout]"), *GetLogPrefix(SProp, Depth), Size);
+		ConvertBlittableStructData(*OldLayout, OldData.GetData(), *Layout, static_cast<uint8*>(Data));
+	}
+	else
+	{
+		UE_LOG(LogSpudProps, Error, TEXT("Unable to restore %s, stored layout of %s not found"), *SProp->GetName(), *Layout->StructName);
+	}
+	// Either way the data has been consumed
+	return true;
+}
+
+void SpudPropertyUtil::WriteColumnarStructArrayData(FStructProperty* SProp,
+                                                    FScriptArrayHelper& ArrayHelper,
+                                                    int32 NumElements,
+                                                    int Depth,
+                                                    FSpudClassMetadata& Meta,
+                                                    FArchive& Out)
+{
+	const FSpudStructLayout* Layout = GetColumnarStructLayout(SProp->Struct);
+	check(Layout);
+
+	// Layout goes in the metadata once, that's the schema for the columns
+	if (!Meta.StructLayouts.Contents.Contains(Layout->LayoutHash))
+		Meta.StructLayouts.Contents.Add(Layout->LayoutHash, *Layout);
+
+	uint32 LayoutHash = Layout->LayoutHash;
+	WriteRaw(LayoutHash, Out);
+	// Then the byte length of the columns, so they can be skipped if the layout can't be found on restore
+	const int64 ColumnsSizePos = Out.Tell();
+	uint32 ColumnsSize = 0;
+	WriteRaw(ColumnsSize, Out);
+	const int64 ColumnsStart = Out.Tell();
+
+	// Elements are contiguous so just stride through them, one column per field
+	const uint8* Elements = NumElements > 0 ? ArrayHelper.GetRawPtr(0) : nullptr;
+	const uint32 Stride = Layout->Size;
+	TArray<uint8> Column;
+	for (auto && Field : Layout->Fields)
+	{
+		if (Field.TypeName == TEXT("StrProperty"))
+		{
+			for (int32 i = 0; i < NumElements; ++i)
+				Out << *reinterpret_cast<FString*>(const_cast<uint8*>(Elements + i * Stride + Field.Offset));
+		}
+		else if (Field.TypeName == TEXT("NameProperty"))
+		{
+			for (int32 i = 0; i < NumElements; ++i)
+				Out << *reinterpret_cast<FName*>(const_cast<uint8*>(Elements + i * Stride + Field.Offset));
+		}
+		else
+		{
+			Column.SetNumUninitialized(NumElements * Field.Size);
+			uint8* ColumnPtr = Column.GetData();
+			for (int32 i = 0; i < NumElements; ++i, ColumnPtr += Field.Size)
+			{
+				const uint8* FieldPtr = Elements + i * Stride + Field.Offset;
+				if (Field.BoolMask)
+					*ColumnPtr = (*FieldPtr & Field.BoolMask) ? 1 : 0;
+				else
+					FMemory::Memcpy(ColumnPtr, FieldPtr, Field.Size);
+			}
+			Out.Serialize(Column.GetData(), Column.Num());
+		}
+	}
+	const int64 ColumnsEnd = Out.Tell();
+	ColumnsSize = static_cast<uint32>(ColumnsEnd - ColumnsStart);
+	Out.Seek(ColumnsSizePos);
+	WriteRaw(ColumnsSize, Out);
+	Out.Seek(ColumnsEnd);
+	UE_LOG(LogSpudProps, Verbose, TEXT("%s = [%d elements in %d columns]"), *GetLogPrefix(SProp, Depth), NumElements,
+	       Layout->Fields.Num());
+}
+
+void SpudPropertyUtil::ReadColumnarStructArrayData(FStructProperty* SProp,
+                                                   FScriptArrayHelper& ArrayHelper,
+                                                   int32 NumElements,
+                                                   int Depth,
+                                                   const FSpudClassMetadata& Meta,
+                                                   FArchive& In)
+{
+	const FSpudStructLayout* Layout = GetColumnarStructLayout(SProp->Struct);
+	check(Layout);
+
+	uint32 LayoutHash;
+	uint32 ColumnsSize;
+	ReadRaw(LayoutHash, In);
+	ReadRaw(ColumnsSize, In);
+	const int64 ColumnsEnd = In.Tell() + ColumnsSize;
+	const auto StoredLayout = Meta.StructLayouts.Contents.Find(LayoutHash);
+	if (!StoredLayout)
+	{
+		UE_LOG(LogSpudProps, Error, TEXT("Unable to restore array of %s, stored layout not found"), *Layout->StructName);
+		// Elements keep their defaults, but the rest of the properties can still be restored
+		In.Seek(ColumnsEnd);
+		return;
+	}
+
+	// Columns are in the stored order; fields that are gone or have changed type are read & discarded, fields that
+	// didn't exist keep their defaults. Same rules as blittable structs
+	uint8* Elements = NumElements > 0 ? ArrayHelper.GetRawPtr(0) : nullptr;
+	const uint32 Stride = Layout->Size;
+	TArray<uint8> Column;
+	for (auto && StoredField : StoredLayout->Fields)
+	{
+		const FSpudStructLayoutField* Field = Layout->Fields.FindByPredicate(
+			[&StoredField](const FSpudStructLayoutField& F) { return F.Name == StoredField.Name; });
+		if (Field && (Field->TypeName != StoredField.TypeName || Field->Size != StoredField.Size))
+		{
+			UE_LOG(LogSpudProps, Log, TEXT("Skipping %s in %s, type has changed"), *StoredField.Name, *Layout->StructName);
+			Field = nullptr;
+		}
+
+		if (StoredField.TypeName == TEXT("StrProperty"))
+		{
+			FString Discard;
+			for (int32 i = 0; i < NumElements; ++i)
+				In << (Field ? *reinterpret_cast<FString*>(Elements + i * Stride + Field->Offset) : Discard);
+		}
+		else if (StoredField.TypeName == TEXT("NameProperty"))
+		{
+			FName Discard;
+			for (int32 i = 0; i < NumElements; ++i)
+				In << (Field ? *reinterpret_cast<FName*>(Elements + i * Stride + Field->Offset) : Discard);
+		}
+		else if (!Field)
+		{
+			In.Seek(In.Tell() + static_cast<int64>(NumElements) * StoredField.Size);
+		}
+		else
+		{
+			// Whole column in one go, then scatter
+			Column.SetNumUninitialized(NumElements * Field->Size);
+			In.Serialize(Column.GetData(), Column.Num());
+			const uint8* ColumnPtr = Column.GetData();
+			for (int32 i = 0; i < NumElements; ++i, ColumnPtr += Field->Size)
+			{
+				uint8* FieldPtr = Elements + i * Stride + Field->Offset;
+				if (Field->BoolMask)
+					*FieldPtr = (*FieldPtr & ~Field->BoolMask) | (*ColumnPtr ? Field->BoolMask : 0);
+				else
+					FMemory::Memcpy(FieldPtr, ColumnPtr, Field->Size);
+			}
+		}
+	}
+	if (In.Tell() != ColumnsEnd)
+	{
+		UE_LOG(LogSpudProps, Error, TEXT("Array of %s read %lld bytes but %u were stored"), *Layout->StructName,
+		       In.Tell() - (ColumnsEnd - ColumnsSize), ColumnsSize);
+		In.Seek(ColumnsEnd);
+	}
+	UE_LOG(LogSpudProps, Verbose, TEXT("%s = [%d elements in %d columns]"), *GetLogPrefix(SProp, Depth), NumElements,
+	       StoredLayout->Fields.Num());
+}
+
+void SpudPropertyUtil::ConvertBlittableStructData(const FSpudStructLayout& FromLayout, const uint8* FromData,
+                                                  const FSpudStructLayout& ToLayout, uint8* ToData)
+{
+	for (auto && ToField : ToLayout.Fields)
+	{
+		const FSpudStructLayoutField* FromField = FromLayout.Fields.FindByPredicate(
+			[&ToField](const FSpudStructLayoutField& F) { return F.Name == ToField.Name; });
+		if (!FromField)
+			continue;
+
+		if (FromField->TypeName != ToField.TypeName || FromField->Size != ToField.Size ||
+			FromField->Offset + FromField->Size > FromLayout.Size)
+		{
+			UE_LOG(LogSpudProps, Log, TEXT("Skipping %s in %s, type has changed"), *ToField.Name, *ToLayout.StructName);
+			continue;
+		}
+
+		if (ToField.BoolMask)
+		{
+			const bool bValue = (FromData[FromField->Offset] & FromField->BoolMask) != 0;
+			ToData[ToField.Offset] = (ToData[ToField.Offset] & ~ToField.BoolMask) | (bValue ? ToField.BoolMask : 0);
+		}
+		else
+		{
+			FMemory::Memcpy(ToData + ToField.Offset, FromData + FromField->Offset, ToField.Size);
+		}
+	}
+}
+
 bool SpudPropertyUtil::IsActorObjectProperty(const FProperty* Property)
 {
 	// Early-out on TSubclassOf which is a specialised FObjectProperty
@@ -122,6 +526,8 @@ uint16 SpudPropertyUtil::GetPropertyDataType(const FProperty* Prop)
 			Ret = SpudTypeInfo<FTransform>::EnumType;
 		else if (SProp->Struct == TBaseStructure<FGuid>::Get())
 			Ret = SpudTypeInfo<FGuid>::EnumType;
+		else if (IsBlittableStruct(SProp->Struct))
+			Ret = ESST_BlittableStruct;
 		else
 			Ret = ESST_CustomStruct; // Anything else is a custom struct
 	}
@@ -281,7 +687,8 @@ bool SpudPropertyUtil::VisitPersistentProperties(UObject* RootObject, const UStr
 		// Now deal with cascading into nested structs (custom structs, not FVector etc)
 		if (const auto SProp = CastField<FStructProperty>(Property))
 		{
-			if (!IsBuiltInStructProperty(SProp))
+			// Blittable structs are stored as one value so there's nothing to cascade into
+			if (IsCustomStructProperty(SProp))
 			{
 				// Everything underneath a custom struct is recorded with a nested prefix
 				const uint32 NewPrefixID = Visitor.GetNestedPrefix(SProp, PrefixID);
@@ -319,8 +726,8 @@ uint16 SpudPropertyUtil::WriteEnumPropertyData(FEnumProperty* EProp,
 	if (!bIsArrayElement)
 		RegisterProperty(EProp, PrefixID, ClassDef, PropertyOffsets, Meta, Out);
 
-	uint16 Val = EProp->GetUnderlyingProperty()->GetUnsignedIntPropertyValue(Data);
-	Out << Val;
+	const uint16 Val = EProp->GetUnderlyingProperty()->GetUnsignedIntPropertyValue(Data);
+	WriteEncoded(Val, Out, Meta);
 	return Val;
 }
 
@@ -345,10 +752,10 @@ bool SpudPropertyUtil::TryWriteEnumPropertyData(FProperty* Property,
 	return false;
 }
 
-uint16 SpudPropertyUtil::ReadEnumPropertyData(FEnumProperty* EProp, void* Data, FArchive& In)
+uint16 SpudPropertyUtil::ReadEnumPropertyData(FEnumProperty* EProp, void* Data, const FSpudClassMetadata& Meta, FArchive& In)
 {
 	uint16 Val;
-	In << Val;
+	ReadEncoded(Val, In, Meta);
 
 	EProp->GetUnderlyingProperty()->SetIntPropertyValue(Data, static_cast<uint64>(Val));
 
@@ -357,14 +764,14 @@ uint16 SpudPropertyUtil::ReadEnumPropertyData(FEnumProperty* EProp, void* Data,
 
 bool SpudPropertyUtil::TryReadEnumPropertyData(FProperty* Prop, void* Data,
                                                      const FSpudPropertyDef& StoredProperty,
-                                                     int Depth, FArchive& In)
+                                                     int Depth, const FSpudClassMetadata& Meta, FArchive& In)
 {
 	auto EProp = CastField<FEnumProperty>(Prop);
 	if (EProp && StoredPropertyTypeMatchesRuntime(Prop, StoredProperty, true))
 		// we ignore array flag since we could be processing inner
 	{
 		// Enums as 16-bit numbers, that should be large enough!
-		const uint16 Val = ReadEnumPropertyData(EProp, Data, In);
+		const uint16 Val = ReadEnumPropertyData(EProp, Data, Meta, In);
 		UE_LOG(LogSpudProps, Verbose, TEXT("%s = %s"), *GetLogPrefix(Prop, Depth), *ToString(Val));
 		return true;
 	}
@@ -442,9 +849,21 @@ FString SpudPropertyUtil::WriteNestedUObjectPropertyData(FObjectProperty* OProp,
 
 	uint32 ClassID;
 	FString Ret = "NULL";
+	auto& Nested = Meta.NestedObjects;
+	Nested.bLastWasBackReference = false;
 	// We already have the Actor so no need to get property value
 	if (UObj)
-	{		
+	{
+		// Already stored in this stream, just refer back to it and don't cascade again
+		if (const uint32* Offset = Nested.WrittenOffsets.Find(UObj))
+		{
+			WriteEncodedID(SPUDDATA_CLASSID_BACKREF, Out, Meta);
+			WriteEncoded(*Offset, Out, Meta);
+			Nested.bLastWasBackReference = true;
+			return FString::Printf(TEXT("[Same as @%u]"), *Offset);
+		}
+		Nested.WrittenOffsets.Add(UObj, static_cast<uint32>(Out.Tell()));
+
 		// UObjects (not actor refs) first store the class (as an ID)
 		Ret = GetClassName(UObj);
 		ClassID = Meta.FindOrAddClassIDFromName(Ret);
@@ -452,7 +871,7 @@ FString SpudPropertyUtil::WriteNestedUObjectPropertyData(FObjectProperty* OProp,
 	else // null
 		ClassID = SPUDDATA_CLASSID_NONE;
 	
-	Out << ClassID;
+	WriteEncodedID(ClassID, Out, Meta);
 
 	// Note that we ONLY write the class (or null) here. Actual property data is cascaded separately
 	return Ret;
@@ -482,7 +901,7 @@ FString SpudPropertyUtil::WriteSubclassOfPropertyData(FClassProperty* CProp,
 	else // null
 		ClassID = SPUDDATA_CLASSID_NONE;
 	
-	Out << ClassID;
+	WriteEncodedID(ClassID, Out, Meta);
 
 	return Ret;
 }
@@ -598,39 +1017,99 @@ FString SpudPropertyUtil::ReadNestedUObjectPropertyData(FObjectProperty* OProp,
 														ULevel* Level, UObject* Outer, const FSpudClassMetadata& Meta,
 														FArchive& In)
 {
-	uint32 ClassID;
-	In << ClassID;
+	const uint32 ClassOffset = static_cast<uint32>(In.Tell());
+	const uint32 ClassID = ReadEncodedID(In, Meta);
 
 	UObject* Object = nullptr;
 	FString Ret = "NULL";
+	auto& Nested = Meta.NestedObjects;
+	Nested.bLastWasBackReference = false;
+	Nested.MaterialisePos = -1;
 	if (ClassID == SPUDDATA_CLASSID_NONE)
 	{
 		// If stored data said it should be null, set it
 		OProp->SetObjectPropertyValue(Data, nullptr);
 	}
+	else if (ClassID == SPUDDATA_CLASSID_BACKREF)
+	{
+		// Same instance as an earlier property in this stream, which has already been restored
+		uint32 Offset;
+		ReadEncoded(Offset, In, Meta);
+		Nested.bLastWasBackReference = true;
+		if (UObject** Found = Nested.ReadObjects.Find(Offset))
+		{
+			Object = *Found;
+			if (!Object || Object->IsA(OProp->PropertyClass))
+				OProp->SetObjectPropertyValue(Data, Object);
+			else
+				UE_LOG(LogSpudProps, Error, TEXT("Cannot restore %s, shared instance is %s which is the wrong type"),
+				       *OProp->GetName(), *Object->GetClass()->GetName());
+		}
+		else
+		{
+			// The slow path visits properties in the runtime order, so if that has changed the original may not
+			// have been read yet. Create it from there now, and cascade into its properties from there too
+			const int64 ResumePos = In.Tell();
+			In.Seek(Offset);
+			const uint32 SharedClassID = Offset < static_cast<uint32>(In.TotalSize()) ? ReadEncodedID(In, Meta) : SPUDDATA_CLASSID_NONE;
+			const auto Class = SharedClassID != SPUDDATA_CLASSID_NONE && SharedClassID != SPUDDATA_CLASSID_BACKREF ?
+				Meta.ResolveClass(SharedClassID) : nullptr;
+			if (!Class)
+			{
+				UE_LOG(LogSpudProps, Error, TEXT("Cannot restore %s, shared instance @%u could not be read"),
+				       *OProp->GetName(), Offset);
+			}
+			else if (!Class->IsChildOf(OProp->PropertyClass))
+			{
+				UE_LOG(LogSpudProps, Error, TEXT("Cannot restore %s, shared instance is %s which is the wrong type"),
+				       *OProp->GetName(), *Class->GetName());
+			}
+			else
+			{
+				Object = OProp->GetObjectPropertyValue(Data);
+				if (!IsValid(Object))
+					Object = NewObject<UObject>(Outer, Class);
+				OProp->SetObjectPropertyValue(Data, Object);
+				Nested.ReadObjects.Add(Offset, Object);
+				Nested.bLastWasBackReference = false;
+				Nested.MaterialisePos = In.Tell();
+			}
+			In.Seek(ResumePos);
+		}
+		Ret = FString::Printf(TEXT("[Same as @%u]"), Offset);
+	}
+	else if (UObject** Found = Nested.ReadObjects.Find(ClassOffset))
+	{
+		// Already created by an earlier reference to it, but its properties are still here and need reading
+		Object = *Found;
+		OProp->SetObjectPropertyValue(Data, Object);
+		if (Object)
+			Ret = Meta.GetClassNameFromID(ClassID);
+	}
 	else
 	{
 		// If stored data is non-null, instantiate if needed
 		// Only instantiate if null, to allow user code to instantiate subclasses of property type if required
-		if (!IsValid(OProp->GetObjectPropertyValue(Data)))
+		Object = OProp->GetObjectPropertyValue(Data);
+		if (!IsValid(Object))
 		{
-			const FString ClassName = Meta.GetClassNameFromID(ClassID);
-
-			const FSoftClassPath CP(ClassName);
-			const auto Class = CP.TryLoadClass<UObject>();
+			const auto Class = Meta.ResolveClass(ClassID);
 
 			if (!Class)
 			{
-				UE_LOG(LogSpudProps, Error, TEXT("Cannot respawn instance of %s, class not found"), *ClassName);
+				UE_LOG(LogSpudProps, Error, TEXT("Cannot respawn instance of %s, class not found"), *Meta.GetClassNameFromID(ClassID));
+				// Later references to it will be null too
+				Nested.ReadObjects.Add(ClassOffset, nullptr);
 				return Ret;
 			}
 
 			Object = NewObject<UObject>(Outer, Class);
 			OProp->SetObjectPropertyValue(Data, Object);
-			Ret = ClassName;
+			Ret = Meta.GetClassNameFromID(ClassID);
 		}
 		// Otherwise, we leave the existing instance there
 		// Nested properties will be re-populated as before during cascade
+		Nested.ReadObjects.Add(ClassOffset, Object);
 	}
 
 	return Ret;
@@ -640,8 +1119,7 @@ FString SpudPropertyUtil::ReadSubclassOfPropertyData(FObjectProperty* OProp, voi
 	const RuntimeObjectMap* RuntimeObjects, ULevel* Level, const FSpudClassMetadata& Meta, FArchive& In)
 {
 	// TSubclassOf is just a class ID
-	uint32 ClassID;
-	In << ClassID;
+	const uint32 ClassID = ReadEncodedID(In, Meta);
 
 	FString Ret = "NULL";
 	if (ClassID == SPUDDATA_CLASSID_NONE)
@@ -651,20 +1129,17 @@ FString SpudPropertyUtil::ReadSubclassOfPropertyData(FObjectProperty* OProp, voi
 	}
 	else
 	{
-		const FString ClassName = Meta.GetClassNameFromID(ClassID);
-
-		const FSoftClassPath CP(ClassName);
-		const auto Class = CP.TryLoadClass<UObject>();
+		const auto Class = Meta.ResolveClass(ClassID);
 
 		if (!Class)
 		{
-			UE_LOG(LogSpudProps, Error, TEXT("Cannot find class %s"), *ClassName);
+			UE_LOG(LogSpudProps, Error, TEXT("Cannot find class %s"), *Meta.GetClassNameFromID(ClassID));
 			return Ret;
 		}
 
 		// For a FClassProperty, the object value is the class instance
 		OProp->SetObjectPropertyValue(Data, Class);
-		Ret = ClassName;
+		Ret = Meta.GetClassNameFromID(ClassID);
 	}
 
 	return Ret;
@@ -740,7 +1215,8 @@ void SpudPropertyUtil::StoreArrayProperty(FArrayProperty* AProp,
 	FScriptArrayHelper ArrayHelper(AProp, DataPtr);
 	const int32 NumElements = ArrayHelper.Num();
 
-	if (NumElements > std::numeric_limits<uint16>::max())
+	// Compact format has a variable length count so no limit
+	if (!Meta.IsCompact() && NumElements > std::numeric_limits<uint16>::max())
 	{
 		UE_LOG(LogSpudProps, Error, TEXT("Array property %s/%s has %d elements, exceeds maximum of %d, will be truncated"),
 			*RootObject->GetName(), *AProp->GetName(), NumElements, std::numeric_limits<uint16>::max());
@@ -749,9 +1225,17 @@ void SpudPropertyUtil::StoreArrayProperty(FArrayProperty* AProp,
 	RegisterProperty(AProp, PrefixID, ClassDef, PropertyOffsets, Meta, Out);
 	
 	// Data is count first, then elements
-	uint16 ShortElems = static_cast<uint16>(NumElements);
-	Out << ShortElems;
-	for (int ArrayElem = 0; ArrayElem < NumElements; ++ArrayElem)
+	const int32 NumToWrite = WriteArrayCount(NumElements, Out, Meta);
+
+	// Custom structs are written as columns instead
+	if (IsCustomStructProperty(AProp->Inner))
+	{
+		WriteColumnarStructArrayData(CastFieldChecked<FStructProperty>(AProp->Inner), ArrayHelper, NumToWrite, Depth,
+		                             Meta, Out);
+		return;
+	}
+
+	for (int ArrayElem = 0; ArrayElem < NumToWrite; ++ArrayElem)
 	{
 		void *ElemPtr = ArrayHelper.GetRawPtr(ArrayElem);
 		StoreContainerProperty(AProp->Inner, RootObject, PrefixID, ElemPtr, true, Depth, ClassDef, PropertyOffsets, Meta, Out);
@@ -784,6 +1268,11 @@ void SpudPropertyUtil::StoreContainerProperty(FProperty* Property,
                 TryWriteBuiltinStructPropertyData<FTransform>(SProp, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out) ||
                 TryWriteBuiltinStructPropertyData<FGuid>(SProp, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out);
 		}
+		else if (IsBlittableStruct(SProp->Struct))
+		{
+			WriteBlittableStructPropertyData(SProp, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out);
+			bUpdateOK = true;
+		}
 		else
 		{
 			// We assume that nested custom structs are ok
@@ -848,14 +1337,26 @@ void SpudPropertyUtil::RestoreArrayProperty(UObject* RootObject, FArrayProperty*
                                                   FMemoryReader& DataIn)
 {
 
-	// Array properties store the count as a uint16 first
-	uint16 NumElems;
-	DataIn << NumElems;
+	if (IsCustomStructProperty(AProp->Inner) && !StoredPropertyTypeMatchesRuntime(AProp, StoredProperty, false))
+	{
+		UE_LOG(LogSpudProps, Error, TEXT("Unable to restore property %s, type has changed."), *AProp->GetName());
+		return;
+	}
+
+	// Array properties store the count first
+	const int32 NumElems = ReadArrayCount(DataIn, Meta);
 	
 	void* DataPtr = AProp->ContainerPtrToValuePtr<void>(ContainerPtr);
 	FScriptArrayHelper ArrayHelper(AProp, DataPtr);
 	ArrayHelper.Resize(NumElems);
 
+	// Custom structs are stored as columns
+	if (IsCustomStructProperty(AProp->Inner))
+	{
+		ReadColumnarStructArrayData(CastFieldChecked<FStructProperty>(AProp->Inner), ArrayHelper, NumElems, Depth, Meta, DataIn);
+		return;
+	}
+
 	// After that, it's just like restoring a single property, just to a new location for each element
 	for (int ArrayElem = 0; ArrayElem < NumElems; ++ArrayElem)
 	{
@@ -886,6 +1387,10 @@ void SpudPropertyUtil::RestoreContainerProperty(UObject* RootObject, FProperty*
                 TryReadBuiltinStructPropertyData<FTransform>(SProp, DataPtr, StoredProperty, Depth, DataIn) ||
                 TryReadBuiltinStructPropertyData<FGuid>(SProp, DataPtr, StoredProperty, Depth, DataIn);
 		}
+		else if (IsBlittableStruct(SProp->Struct))
+		{
+			bUpdateOK = TryReadBlittableStructPropertyData(SProp, DataPtr, StoredProperty, Depth, Meta, DataIn);
+		}
 		else
 		{
 			// We assume that nested custom structs are ok
@@ -896,21 +1401,21 @@ void SpudPropertyUtil::RestoreContainerProperty(UObject* RootObject, FProperty*
 	else 
 	{
 		bUpdateOK =
-            TryReadPropertyData<FBoolProperty,		bool>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FByteProperty,		uint8>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FUInt16Property,	uint16>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FUInt32Property,	uint32>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FUInt64Property,	uint64>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FInt8Property,		int8>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FInt16Property,	int16>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FIntProperty,		int>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FInt64Property,	int64>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FFloatProperty,	float>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FDoubleProperty,	double>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FStrProperty,		FString>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FNameProperty,		FName>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadPropertyData<FTextProperty,		FText>(Property, DataPtr, StoredProperty, Depth, DataIn) ||
-            TryReadEnumPropertyData(Property, DataPtr, StoredProperty, Depth, DataIn);
+            TryReadPropertyData<FBoolProperty,		bool>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FByteProperty,		uint8>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FUInt16Property,	uint16>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FUInt32Property,	uint32>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FUInt64Property,	uint64>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FInt8Property,		int8>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FInt16Property,	int16>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FIntProperty,		int>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FInt64Property,	int64>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FFloatProperty,	float>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FDoubleProperty,	double>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FStrProperty,		FString>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FNameProperty,		FName>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadPropertyData<FTextProperty,		FText>(Property, DataPtr, StoredProperty, Depth, Meta, DataIn) ||
+            TryReadEnumPropertyData(Property, DataPtr, StoredProperty, Depth, Meta, DataIn);
 
 		if (!bUpdateOK)
 		{
@@ -976,13 +1481,13 @@ bool SpudPropertyUtil::StoredMatchesRuntimePropertyVisitor::VisitProperty(UObjec
 {
 	if (const auto SProp = CastField<FStructProperty>(RuntimeProperty))
 	{
-		if (!IsBuiltInStructProperty(SProp))
+		if (IsCustomStructProperty(SProp))
 		{
 			// Struct entry itself is not recorded, only nested fields, no need to check
 			// Visitor will call us with the nested properties
 			return true;
 		}
-		// Builtin structs (FVector etc) are just like any other property, proceed
+		// Builtin structs (FVector etc) and blittable structs are just like any other property, proceed
 	}
 
 	// The next property we encounter from the Container should match the next item on
@@ -1044,6 +1549,194 @@ uint32 SpudPropertyUtil::StoredMatchesRuntimePropertyVisitor::GetNestedPrefix(
 	// This doesn't create a new ID, expects it to be there already
 	return GetNestedPrefixID(CurrentPrefixID, Prop, Meta);
 }
+int32 SpudPropertyUtil::WriteArrayCount(int32 Num, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	// Compact format has a variable length count so no limit, fixed width is a uint16
+	if (Meta.IsCompact())
+	{
+		SpudWriteVarUInt(Out, Num);
+		return Num;
+	}
+	uint16 ShortNum = static_cast<uint16>(Num);
+	Out << ShortNum;
+	return ShortNum;
+}
+
+int32 SpudPropertyUtil::ReadArrayCount(FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+	{
+		// Every element takes at least a bit (packed bools), so a count the remaining data can't hold is corrupt.
+		// Checked before it's used to size the array, since there's no 16-bit limit here
+		const uint64 Num = SpudReadVarUInt(In);
+		const uint64 MaxNum = static_cast<uint64>(FMath::Max(In.TotalSize() - In.Tell(), static_cast<int64>(0))) * 8;
+		if (Num > MaxNum || Num > static_cast<uint64>(MAX_int32))
+		{
+			UE_LOG(LogSpudProps, Error, TEXT("Array count %llu is corrupt, only %llu elements could be stored"), Num, MaxNum);
+			In.SetError();
+			return 0;
+		}
+		return static_cast<int32>(Num);
+	}
+	uint16 ShortNum;
+	In << ShortNum;
+	return ShortNum;
+}
+
+void SpudPropertyUtil::WriteEncoded(bool Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (!Meta.IsCompact())
+	{
+		WriteRaw(Value, Out);
+		return;
+	}
+
+	// Reserve a byte for every 8 bools and patch it in place as they're set
+	auto& Packing = Meta.BoolPacking;
+	if (Packing.NextBit >= 8)
+	{
+		Packing.BytePos = Out.Tell();
+		Packing.Byte = 0;
+		Packing.NextBit = 0;
+		Out << Packing.Byte;
+	}
+	if (Value)
+	{
+		Packing.Byte |= 1 << Packing.NextBit;
+		const int64 CurrPos = Out.Tell();
+		Out.Seek(Packing.BytePos);
+		Out << Packing.Byte;
+		Out.Seek(CurrPos);
+	}
+	++Packing.NextBit;
+}
+
+void SpudPropertyUtil::WriteEncoded(uint16 Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		SpudWriteVarUInt(Out, Value);
+	else
+		WriteRaw(Value, Out);
+}
+
+void SpudPropertyUtil::WriteEncoded(uint32 Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		SpudWriteVarUInt(Out, Value);
+	else
+		WriteRaw(Value, Out);
+}
+
+void SpudPropertyUtil::WriteEncoded(uint64 Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		SpudWriteVarUInt(Out, Value);
+	else
+		WriteRaw(Value, Out);
+}
+
+void SpudPropertyUtil::WriteEncoded(int16 Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		SpudWriteVarInt(Out, Value);
+	else
+		WriteRaw(Value, Out);
+}
+
+void SpudPropertyUtil::WriteEncoded(int32 Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		SpudWriteVarInt(Out, Value);
+	else
+		WriteRaw(Value, Out);
+}
+
+void SpudPropertyUtil::WriteEncoded(int64 Value, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		SpudWriteVarInt(Out, Value);
+	else
+		WriteRaw(Value, Out);
+}
+
+void SpudPropertyUtil::ReadEncoded(bool& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (!Meta.IsCompact())
+	{
+		ReadRaw(Value, In);
+		return;
+	}
+
+	auto& Packing = Meta.BoolPacking;
+	if (Packing.NextBit >= 8)
+	{
+		In << Packing.Byte;
+		Packing.NextBit = 0;
+	}
+	Value = (Packing.Byte & (1 << Packing.NextBit)) != 0;
+	++Packing.NextBit;
+}
+
+void SpudPropertyUtil::ReadEncoded(uint16& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		Value = static_cast<uint16>(SpudReadVarUInt(In));
+	else
+		ReadRaw(Value, In);
+}
+
+void SpudPropertyUtil::ReadEncoded(uint32& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		Value = static_cast<uint32>(SpudReadVarUInt(In));
+	else
+		ReadRaw(Value, In);
+}
+
+void SpudPropertyUtil::ReadEncoded(uint64& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		Value = SpudReadVarUInt(In);
+	else
+		ReadRaw(Value, In);
+}
+
+void SpudPropertyUtil::ReadEncoded(int16& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		Value = static_cast<int16>(SpudReadVarInt(In));
+	else
+		ReadRaw(Value, In);
+}
+
+void SpudPropertyUtil::ReadEncoded(int32& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		Value = static_cast<int32>(SpudReadVarInt(In));
+	else
+		ReadRaw(Value, In);
+}
+
+void SpudPropertyUtil::ReadEncoded(int64& Value, FArchive& In, const FSpudClassMetadata& Meta)
+{
+	if (Meta.IsCompact())
+		Value = SpudReadVarInt(In);
+	else
+		ReadRaw(Value, In);
+}
+
+void SpudPropertyUtil::WriteEncodedID(uint32 ID, FArchive& Out, const FSpudClassMetadata& Meta)
+{
+	WriteEncoded(static_cast<int32>(ID), Out, Meta);
+}
+
+uint32 SpudPropertyUtil::ReadEncodedID(FArchive& In, const FSpudClassMetadata& Meta)
+{
+	int32 ID;
+	ReadEncoded(ID, In, Meta);
+	return static_cast<uint32>(ID);
+}
+
 bool SpudPropertyUtil::IsRuntimeActor(AActor* Actor)
 {
 	// RF_WasLoaded means it was part of a level
@@ -1,9 +1,13 @@
 #include "SpudState.h"
 
+#include "Async/Async.h"
 #include "EngineUtils.h"
 #include "ISpudObject.h"
+#include "SpudBulkEntities.h"
+#include "SpudCompiledSerializer.h"
 #include "SpudPropertyUtil.h"
 #include "SpudSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "Engine/LevelStreaming.h"
 #include "GameFramework/Character.h"
 #include "GameFramework/GameModeBase.h"
@@ -12,6 +16,7 @@
 #include "Kismet/GameplayStatics.h"
 #include "ImageUtils.h"
 #include "GameFramework/PlayerState.h"
+#include "TimerManager.h"
 
 DEFINE_LOG_CATEGORY(LogSpudState)
 
@@ -21,10 +26,42 @@ USpudState::USpudState()
 	RemoveAllActiveGameLevelFiles();
 }
 
+void FSpudOperationTelemetry::Accumulate(const FSpudOperationTelemetry& Other)
+{
+	GameThreadTimeMs += Other.GameThreadTimeMs;
+	CaptureTimeMs += Other.CaptureTimeMs;
+	EncodeTimeMs += Other.EncodeTimeMs;
+	IOTimeMs += Other.IOTimeMs;
+	RestoreTimeMs += Other.RestoreTimeMs;
+	LockWaitTimeMs += Other.LockWaitTimeMs;
+	BytesRead += Other.BytesRead;
+	BytesWritten += Other.BytesWritten;
+	ActorsStored += Other.ActorsStored;
+	ActorsRestored += Other.ActorsRestored;
+	ActorsRespawned += Other.ActorsRespawned;
+	ActorsDestroyed += Other.ActorsDestroyed;
+	FastPathObjects += Other.FastPathObjects;
+	SlowPathObjects += Other.SlowPathObjects;
+}
+
 void USpudState::ResetState()
 {
 	RemoveAllActiveGameLevelFiles();
 	SaveData.Reset();
+	DeferredVelocities.Empty();
+	PendingDestroyedActors.Empty();
+	PendingDestroyedLevels.Empty();
+	StoredGlobalObjects.Empty();
+	// Pooled actors in use stay where they are, but are ordinary runtime actors of the persistent level from now on
+	EmptyActorPool();
+	PooledActorLevels.Empty();
+	// Placed instance transforms outlive the state, an in-place restore needs them after this. Only the components
+	// which still exist are worth keeping though
+	for (auto It = PlacedInstanceTransforms.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+			It.RemoveCurrent();
+	}
 }
 
 void USpudState::StoreWorldGlobals(UWorld* World)
@@ -35,30 +72,69 @@ void USpudState::StoreWorldGlobals(UWorld* World)
 
 void USpudState::StoreLevel(ULevel* Level, bool bRelease, bool bBlocking)
 {
+	FlushDestroyedActors();
 	const FString LevelName = GetLevelName(Level);
 	auto LevelData = GetLevelData(LevelName, true);
 
 	if (LevelData.IsValid())
 	{
 		// Mutex lock the level (load and unload events on streaming can be in loading threads)
-		FScopeLock LevelLock(&LevelData->Mutex);
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
 
 		// Clear any existing data for levels being updated from
 		// Which is either the specific level, or all loaded levels
 		if (LevelData)
 			LevelData->PreStoreWorld();
 
+		// Pooled actors live in the persistent level but belong to the level they were respawned for
+		TArray<AActor*> Actors;
+		Actors.Reserve(Level->Actors.Num());
 		for (auto Actor : Level->Actors)
 		{
-			if (SpudPropertyUtil::IsPersistentObject(Actor))
+			if (SpudPropertyUtil::IsPersistentObject(Actor) && !IsPooledActor(Actor))
+				Actors.Add(Actor);
+		}
+		GetPooledActorsInLevel(LevelName, Actors);
+
+		if (GSpudCanonicalOutput)
+		{
+			// Store in a stable order, so that class & property IDs are assigned the same way for the same state
+			TArray<TPair<FString, AActor*>> Sorted;
+			for (auto Actor : Actors)
+			{
+				Sorted.Emplace(ShouldActorBeRespawnedOnRestore(Actor)
+					               ? SpudPropertyUtil::GetGuidProperty(Actor).ToString()
+					               : SpudPropertyUtil::GetLevelActorName(Actor),
+				               Actor);
+			}
+			Sorted.StableSort([](const TPair<FString, AActor*>& A, const TPair<FString, AActor*>& B)
+			{
+				return A.Key < B.Key;
+			});
+			for (auto& Pair : Sorted)
+			{
+				StoreActor(Pair.Value, LevelData);
+			}
+		}
+		else
+		{
+			for (auto Actor : Actors)
 			{
 				StoreActor(Actor, LevelData);
-			}					
+			}
 		}
+		LevelData->RemoveOrphanedBlobs();
+
+		FSpudBulkEntityHandlers::Store(Level, *LevelData);
 	}
 
 	if (bRelease)
+	{
+		const double ReleaseStart = FPlatformTime::Seconds();
 		ReleaseLevelData(LevelName, bBlocking);
+		if (Telemetry)
+			Telemetry->IOTimeMs += static_cast<float>((FPlatformTime::Seconds() - ReleaseStart) * 1000.0);
+	}
 }
 
 USpudState::StorePropertyVisitor::StorePropertyVisitor(
@@ -92,6 +168,13 @@ void USpudState::StorePropertyVisitor::StoreNestedUObjectIfNeeded(UObject* RootO
 	// since it only has the static type and in the case of nulls wouldn't know what to do)
 	if (SpudPropertyUtil::IsNestedUObjectProperty(Property))
 	{
+		// Shared instances are only cascaded into the first time they're written to the stream
+		const bool bBackReference = Meta.NestedObjects.bLastWasBackReference;
+		Meta.NestedObjects.bLastWasBackReference = false;
+		if (bBackReference)
+			return;
+
+
 		if (const auto OProp = CastField<FObjectProperty>(Property))
 		{
 			const void* DataPtr = Property->ContainerPtrToValuePtr<void>(ContainerPtr);
@@ -111,7 +194,10 @@ void USpudState::StorePropertyVisitor::StoreNestedUObjectIfNeeded(UObject* RootO
 					ISpudObjectCallback::Execute_SpudPreStore(Obj, ParentState);
 				}
 				const uint32 NewPrefixID = GetNestedPrefix(Property, CurrentPrefixID);
-				ParentState->StoreObjectProperties(Obj, NewPrefixID, PropertyOffsets, Meta, Out, Depth+1);
+				// Nested objects have their own class def, so their property indexes must not overwrite the
+				// offsets of the top-level object's properties. They're always read back in stream order
+				TArray<uint32> NestedOffsets;
+				ParentState->StoreObjectProperties(Obj, NewPrefixID, NestedOffsets, Meta, Out, Depth+1);
 
 				if (IsCallback)
 				{
@@ -148,7 +234,7 @@ void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 	// We write this as packed data
 
 	// Version: this needs to be incremented if any changes
-	constexpr uint16 CoreDataVersion = 1;
+	constexpr uint16 CoreDataVersion = 2;
 
 	// Current Format:
 	// - Version (uint16)
@@ -157,6 +243,7 @@ void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 	// - Velocity (FVector)
 	// - AngularVelocity (FVector)
 	// - Control rotation (FRotator) (non-zero for Pawns only)
+	// - Asleep (bool) (true for sleeping physics bodies only)
 
 	// We could omit some of this data for non-movables but it's simpler to include for all
 
@@ -168,6 +255,7 @@ void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 	FVector Velocity = FVector::ZeroVector;
 	FVector AngularVelocity = FVector::ZeroVector;
 	FRotator ControlRotation = FRotator::ZeroRotator;
+	bool bAsleep = false;
 
 	const auto RootComp = Actor->GetRootComponent();
 	if (RootComp && RootComp->Mobility == EComponentMobility::Movable)
@@ -177,6 +265,7 @@ void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 		{
 			Velocity = Actor->GetVelocity();
 			AngularVelocity = PrimComp->GetPhysicsAngularVelocityInDegrees();
+			bAsleep = !PrimComp->RigidBodyIsAwake();
 		}
 		else if (const auto	MoveComponent = Cast<UMovementComponent>(Actor->FindComponentByClass(UMovementComponent::StaticClass())))
 		{
@@ -192,6 +281,7 @@ void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 	SpudPropertyUtil::WriteRaw(Velocity, Out);
 	SpudPropertyUtil::WriteRaw(AngularVelocity, Out);
 	SpudPropertyUtil::WriteRaw(ControlRotation, Out);
+	SpudPropertyUtil::WriteRaw(bAsleep, Out);
 
 }
 
@@ -226,7 +316,9 @@ FString USpudState::GetLevelNameForObject(const UObject* Obj)
 
 FSpudSaveData::TLevelDataPtr USpudState::GetLevelData(const FString& LevelName, bool AutoCreate)
 {
-	auto Ret = SaveData.GetLevelData(LevelName, true, GetActiveGameLevelFolder());
+	// Only count page-ins made by the operation being measured, not by streaming threads
+	int64* BytesRead = Telemetry && IsInGameThread() ? &Telemetry->BytesRead : nullptr;
+	auto Ret = SaveData.GetLevelData(LevelName, true, GetActiveGameLevelFolder(), BytesRead);
 	
 	if (!Ret.IsValid() && AutoCreate)
 	{
@@ -239,12 +331,14 @@ FSpudSaveData::TLevelDataPtr USpudState::GetLevelData(const FString& LevelName,
 
 void USpudState::ReleaseLevelData(const FString& LevelName, bool bBlocking)
 {
+	FlushDestroyedActors();
 	SaveData.WriteAndReleaseLevelData(LevelName, GetActiveGameLevelFolder(), bBlocking);
 }
 
 
 void USpudState::ReleaseAllLevelData()
 {
+	FlushDestroyedActors();
 	SaveData.WriteAndReleaseAllLevelData(GetActiveGameLevelFolder());
 }
 
@@ -307,7 +401,7 @@ void USpudState::StoreActor(AActor* Obj)
 	if (Obj->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
 		return;
 
-	const FString LevelName = GetLevelNameForObject(Obj);
+	const FString LevelName = GetLevelNameForActor(Obj);
 
 	auto LevelData = GetLevelData(LevelName, true);
 	StoreActor(Obj, LevelData);
@@ -316,7 +410,7 @@ void USpudState::StoreActor(AActor* Obj)
 
 void USpudState::StoreLevelActorDestroyed(AActor* Actor)
 {
-	const FString LevelName = GetLevelNameForObject(Actor);
+	const FString LevelName = GetLevelNameForActor(Actor);
 
 	auto LevelData = GetLevelData(LevelName, true);
 	StoreLevelActorDestroyed(Actor, LevelData);
@@ -332,14 +426,11 @@ FSpudNamedObjectData* USpudState::GetGlobalObjectData(const UObject* Obj, bool A
 
 FSpudNamedObjectData* USpudState::GetGlobalObjectData(const FString& ID, bool AutoCreate)
 {
-	FSpudNamedObjectData* Ret = SaveData.GlobalData.Objects.Contents.Find(ID);
-	if (!Ret && AutoCreate)
-	{
-		Ret = &SaveData.GlobalData.Objects.Contents.Add(ID);
-		Ret->Name = ID;
-	}
-
-	return Ret;
+	// Global objects are decoded on demand
+	if (AutoCreate)
+		return &SaveData.GlobalData.Objects.FindOrAdd(ID);
+	
+	return SaveData.GlobalData.Objects.Find(ID);
 }
 
 
@@ -358,39 +449,137 @@ void USpudState::StoreGlobalObject(UObject* Obj, FSpudNamedObjectData* Data)
 	
 	if (Data)
 	{
-		FSpudClassMetadata& Meta = SaveData.GlobalData.Metadata;
-		const bool bIsCallback = Obj->GetClass()->ImplementsInterface(USpudObjectCallback::StaticClass());
-
 		UE_LOG(LogSpudState, Verbose, TEXT("* STORE Global object: %s"), *Obj->GetName());
+		SaveData.GlobalData.Objects.MarkDirty(Data->Name);
+		StoredGlobalObjects.Add(Data->Name, Obj);
 
-		if (bIsCallback)
-			ISpudObjectCallback::Execute_SpudPreStore(Obj, this);
+		StoreObjectData(Obj, *Data, SaveData.GlobalData.Metadata);
+	}
+}
 
-		StoreObjectProperties(Obj, Data->Properties, Meta);
-		
-		if (bIsCallback)
+void USpudState::RebuildGlobalDataForCanonicalOutput()
+{
+	// Class, property & name IDs are assigned in the order things were first stored, and only the objects themselves
+	// know how to re-encode their data, so every one of them has to still be around to do this
+	if (!IsInGameThread())
+	{
+		UE_LOG(LogSpudState, Warning, TEXT("Global objects can only be stored again on the game thread, global IDs "
+			       "will be in the order they were first stored"));
+		return;
+	}
+
+	TArray<FString> IDs;
+	SaveData.GlobalData.Objects.GetNames(IDs);
+	for (const auto& ID : IDs)
+	{
+		const auto Ptr = StoredGlobalObjects.Find(ID);
+		if (!Ptr || !Ptr->IsValid())
 		{
-			Data->CustomData.Data.Empty();
-			FMemoryWriter CustomDataWriter(Data->CustomData.Data);
-			auto CustomDataStruct = NewObject<USpudStateCustomData>();
-			CustomDataStruct->Init(&CustomDataWriter);
-			ISpudObjectCallback::Execute_SpudStoreCustomData(Obj, this, CustomDataStruct);
-			
-			ISpudObjectCallback::Execute_SpudPostStore(Obj, this);
+			UE_LOG(LogSpudState, Log, TEXT("Global object %s hasn't been stored since loading, global IDs will be "
+				       "in the order they were first stored"), *ID);
+			return;
 		}
+	}
+
+	IDs.Sort();
+	SaveData.GlobalData.Metadata.Reset();
+	for (const auto& ID : IDs)
+	{
+		StoreGlobalObject(StoredGlobalObjects[ID].Get(), &SaveData.GlobalData.Objects.FindOrAdd(ID));
+	}
+}
+
+void USpudState::StoreObjectData(UObject* Obj, FSpudObjectData& Data, FSpudClassMetadata& Meta)
+{
+	const bool bIsCallback = Obj->GetClass()->ImplementsInterface(USpudObjectCallback::StaticClass());
+
+	if (bIsCallback)
+		ISpudObjectCallback::Execute_SpudPreStore(Obj, this);
+
+	StoreObjectProperties(Obj, Data.Properties, Meta);
+	
+	if (bIsCallback)
+	{
+		Data.CustomData.Data.Empty();
+		FMemoryWriter CustomDataWriter(Data.CustomData.Data);
+		auto CustomDataStruct = NewObject<USpudStateCustomData>();
+		CustomDataStruct->Init(&CustomDataWriter);
+		ISpudObjectCallback::Execute_SpudStoreCustomData(Obj, this, CustomDataStruct);
 		
+		ISpudObjectCallback::Execute_SpudPostStore(Obj, this);
 	}
 }
 
+void USpudState::StoreObjectSnapshot(const TArray<UObject*>& Objects, FSpudObjectSnapshot& OutSnapshot)
+{
+	OutSnapshot.Reset(Objects.Num());
+	for (int32 i = 0; i < Objects.Num(); ++i)
+	{
+		if (IsValid(Objects[i]))
+		{
+			UE_LOG(LogSpudState, Verbose, TEXT("* STORE Snapshot object: %s"), *Objects[i]->GetName());
+			StoreObjectData(Objects[i], OutSnapshot.Objects[i], OutSnapshot.Metadata);
+		}
+	}
+}
+
+void USpudState::StoreObjectSnapshot(const TArray<UObject*>& Objects, TArray<uint8>& OutData)
+{
+	FSpudObjectSnapshot Snapshot;
+	StoreObjectSnapshot(Objects, Snapshot);
+	Snapshot.WriteToBuffer(OutData);
+}
+
+void USpudState::StoreLevelSnapshot(ULevel* Level, FSpudLevelSnapshot& OutSnapshot, const FSpudLevelSnapshot* Baseline)
+{
+	FlushDestroyedActors();
+	const FString LevelName = GetLevelName(Level);
+	OutSnapshot.Reset(LevelName);
+	auto SnapshotLevel = OutSnapshot.Level;
+
+	// Placed actors destroyed so far are recorded in our own level data as they happen
+	auto LevelData = GetLevelData(LevelName, false);
+	if (LevelData.IsValid())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+		for (auto&& DestroyedActor : LevelData->DestroyedActors.Values)
+		{
+			SnapshotLevel->DestroyedActors.Add(DestroyedActor->Name);
+		}
+	}
+
+	for (auto Actor : Level->Actors)
+	{
+		if (SpudPropertyUtil::IsPersistentObject(Actor) && !ShouldActorBeRespawnedOnRestore(Actor))
+		{
+			StoreActor(Actor, SnapshotLevel);
+		}
+	}
+
+	const int32 NumRemoved = Baseline ? OutSnapshot.RemoveUnchangedActors(*Baseline) : 0;
+	UE_LOG(LogSpudState, Verbose, TEXT("STORE level snapshot %s: %d actors (%d unchanged), %d destroyed"), *LevelName,
+	       SnapshotLevel->LevelActors.Contents.Num(), NumRemoved, SnapshotLevel->DestroyedActors.Values.Num());
+}
+
+void USpudState::StoreLevelSnapshot(ULevel* Level, TArray<uint8>& OutData, const FSpudLevelSnapshot* Baseline)
+{
+	FSpudLevelSnapshot Snapshot;
+	StoreLevelSnapshot(Level, Snapshot, Baseline);
+	Snapshot.WriteToBuffer(OutData);
+}
+
 
 void USpudState::StoreObjectProperties(UObject* Obj, FSpudPropertyData& Properties, FSpudClassMetadata& Meta, int StartDepth)
 {
 	auto& PropOffsets = Properties.PropertyOffsets;
 		
 	auto& PropData = Properties.Data;
-	PropData.Empty();
+	// Keep the allocation, the same object is usually stored repeatedly with a similar size
+	PropData.Reset();
 	FMemoryWriter PropertyWriter(PropData);
 
+	// Nested UObjects are written into the same stream so only reset stream state here
+	Meta.BeginPropertyStream();
 	StoreObjectProperties(Obj, SPUDDATA_PREFIXID_NONE, PropOffsets, Meta, PropertyWriter, StartDepth);	
 }
 
@@ -401,6 +590,16 @@ void USpudState::StoreObjectProperties(UObject* Obj, uint32 PrefixID, TArray<uin
 	const FString& ClassName = SpudPropertyUtil::GetClassName(Obj);
 	auto ClassDef = Meta.FindOrAddClassDef(ClassName);
 
+	// Classes with a compiled serializer skip reflection; nested objects still use it since their properties are prefixed
+	if (PrefixID == SPUDDATA_PREFIXID_NONE && !bTestDisableCompiledSerializers)
+	{
+		if (const auto Compiled = FSpudCompiledSerializers::Find(Obj->GetClass()))
+		{
+			Compiled->Store(Obj, ClassDef, PropOffsets, Meta, Out);
+			return;
+		}
+	}
+
 	// visit all properties and write out
 	StorePropertyVisitor Visitor(this, ClassDef, PropOffsets, Meta, Out);
 	SpudPropertyUtil::VisitPersistentProperties(Obj, Visitor, StartDepth);
@@ -411,10 +610,54 @@ void USpudState::RestoreLevel(UWorld* World, const FString& LevelName)
 	RestoreLoadedWorld(World, true, LevelName);
 }
 
+void USpudState::RestoreLevelBeforeVisible(ULevel* Level)
+{
+	if (!IsValid(Level))
+		return;
+
+	DeferredVelocities.Remove(GetLevelName(Level));
+	bDeferPhysicsVelocities = true;
+	RestoreLevel(Level);
+	bDeferPhysicsVelocities = false;
+}
+
+void USpudState::ApplyDeferredVelocities(ULevel* Level)
+{
+	if (!IsValid(Level))
+		return;
+
+	TArray<FSpudDeferredVelocity> Velocities;
+	if (!DeferredVelocities.RemoveAndCopyValue(GetLevelName(Level), Velocities))
+		return;
+
+	for (const auto& Deferred : Velocities)
+	{
+		if (const auto PrimComp = Deferred.Component.Get())
+		{
+			if (Deferred.bAsleep)
+			{
+				PrimComp->PutAllRigidBodiesToSleep();
+			}
+			else
+			{
+				PrimComp->SetAllPhysicsLinearVelocity(Deferred.Velocity);
+				PrimComp->SetAllPhysicsAngularVelocityInDegrees(Deferred.AngularVelocity);
+			}
+		}
+	}
+}
+
+bool USpudState::HasDeferredVelocities(ULevel* Level) const
+{
+	return IsValid(Level) && DeferredVelocities.Contains(GetLevelName(Level));
+}
+
 void USpudState::RestoreLevel(ULevel* Level)
 {
 	if (!IsValid(Level))
 		return;
+
+	FlushDestroyedActors();
 	
 	FString LevelName = GetLevelName(Level);
 	auto LevelData = GetLevelData(LevelName, false);
@@ -426,22 +669,32 @@ void USpudState::RestoreLevel(ULevel* Level)
 	}
 
 	// Mutex lock the level (load and unload events on streaming can be in loading threads)
-	FScopeLock LevelLock(&LevelData->Mutex);
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
 	
 	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Start"), *LevelName);
 	TMap<FGuid, UObject*> RuntimeObjectsByGuid;
+	TArray<AActor*> PooledActors;
 	// Respawn dynamic actors first; they need to exist in order for cross-references in level actors to work
 	for (auto&& SpawnedActor : LevelData->SpawnedActors.Contents)
 	{
 		auto Actor = RespawnActor(SpawnedActor.Value, LevelData->Metadata, Level);
 		if (Actor)
+		{
 			RuntimeObjectsByGuid.Add(SpawnedActor.Value.Guid, Actor);
-		// Spawned actors will have been added to Level->Actors, their state will be restored there
+			// Spawned actors will have been added to Level->Actors, their state will be restored there
+			// Pooled actors are in the persistent level instead, so restore those separately
+			if (Actor->GetLevel() != Level)
+				PooledActors.Add(Actor);
+		}
+	}
+	for (auto Actor : PooledActors)
+	{
+		RestoreActor(Actor, LevelData, &RuntimeObjectsByGuid);
 	}
 	// Restore existing actor state
 	for (auto Actor : Level->Actors)
 	{
-		if (SpudPropertyUtil::IsPersistentObject(Actor))
+		if (SpudPropertyUtil::IsPersistentObject(Actor) && !IsPooledActor(Actor))
 		{
 			RestoreActor(Actor, LevelData, &RuntimeObjectsByGuid);
 			auto Guid = SpudPropertyUtil::GetGuidProperty(Actor);
@@ -456,6 +709,8 @@ void USpudState::RestoreLevel(ULevel* Level)
 	{
 		DestroyActor(*DestroyedActor, Level);			
 	}
+	RestoreInstanceComponents(Level, *LevelData);
+	FSpudBulkEntityHandlers::Restore(Level, *LevelData);
 	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Complete"), *LevelName);
 
 }
@@ -472,7 +727,7 @@ void USpudState::RestoreActor(AActor* Actor)
 	if (Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
 		return;
 
-	const FString LevelName = GetLevelNameForObject(Actor);
+	const FString LevelName = GetLevelNameForActor(Actor);
 
 	auto LevelData = GetLevelData(LevelName, false);
 	if (!LevelData.IsValid())
@@ -498,17 +753,29 @@ AActor* USpudState::RespawnActor(const FSpudSpawnedActorData& SpawnedActor,
 		UE_LOG(LogSpudState, Error, TEXT("Cannot respawn instance of %s, class not found"), *ClassName);
 		return nullptr;
 	}
+	// Important to spawn using level's world, our GetWorld may not be valid it turns out
+	auto World = Level->GetWorld();
+	ULevel* PersistentLevel = World->PersistentLevel;
+	// Pooled actors go in the persistent level so they can outlive the streaming level they're respawned for
+	const bool bPool = Level != PersistentLevel &&
+		Class->ImplementsInterface(USpudObject::StaticClass()) &&
+		ISpudObject::Execute_ShouldPoolOnRespawn(Class->GetDefaultObject());
+
 	FActorSpawnParameters Params;
-	Params.OverrideLevel = Level;
+	Params.OverrideLevel = bPool ? PersistentLevel : Level;
 	// Need to always spawn since we're not setting position until later
 	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 	UE_LOG(LogSpudState, Verbose, TEXT(" * Respawning actor %s of type %s"), *SpawnedActor.Guid.ToString(EGuidFormats::DigitsWithHyphens), *ClassName);
 
-	// Important to spawn using level's world, our GetWorld may not be valid it turns out
-	auto World = Level->GetWorld();
-	AActor* Actor = World->SpawnActor<AActor>(Class, Params);
+	AActor* Actor = bPool ? TakePooledActor(Class, World) : nullptr;
+	if (!Actor)
+		Actor = World->SpawnActor<AActor>(Class, Params);
 	if (Actor)
 	{
+		if (bPool)
+			PooledActorLevels.Add(Actor, GetLevelName(Level));
+		if (Telemetry)
+			++Telemetry->ActorsRespawned;
 		if (!SpudPropertyUtil::SetGuidProperty(Actor, SpawnedActor.Guid))
 		{
 			UE_LOG(LogSpudState, Error, TEXT("Re-spawned a runtime actor of class %s but it is missing a SpudGuid property!"), *ClassName);
@@ -521,6 +788,124 @@ AActor* USpudState::RespawnActor(const FSpudSpawnedActorData& SpawnedActor,
 	return Actor;
 }
 
+AActor* USpudState::TakePooledActor(UClass* Class, UWorld* World)
+{
+	auto Pool = ActorPool.Find(Class);
+	if (!Pool)
+		return nullptr;
+
+	for (int i = Pool->Num() - 1; i >= 0; --i)
+	{
+		AActor* Actor = (*Pool)[i].Get();
+		if (!IsValid(Actor))
+		{
+			Pool->RemoveAt(i);
+			continue;
+		}
+		// Actors pooled in another world (e.g. another PIE instance) can't be used here
+		if (Actor->GetWorld() != World)
+			continue;
+
+		Pool->RemoveAt(i);
+		UE_LOG(LogSpudState, Verbose, TEXT(" * Reusing pooled actor %s"), *Actor->GetName());
+		Actor->SetActorHiddenInGame(false);
+		Actor->SetActorEnableCollision(true);
+		Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+		TInlineComponentArray<UActorComponent*> Components(Actor);
+		for (const auto Component : Components)
+		{
+			Component->SetComponentTickEnabled(Component->PrimaryComponentTick.bStartWithTickEnabled);
+			// Bodies were put to sleep when pooled. Restoring the actor's state puts them back to sleep if they
+			// were asleep when stored
+			auto PrimComp = Cast<UPrimitiveComponent>(Component);
+			if (PrimComp && PrimComp->IsSimulatingPhysics())
+				PrimComp->WakeAllRigidBodies();
+		}
+		return Actor;
+	}
+	return nullptr;
+}
+
+void USpudState::ReturnPooledActor(AActor* Actor)
+{
+	auto& Pool = ActorPool.FindOrAdd(Actor->GetClass());
+	Pool.RemoveAll([](const TWeakObjectPtr<AActor>& Ptr) { return !Ptr.IsValid(); });
+	if (Pool.Num() >= MaxPooledActorsPerClass)
+	{
+		UE_LOG(LogSpudState, Verbose, TEXT("Actor pool for %s is full, destroying %s"), *Actor->GetClass()->GetName(), *Actor->GetName());
+		Actor->Destroy();
+		return;
+	}
+
+	ISpudObject::Execute_SpudResetForPool(Actor);
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	TInlineComponentArray<UActorComponent*> Components(Actor);
+	for (const auto Component : Components)
+	{
+		Component->SetComponentTickEnabled(false);
+		// Stop bodies falling forever with no collision
+		auto PrimComp = Cast<UPrimitiveComponent>(Component);
+		if (PrimComp && PrimComp->IsSimulatingPhysics())
+			PrimComp->PutAllRigidBodiesToSleep();
+	}
+	Pool.Add(Actor);
+}
+
+bool USpudState::IsPooledActor(const AActor* Actor) const
+{
+	if (PooledActorLevels.Num() == 0 && ActorPool.Num() == 0)
+		return false;
+	if (PooledActorLevels.Contains(Actor))
+		return true;
+	const auto Pool = ActorPool.Find(Actor->GetClass());
+	return Pool && Pool->ContainsByPredicate([Actor](const TWeakObjectPtr<AActor>& Ptr) { return Ptr.Get() == Actor; });
+}
+
+void USpudState::GetPooledActorsInLevel(const FString& LevelName, TArray<AActor*>& OutActors)
+{
+	for (auto It = PooledActorLevels.CreateIterator(); It; ++It)
+	{
+		AActor* Actor = It.Key().ResolveObjectPtr();
+		if (!IsValid(Actor))
+			It.RemoveCurrent();
+		else if (It.Value() == LevelName)
+			OutActors.Add(Actor);
+	}
+}
+
+FString USpudState::GetLevelNameForActor(const AActor* Actor) const
+{
+	if (const FString* LevelName = PooledActorLevels.Find(Actor))
+		return *LevelName;
+	return GetLevelNameForObject(Actor);
+}
+
+void USpudState::ReturnPooledActors(const FString& LevelName)
+{
+	TArray<AActor*> Actors;
+	GetPooledActorsInLevel(LevelName, Actors);
+	for (auto Actor : Actors)
+	{
+		PooledActorLevels.Remove(Actor);
+		ReturnPooledActor(Actor);
+	}
+}
+
+void USpudState::EmptyActorPool()
+{
+	for (auto& Pair : ActorPool)
+	{
+		for (auto& Ptr : Pair.Value)
+		{
+			if (Ptr.IsValid())
+				Ptr->Destroy();
+		}
+	}
+	ActorPool.Empty();
+}
+
 void USpudState::DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, ULevel* Level)
 {
 	// We only ever have to destroy level actors, not runtime objects (those are just missing on restore)
@@ -528,7 +913,8 @@ void USpudState::DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, UL
 	if (auto Actor = Cast<AActor>(Obj))
 	{
 		UE_LOG(LogSpudState, Verbose, TEXT(" * Destroying actor %s"), *DestroyedActor.Name);
-		Level->GetWorld()->DestroyActor(Actor);
+		if (Level->GetWorld()->DestroyActor(Actor) && Telemetry)
+			++Telemetry->ActorsDestroyed;
 	}
 }
 
@@ -606,10 +992,13 @@ void USpudState::RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelD
 
 	if (ActorData)
 	{
+		if (Telemetry)
+			++Telemetry->ActorsRestored;
 		PreRestoreObject(Actor, LevelData->GetUserDataModelVersion());
 		
 		RestoreCoreActorData(Actor, ActorData->CoreData);
 		RestoreObjectProperties(Actor, ActorData->Properties, LevelData->Metadata, RuntimeObjects);
+		RestoreActorComponents(Actor, ActorData->Components, LevelData->Metadata, RuntimeObjects);
 
 		PostRestoreObject(Actor, ActorData->CustomData, LevelData->GetUserDataModelVersion());		
 	}
@@ -654,9 +1043,8 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 	uint16 InVersion = 0;
 	SpudPropertyUtil::ReadRaw(InVersion, In);
 
-	if (InVersion == 1)
+	if (InVersion == 1 || InVersion == 2)
 	{
-		// First, and only version right now
 		// V1 Format:
 		// - Version (uint16)
 		// - Hidden (bool)
@@ -664,6 +1052,8 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 		// - Velocity (FVector)
 		// - AngularVelocity (FVector)
 		// - Control rotation (FRotator) (non-zero for Pawns only)
+		// V2 adds:
+		// - Asleep (bool) (true for sleeping physics bodies only)
 
 		bool Hidden;
 		SpudPropertyUtil::ReadRaw(Hidden, In);
@@ -679,6 +1069,9 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 		FRotator ControlRotation;
 		SpudPropertyUtil::ReadRaw(ControlRotation, In);
 
+		bool bAsleep = false;
+		if (InVersion >= 2)
+			SpudPropertyUtil::ReadRaw(bAsleep, In);
 
 		auto Pawn = Cast<APawn>(Actor);
 		if (Pawn && Pawn->IsPlayerControlled() &&
@@ -710,8 +1103,17 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 					// it might not be at setup. We only want the *intention* to simulate physics, not whether it's currently happening
 					if (PrimComp && PrimComp->BodyInstance.bSimulatePhysics)
 					{
-						PrimComp->SetAllPhysicsLinearVelocity(Velocity);
-						PrimComp->SetAllPhysicsAngularVelocityInDegrees(AngularVelocity);
+						if (bDeferPhysicsVelocities)
+						{
+							// No physics bodies until the level is visible
+							DeferredVelocities.FindOrAdd(GetLevelNameForActor(Actor)).Add(
+								FSpudDeferredVelocity { PrimComp, Velocity, AngularVelocity });
+						}
+						else
+						{
+							PrimComp->SetAllPhysicsLinearVelocity(Velocity);
+							PrimComp->SetAllPhysicsAngularVelocityInDegrees(AngularVelocity);
+						}
 					}
 					else if (const auto	MoveComponent = Cast<UMovementComponent>(Actor->FindComponentByClass(UMovementComponent::StaticClass())))
 					{
@@ -719,6 +1121,35 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 					}
 				}
 			}
+
+			// Teleporting wakes bodies up, so resting bodies would all be simulated at once after a load
+			// Only the body is put to sleep, the component's bStartAwake is its setting and would stick if changed
+			if (bAsleep)
+			{
+				const auto PrimComp = Cast<UPrimitiveComponent>(RootComp);
+				if (PrimComp && PrimComp->BodyInstance.bSimulatePhysics)
+				{
+					if (bDeferPhysicsVelocities)
+					{
+						DeferredVelocities.FindOrAdd(GetLevelNameForActor(Actor)).Add(
+							FSpudDeferredVelocity { PrimComp, FVector::ZeroVector, FVector::ZeroVector, true });
+					}
+					else if (PrimComp->IsPhysicsStateCreated())
+					{
+						PrimComp->PutAllRigidBodiesToSleep();
+					}
+					else if (UWorld* World = Actor->GetWorld())
+					{
+						// The body is created when the component registers, which will have happened by then
+						TWeakObjectPtr<UPrimitiveComponent> WeakComp(PrimComp);
+						World->GetTimerManager().SetTimerForNextTick([WeakComp]()
+						{
+							if (WeakComp.IsValid() && WeakComp->IsPhysicsStateCreated())
+								WeakComp->PutAllRigidBodiesToSleep();
+						});
+					}
+				}
+			}
 		}
 
 		if (Pawn)
@@ -741,13 +1172,14 @@ void USpudState::RestoreObjectProperties(UObject* Obj, const FSpudPropertyData&
 	const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth)
 {
 	FMemoryReader In(FromData.Data);
-	RestoreObjectProperties(Obj, In, Meta, RuntimeObjects, StartDepth);
+	Meta.BeginPropertyStream();
+	RestoreObjectProperties(Obj, In, Meta, RuntimeObjects, StartDepth, &FromData.PropertyOffsets);
 
 }
 
 
 void USpudState::RestoreObjectProperties(UObject* Obj, FMemoryReader& In, const FSpudClassMetadata& Meta,
-	const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth)
+	const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth, const TArray<uint32>* PropertyOffsets)
 {
 	const auto ClassName = SpudPropertyUtil::GetClassName(Obj);
 	const auto ClassDef = Meta.GetClassDef(ClassName);
@@ -770,12 +1202,23 @@ void USpudState::RestoreObjectProperties(UObject* Obj, FMemoryReader& In, const
 	// force use of slow path for testing if needed
 	if (bTestRequireSlowPath)
 		bUseFastPath = false;
+
+	if (Telemetry)
+		++(bUseFastPath ? Telemetry->FastPathObjects : Telemetry->SlowPathObjects);
 	
 	
 	if (bUseFastPath)
-		RestoreObjectPropertiesFast(Obj, In, Meta, ClassDef, RuntimeObjects, StartDepth);
+	{
+		TSharedPtr<const FSpudCompiledSerializer> Compiled;
+		if (StartDepth == 0 && !bTestDisableCompiledSerializers)
+			Compiled = FSpudCompiledSerializers::Find(Obj->GetClass());
+		if (Compiled)
+			Compiled->Restore(Obj, Meta, In);
+		else
+			RestoreObjectPropertiesFast(Obj, In, Meta, ClassDef, RuntimeObjects, StartDepth);
+	}
 	else
-		RestoreObjectPropertiesSlow(Obj, In, Meta, ClassDef, RuntimeObjects, StartDepth);
+		RestoreObjectPropertiesSlow(Obj, In, Meta, ClassDef, RuntimeObjects, StartDepth, PropertyOffsets);
 }
 
 void USpudState::RestoreObjectPropertiesFast(UObject* Obj, FMemoryReader& In,
@@ -796,11 +1239,13 @@ void USpudState::RestoreObjectPropertiesSlow(UObject* Obj, FMemoryReader& In,
                                                        const FSpudClassMetadata& Meta,
                                                        TSharedPtr<const FSpudClassDef> ClassDef,
                                                        const TMap<FGuid, UObject*>* RuntimeObjects,
-                                                       int StartDepth)
+                                                       int StartDepth,
+                                                       const TArray<uint32>* PropertyOffsets)
 {
 	UE_LOG(LogSpudState, Verbose, TEXT("%s SLOW path, %d properties"), *SpudPropertyUtil::GetLogPrefix(StartDepth), ClassDef->Properties.Num());
 
-	RestoreSlowPropertyVisitor Visitor(this, In, ClassDef, Meta, RuntimeObjects);
+	// Compact bools are packed in the order they were written, so compact data can only be read in stream order
+	RestoreSlowPropertyVisitor Visitor(this, In, ClassDef, Meta, RuntimeObjects, Meta.IsCompact() ? nullptr : PropertyOffsets);
 	SpudPropertyUtil::VisitPersistentProperties(Obj, Visitor, StartDepth);
 }
 
@@ -816,6 +1261,19 @@ void USpudState::RestorePropertyVisitor::RestoreNestedUObjectIfNeeded(UObject* R
 {
 	if (SpudPropertyUtil::IsNestedUObjectProperty(Property))
 	{
+		// Follow what the stream says, not object identity: a shared instance's properties were only written once
+		const bool bBackReference = Meta.NestedObjects.bLastWasBackReference;
+		Meta.NestedObjects.bLastWasBackReference = false;
+		// A reference back to an object that hasn't been read yet (slow path, property order changed) was created
+		// from the original; read its properties from there then carry on where we were
+		const int64 MaterialisePos = Meta.NestedObjects.MaterialisePos;
+		Meta.NestedObjects.MaterialisePos = -1;
+		if (bBackReference && MaterialisePos < 0)
+			return;
+		const int64 ResumePos = DataIn.Tell();
+		if (MaterialisePos >= 0)
+			DataIn.Seek(MaterialisePos);
+
 		if (const auto OProp = CastField<FObjectProperty>(Property))
 		{
 			const void* DataPtr = Property->ContainerPtrToValuePtr<void>(ContainerPtr);
@@ -844,6 +1302,8 @@ void USpudState::RestorePropertyVisitor::RestoreNestedUObjectIfNeeded(UObject* R
 				}
 			}
 		}
+		if (MaterialisePos >= 0)
+			DataIn.Seek(ResumePos);
 	}	
 }
 
@@ -907,6 +1367,17 @@ bool USpudState::RestoreSlowPropertyVisitor::VisitProperty(UObject* RootObject,
 		return true;		
 	}
 	auto& StoredProperty = ClassDef->Properties[*PropertyIndexPtr];
+
+	// Properties may not be in stream order any more, so go to where this one was written if we know
+	if (PropertyOffsets)
+	{
+		if (!PropertyOffsets->IsValidIndex(*PropertyIndexPtr) || (*PropertyOffsets)[*PropertyIndexPtr] > DataIn.TotalSize())
+		{
+			UE_LOG(LogSpudState, Error, TEXT("Error in RestoreSlowPropertyVisitor, invalid data offset for %s on class %s"), *Property->GetName(), *ClassDef->ClassName);
+			return true;
+		}
+		DataIn.Seek((*PropertyOffsets)[*PropertyIndexPtr]);
+	}
 	
 	SpudPropertyUtil::RestoreProperty(RootObject, Property, ContainerPtr, StoredProperty, RuntimeObjects, Meta, Depth, DataIn);
 
@@ -940,6 +1411,81 @@ void USpudState::RestoreLoadedWorld(UWorld* World, bool bSingleLevel, const FStr
 
 }
 
+bool USpudState::CanRestoreLoadedWorldInPlace(UWorld* World)
+{
+	if (!IsValid(World))
+		return false;
+
+	FlushDestroyedActors();
+	for (auto& Level : World->GetLevels())
+	{
+		if (!IsValid(Level))
+			continue;
+
+		const FString LevelName = GetLevelName(Level);
+		auto LevelData = GetLevelData(LevelName, false);
+		if (!LevelData.IsValid())
+		{
+			UE_LOG(LogSpudState, Verbose, TEXT("Cannot restore in-place, no data for loaded level %s"), *LevelName);
+			return false;
+		}
+
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+
+		TSet<FString> DestroyedNames;
+		for (auto&& DestroyedActor : LevelData->DestroyedActors.Values)
+		{
+			DestroyedNames.Add(DestroyedActor->Name);
+		}
+		for (auto&& Pair : LevelData->LevelActors.Contents)
+		{
+			if (DestroyedNames.Contains(Pair.Key))
+				continue;
+
+			// Any actor we have state for must still be present, we can't resurrect destroyed level actors
+			const auto Actor = Cast<AActor>(StaticFindObject(AActor::StaticClass(), Level, *Pair.Key));
+			if (!IsValid(Actor))
+			{
+				UE_LOG(LogSpudState, Verbose, TEXT("Cannot restore in-place, actor %s missing from level %s"), *Pair.Key, *LevelName);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void USpudState::ResetLoadedWorldForInPlaceRestore(UWorld* World)
+{
+	if (!IsValid(World))
+		return;
+
+	for (auto& Level : World->GetLevels())
+	{
+		if (!IsValid(Level))
+			continue;
+
+		const FString LevelName = GetLevelName(Level);
+		UE_LOG(LogSpudState, Verbose, TEXT("RESET level %s for in-place restore"), *LevelName);
+		ReturnPooledActors(LevelName);
+		// Instances removed or moved since the level loaded may not be in the save being restored
+		ResetInstanceComponents(Level);
+		// Copy, destroying modifies Level->Actors
+		TArray<AActor*> Actors = Level->Actors;
+		for (auto Actor : Actors)
+		{
+			if (IsValid(Actor) &&
+				SpudPropertyUtil::IsPersistentObject(Actor) &&
+				!IsPooledActor(Actor) &&
+				ShouldActorBeRespawnedOnRestore(Actor))
+			{
+				UE_LOG(LogSpudState, Verbose, TEXT(" * Removing runtime actor %s"), *Actor->GetName());
+				World->DestroyActor(Actor);
+			}
+		}
+	}
+}
+
 void USpudState::RestoreGlobalObject(UObject* Obj)
 {
 	RestoreGlobalObject(Obj, GetGlobalObjectData(Obj, false));
@@ -955,14 +1501,88 @@ void USpudState::RestoreGlobalObject(UObject* Obj, const FSpudNamedObjectData* D
 	if (Data)
 	{
 		UE_LOG(LogSpudState, Verbose, TEXT("* RESTORE Global Object %s"), *Data->Name)
-		PreRestoreObject(Obj, SaveData.GlobalData.GetUserDataModelVersion());
-		
-		RestoreObjectProperties(Obj, Data->Properties, SaveData.GlobalData.Metadata, nullptr);
-
-		PostRestoreObject(Obj, Data->CustomData, SaveData.GlobalData.GetUserDataModelVersion());
+		RestoreObjectData(Obj, *Data, SaveData.GlobalData.Metadata);
 	}
 	
 }
+
+void USpudState::RestoreObjectData(UObject* Obj, const FSpudObjectData& Data, const FSpudClassMetadata& Meta)
+{
+	PreRestoreObject(Obj, Meta.GetUserDataModelVersion());
+	
+	RestoreObjectProperties(Obj, Data.Properties, Meta, nullptr);
+
+	PostRestoreObject(Obj, Data.CustomData, Meta.GetUserDataModelVersion());
+}
+
+bool USpudState::RestoreObjectSnapshot(const TArray<UObject*>& Objects, const FSpudObjectSnapshot& Snapshot)
+{
+	if (Objects.Num() != Snapshot.NumObjects)
+	{
+		UE_LOG(LogSpudState, Error, TEXT("Cannot restore object snapshot, it contains %d objects but %d were supplied"),
+		       Snapshot.NumObjects, Objects.Num());
+		return false;
+	}
+
+	for (int32 i = 0; i < Objects.Num(); ++i)
+	{
+		if (IsValid(Objects[i]))
+		{
+			UE_LOG(LogSpudState, Verbose, TEXT("* RESTORE Snapshot object: %s"), *Objects[i]->GetName());
+			RestoreObjectData(Objects[i], Snapshot.Objects[i], Snapshot.Metadata);
+		}
+	}
+	return true;
+}
+
+bool USpudState::RestoreObjectSnapshot(const TArray<UObject*>& Objects, const TArray<uint8>& InData)
+{
+	FSpudObjectSnapshot Snapshot;
+	if (!Snapshot.ReadFromBuffer(InData))
+		return false;
+	return RestoreObjectSnapshot(Objects, Snapshot);
+}
+
+bool USpudState::RestoreLevelSnapshot(ULevel* Level, const FSpudLevelSnapshot& Snapshot)
+{
+	if (!IsValid(Level))
+		return false;
+
+	const FString LevelName = GetLevelName(Level);
+	if (Snapshot.Level->Name != LevelName)
+	{
+		UE_LOG(LogSpudState, Error, TEXT("Cannot restore level snapshot of %s to level %s"), *Snapshot.Level->Name,
+		       *LevelName);
+		return false;
+	}
+
+	auto SnapshotLevel = Snapshot.Level;
+	FSpudScopeLock LevelLock(&SnapshotLevel->Mutex, &GSpudLevelLockStats);
+
+	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level snapshot %s - Start"), *LevelName);
+	for (auto Actor : Level->Actors)
+	{
+		if (SpudPropertyUtil::IsPersistentObject(Actor) && !ShouldActorBeRespawnedOnRestore(Actor))
+		{
+			RestoreActor(Actor, SnapshotLevel, nullptr);
+		}
+	}
+	for (auto&& DestroyedActor : SnapshotLevel->DestroyedActors.Values)
+	{
+		DestroyActor(*DestroyedActor, Level);
+	}
+	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level snapshot %s - Complete"), *LevelName);
+
+	return true;
+}
+
+bool USpudState::RestoreLevelSnapshot(ULevel* Level, const TArray<uint8>& InData)
+{
+	FSpudLevelSnapshot Snapshot;
+	if (!Snapshot.ReadFromBuffer(InData))
+		return false;
+	return RestoreLevelSnapshot(Level, Snapshot);
+}
 void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData)
 {
 	if (Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
@@ -983,6 +1603,7 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 	TArray<uint8>* pDestCoreData = nullptr;
 	FSpudPropertyData* pDestProperties = nullptr;
 	TArray<uint8>* pDestCustomData = nullptr;
+	FSpudComponentTable* pDestComponents = nullptr;
 	FSpudClassMetadata& Meta = LevelData->Metadata;
 	if (bRespawn)
 	{
@@ -992,6 +1613,7 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 			pDestCoreData = &ActorData->CoreData.Data;
 			pDestProperties = &ActorData->Properties;
 			pDestCustomData = &ActorData->CustomData.Data;
+			pDestComponents = &ActorData->Components;
 			Guid = ActorData->Guid;
 			Name = SpudPropertyUtil::GetLevelActorName(Actor);
 		}
@@ -1004,6 +1626,7 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 			pDestCoreData = &ActorData->CoreData.Data;
 			pDestProperties = &ActorData->Properties;
 			pDestCustomData = &ActorData->CustomData.Data;
+			pDestComponents = &ActorData->Components;
 			Name = ActorData->Name;
 		}
 	}
@@ -1020,6 +1643,9 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 	else
 		UE_LOG(LogSpudState, Verbose, TEXT(" * STORE Level Actor: %s/%s"), *LevelData->Name, *Name);
 
+	if (Telemetry)
+		++Telemetry->ActorsStored;
+
 	bool bIsCallback = Actor->GetClass()->ImplementsInterface(USpudObjectCallback::StaticClass());
 
 	if (bIsCallback)
@@ -1032,6 +1658,7 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 
 	// Now properties, visit all and write out
 	StoreObjectProperties(Actor, *pDestProperties, Meta);
+	StoreActorComponents(Actor, *pDestComponents, Meta);
 
 	if (bIsCallback)
 	{
@@ -1050,19 +1677,436 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 
 
 void USpudState::StoreLevelActorDestroyed(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData)
+{
+	StoreLevelActorDestroyed(SpudPropertyUtil::GetLevelActorName(Actor), *LevelData);
+}
+
+void USpudState::StoreLevelActorDestroyed(const FString& ActorName, FSpudLevelData& LevelData)
 {
 	// We don't check for duplicates, because it should only be possible to destroy a uniquely named level actor once
-	LevelData->DestroyedActors.Add(SpudPropertyUtil::GetLevelActorName(Actor));
+	LevelData.DestroyedActors.Add(ActorName);
+
+	// Nothing will ask for its blobs again
+	for (auto It = LevelData.Blobs.Contents.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Owner == ActorName)
+			It.RemoveCurrent();
+	}
+}
+
+void USpudState::BufferLevelActorDestroyed(AActor* Actor)
+{
+	ULevel* Level = Actor->GetLevel();
+	if (!Level)
+		return;
+
+	int32& Index = PendingDestroyedLevels.FindOrAdd(Level, INDEX_NONE);
+	if (Index == INDEX_NONE)
+	{
+		Index = PendingDestroyedActors.AddDefaulted();
+		PendingDestroyedActors[Index].LevelName = GetLevelName(Level);
+	}
+	PendingDestroyedActors[Index].ActorNames.Add(SpudPropertyUtil::GetLevelActorName(Actor));
+}
+
+void USpudState::FlushDestroyedActors()
+{
+	if (PendingDestroyedActors.Num() == 0)
+		return;
+
+	// Swap out first, paging in level data can't add more but keep this re-entrant anyway
+	TArray<FSpudPendingDestroyedActors> Pending = MoveTemp(PendingDestroyedActors);
+	PendingDestroyedActors.Reset();
+	PendingDestroyedLevels.Reset();
+
+	for (auto& LevelPending : Pending)
+	{
+		auto LevelData = GetLevelData(LevelPending.LevelName, true);
+		if (!LevelData.IsValid())
+			continue;
+
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+		for (const FString& ActorName : LevelPending.ActorNames)
+		{
+			StoreLevelActorDestroyed(ActorName, *LevelData);
+		}
+	}
+}
+
+/// Early-outs on the first persistent property
+class FSpudAnyPersistentPropertyVisitor : public SpudPropertyUtil::PropertyVisitor
+{
+public:
+	bool bFound = false;
+
+	virtual bool VisitProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID, void* ContainerPtr,
+	                           int Depth) override
+	{
+		bFound = true;
+		return false;
+	}
+	virtual uint32 GetNestedPrefix(FProperty* Prop, uint32 CurrentPrefixID) override { return SPUDDATA_PREFIXID_NONE; }
+};
+
+const TArray<FName>& USpudState::GetComponentPlan(AActor* Actor)
+{
+	if (const auto Existing = ComponentPlans.Find(Actor->GetClass()))
+		return *Existing;
+
+	// Every instance of a class has the same native & Blueprint components, so only work this out once
+	TArray<FName>& Plan = ComponentPlans.Add(Actor->GetClass());
+	TInlineComponentArray<UActorComponent*> Components(Actor);
+	for (const auto Component : Components)
+	{
+		if (Component->CreationMethod != EComponentCreationMethod::Native &&
+			Component->CreationMethod != EComponentCreationMethod::SimpleConstructionScript)
+			continue;
+
+		FSpudAnyPersistentPropertyVisitor Visitor;
+		SpudPropertyUtil::VisitPersistentProperties(Component->GetClass(), Visitor);
+		if (Visitor.bFound)
+			Plan.Add(Component->GetFName());
+	}
+	UE_LOG(LogSpudState, Verbose, TEXT("Class %s has %d persistent components"), *Actor->GetClass()->GetName(), Plan.Num());
+	return Plan;
+}
+
+void USpudState::StoreActorComponents(AActor* Actor, FSpudComponentTable& Table, FSpudClassMetadata& Meta)
+{
+	if (!Actor->GetClass()->ImplementsInterface(USpudObject::StaticClass()) ||
+		!ISpudObject::Execute_ShouldStoreComponents(Actor))
+	{
+		Table.Reset();
+		return;
+	}
+
+	const TArray<FName>& Plan = GetComponentPlan(Actor);
+	// Keep the entries, same components are stored every time so their allocations can be reused
+	Table.Components.SetNum(Plan.Num());
+	int32 NumStored = 0;
+	for (const FName& ComponentName : Plan)
+	{
+		const auto Component = FindObjectFast<UActorComponent>(Actor, ComponentName);
+		if (!IsValid(Component))
+			continue;
+
+		const bool bIsCallback = Component->GetClass()->ImplementsInterface(USpudObjectCallback::StaticClass());
+		if (bIsCallback)
+			ISpudObjectCallback::Execute_SpudPreStore(Component, this);
+
+		auto& Data = Table.Components[NumStored++];
+		Data.Name = ComponentName.ToString();
+		UE_LOG(LogSpudState, Verbose, TEXT("   Component: %s"), *Data.Name);
+		StoreObjectProperties(Component, Data.Properties, Meta);
+
+		if (bIsCallback)
+			ISpudObjectCallback::Execute_SpudPostStore(Component, this);
+	}
+	Table.Components.SetNum(NumStored);
+}
+
+void USpudState::RestoreActorComponents(AActor* Actor, const FSpudComponentTable& Table,
+                                        const FSpudClassMetadata& Meta,
+                                        const TMap<FGuid, UObject*>* RuntimeObjects)
+{
+	for (auto && Data : Table.Components)
+	{
+		const auto Component = FindObjectFast<UActorComponent>(Actor, FName(*Data.Name));
+		if (!IsValid(Component))
+		{
+			UE_LOG(LogSpudState, Warning, TEXT("Unable to restore component %s of %s, not found"), *Data.Name, *Actor->GetName());
+			continue;
+		}
+
+		// Components don't have custom data, same as nested UObjects
+		const bool bIsCallback = Component->GetClass()->ImplementsInterface(USpudObjectCallback::StaticClass());
+		if (bIsCallback)
+			ISpudObjectCallback::Execute_SpudPreRestore(Component, this);
+
+		UE_LOG(LogSpudState, Verbose, TEXT("   Component: %s"), *Data.Name);
+		RestoreObjectProperties(Component, Data.Properties, Meta, RuntimeObjects);
+
+		if (bIsCallback)
+			ISpudObjectCallback::Execute_SpudPostRestore(Component, this);
+	}
+}
+
+FSpudInstanceComponentData* USpudState::GetInstanceComponentData(UInstancedStaticMeshComponent* Component,
+                                                                 FSpudSaveData::TLevelDataPtr LevelData)
+{
+	const FString Name = SpudPropertyUtil::GetLevelActorName(Component->GetOwner()) + TEXT(".") + Component->GetName();
+	auto& Data = LevelData->InstanceComponents.Contents.FindOrAdd(Name);
+	if (Data.Name.IsEmpty())
+	{
+		// Instances are only ever hidden, so the count is still what was placed in the level
+		Data.Name = Name;
+		Data.NumInstances = Component->GetInstanceCount();
+		Data.Removed.Init(false, Data.NumInstances);
+	}
+	else if (Data.NumInstances != Component->GetInstanceCount())
+	{
+		UE_LOG(LogSpudState, Error, TEXT("Instance count of %s has changed from %d to %d, instances must be removed via USpudState"),
+		       *Name, Data.NumInstances, Component->GetInstanceCount());
+		return nullptr;
+	}
+	return &Data;
+}
+
+void USpudState::RemoveInstances(UInstancedStaticMeshComponent* Component, const TArray<int32>& Indices)
+{
+	if (!IsValid(Component) || !Component->GetOwner())
+		return;
+
+	auto LevelData = GetLevelData(GetLevelNameForObject(Component->GetOwner()), true);
+	if (!LevelData.IsValid())
+		return;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+	auto Data = GetInstanceComponentData(Component, LevelData);
+	if (!Data)
+		return;
+
+	for (int32 Index : Indices)
+	{
+		if (!Component->IsValidInstance(Index) || Data->Removed[Index])
+			continue;
+
+		RecordPlacedInstanceTransform(Component, Index);
+		// Keep the location so that bounds aren't affected
+		FTransform XForm;
+		Component->GetInstanceTransform(Index, XForm);
+		XForm.SetScale3D(FVector::ZeroVector);
+		Component->UpdateInstanceTransform(Index, XForm, false, false, true);
+		Data->Removed[Index] = true;
+		Data->Modified.Remove(Index);
+	}
+	Component->MarkRenderStateDirty();
+}
+
+void USpudState::SetInstanceTransform(UInstancedStaticMeshComponent* Component, int32 Index,
+                                      const FTransform& Transform)
+{
+	if (!IsValid(Component) || !Component->GetOwner() || !Component->IsValidInstance(Index))
+		return;
+
+	auto LevelData = GetLevelData(GetLevelNameForObject(Component->GetOwner()), true);
+	if (!LevelData.IsValid())
+		return;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+	auto Data = GetInstanceComponentData(Component, LevelData);
+	if (!Data || Data->Removed[Index])
+		return;
+
+	RecordPlacedInstanceTransform(Component, Index);
+	Component->UpdateInstanceTransform(Index, Transform, false, true, true);
+	Data->Modified.Add(Index, Transform);
+}
+
+void USpudState::RecordPlacedInstanceTransform(UInstancedStaticMeshComponent* Component, int32 Index)
+{
+	auto& Transforms = PlacedInstanceTransforms.FindOrAdd(Component);
+	if (!Transforms.Contains(Index))
+	{
+		FTransform XForm;
+		Component->GetInstanceTransform(Index, XForm);
+		Transforms.Add(Index, XForm);
+	}
+}
+
+void USpudState::ResetInstanceComponents(ULevel* Level)
+{
+	for (auto It = PlacedInstanceTransforms.CreateIterator(); It; ++It)
+	{
+		UInstancedStaticMeshComponent* Component = It.Key().ResolveObjectPtr();
+		if (!IsValid(Component))
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		if (Component->GetComponentLevel() != Level)
+			continue;
+
+		for (auto&& Placed : It.Value())
+		{
+			if (Component->IsValidInstance(Placed.Key))
+				Component->UpdateInstanceTransform(Placed.Key, Placed.Value, false, false, true);
+		}
+		Component->MarkRenderStateDirty();
+		It.RemoveCurrent();
+	}
+}
+
+FString USpudState::GetBlobOwnerName(AActor* Actor) const
+{
+	// Same keys as the actor's own data, so blobs can be dropped along with it
+	if (ShouldActorBeRespawnedOnRestore(Actor))
+	{
+		const FGuid Guid = SpudPropertyUtil::GetGuidProperty(Actor);
+		return Guid.IsValid() ? Guid.ToString(SPUDDATA_GUID_KEY_FORMAT) : FString();
+	}
+	return SpudPropertyUtil::GetLevelActorName(Actor);
+}
+
+void USpudState::StoreBlob(AActor* Actor, const FString& BlobName, const TArray<uint8>& Data, bool bCompress)
+{
+	if (!IsValid(Actor))
+		return;
+
+	const FString Owner = GetBlobOwnerName(Actor);
+	if (Owner.IsEmpty())
+	{
+		UE_LOG(LogSpudState, Error, TEXT("Cannot store blob %s for %s, runtime actors need a valid SpudGuid"),
+		       *BlobName, *Actor->GetName());
+		return;
+	}
+
+	auto LevelData = GetLevelData(GetLevelNameForActor(Actor), true);
+	if (!LevelData.IsValid())
+		return;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+	const FString Name = Owner + TEXT("/") + BlobName;
+	auto& Blob = LevelData->Blobs.Contents.FindOrAdd(Name);
+	Blob.Name = Name;
+	Blob.Owner = Owner;
+	Blob.SetData(Data, bCompress);
+}
+
+bool USpudState::HasBlob(AActor* Actor, const FString& BlobName)
+{
+	if (!IsValid(Actor))
+		return false;
+
+	auto LevelData = GetLevelData(GetLevelNameForActor(Actor), false);
+	if (!LevelData.IsValid())
+		return false;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+	return LevelData->Blobs.Contents.Contains(GetBlobOwnerName(Actor) + TEXT("/") + BlobName);
+}
+
+void USpudState::RemoveBlob(AActor* Actor, const FString& BlobName)
+{
+	if (!IsValid(Actor))
+		return;
+
+	auto LevelData = GetLevelData(GetLevelNameForActor(Actor), false);
+	if (!LevelData.IsValid())
+		return;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+	LevelData->Blobs.Contents.Remove(GetBlobOwnerName(Actor) + TEXT("/") + BlobName);
+}
+
+void USpudState::ReadBlobAsync(AActor* Actor, const FString& BlobName,
+                               TFunction<void(bool bSuccess, const TArray<uint8>& Data)> OnComplete)
+{
+	FSpudSaveData::TLevelDataPtr LevelData;
+	if (IsValid(Actor))
+		LevelData = GetLevelData(GetLevelNameForActor(Actor), false);
+	if (!LevelData.IsValid())
+	{
+		OnComplete(false, TArray<uint8>());
+		return;
+	}
+
+	const FString Name = GetBlobOwnerName(Actor) + TEXT("/") + BlobName;
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [LevelData, Name, OnComplete]()
+	{
+		// Only the file read needs the lock, decoding works on the immutable payload
+		TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Payload;
+		bool bCompressed = false;
+		int32 UncompressedSize = 0;
+		{
+			FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+			auto Blob = LevelData->Blobs.Contents.Find(Name);
+			if (Blob && Blob->LoadPayload())
+			{
+				Payload = Blob->Payload;
+				bCompressed = Blob->bCompressed;
+				UncompressedSize = Blob->UncompressedSize;
+			}
+		}
+
+		auto Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+		const bool bSuccess = Payload.IsValid() &&
+			FSpudBlobData::DecodePayload(*Payload, bCompressed, UncompressedSize, *Data);
+		AsyncTask(ENamedThreads::GameThread, [bSuccess, Data, OnComplete]()
+		{
+			OnComplete(bSuccess, *Data);
+		});
+	});
+}
+
+bool USpudState::ReadBlob(AActor* Actor, const FString& BlobName, TArray<uint8>& OutData)
+{
+	if (!IsValid(Actor))
+		return false;
+
+	auto LevelData = GetLevelData(GetLevelNameForActor(Actor), false);
+	if (!LevelData.IsValid())
+		return false;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
+	auto Blob = LevelData->Blobs.Contents.Find(GetBlobOwnerName(Actor) + TEXT("/") + BlobName);
+	return Blob && Blob->GetData(OutData);
+}
+
+void USpudState::RestoreInstanceComponents(ULevel* Level, FSpudLevelData& LevelData)
+{
+	for (auto&& KV : LevelData.InstanceComponents.Contents)
+	{
+		const FSpudInstanceComponentData& Data = KV.Value;
+		FString ActorName, ComponentName;
+		Data.Name.Split(TEXT("."), &ActorName, &ComponentName);
+		const auto Actor = Cast<AActor>(StaticFindObject(AActor::StaticClass(), Level, *ActorName));
+		const auto Component = Actor ? FindObject<UInstancedStaticMeshComponent>(Actor, *ComponentName) : nullptr;
+		if (!Component)
+		{
+			UE_LOG(LogSpudState, Warning, TEXT("Unable to restore instances of %s, component not found"), *Data.Name);
+			continue;
+		}
+		if (Component->GetInstanceCount() != Data.NumInstances)
+		{
+			UE_LOG(LogSpudState, Warning, TEXT("Unable to restore instances of %s, the level now has %d instances instead of %d"),
+			       *Data.Name, Component->GetInstanceCount(), Data.NumInstances);
+			continue;
+		}
+
+		UE_LOG(LogSpudState, Verbose, TEXT(" * RESTORE Instances of %s"), *Data.Name);
+		// Only mark the render state dirty once for the whole component
+		for (auto&& Mod : Data.Modified)
+		{
+			RecordPlacedInstanceTransform(Component, Mod.Key);
+			Component->UpdateInstanceTransform(Mod.Key, Mod.Value, false, false, true);
+		}
+		for (TConstSetBitIterator<> It(Data.Removed); It; ++It)
+		{
+			RecordPlacedInstanceTransform(Component, It.GetIndex());
+			FTransform XForm;
+			Component->GetInstanceTransform(It.GetIndex(), XForm);
+			XForm.SetScale3D(FVector::ZeroVector);
+			Component->UpdateInstanceTransform(It.GetIndex(), XForm, false, false, true);
+		}
+		Component->MarkRenderStateDirty();
+	}
 }
 
 void USpudState::SaveToArchive(FArchive& SPUDAr)
 {
 	// We use separate read / write in order to more clearly support chunked file format
 	// with the backwards compatibility that comes with 
+	FlushDestroyedActors();
+	if (GSpudCanonicalOutput)
+		RebuildGlobalDataForCanonicalOutput();
 	FSpudChunkedDataArchive ChunkedAr(SPUDAr);
 	SaveData.PrepareForWrite();
 	// Use WritePaged in all cases; if all data is loaded it amounts to the same thing
 	SaveData.WriteToArchive(ChunkedAr, GetActiveGameLevelFolder());
+	// Chunks flag errors on the proxy, the caller checks the archive it gave us
+	if (ChunkedAr.IsError())
+		SPUDAr.SetError();
 
 }
 
@@ -1070,11 +2114,40 @@ void USpudState::LoadFromArchive(FArchive& SPUDAr, bool bFullyLoadAllLevelData)
 {
 	// Firstly, destroy any active game level files
 	RemoveAllActiveGameLevelFiles();
+	// Destroyed actors from the world being replaced are irrelevant
+	PendingDestroyedActors.Empty();
+	PendingDestroyedLevels.Empty();
+	StoredGlobalObjects.Empty();
 
 	Source = SPUDAr.GetArchiveName();
 	
 	FSpudChunkedDataArchive ChunkedAr(SPUDAr);
 	SaveData.ReadFromArchive(ChunkedAr, bFullyLoadAllLevelData, GetActiveGameLevelFolder());
+	if (Telemetry)
+		Telemetry->BytesRead += ChunkedAr.BytesRead;
+}
+
+void USpudState::SaveGlobalsToArchive(FArchive& SPUDAr, const FDateTime& Timestamp)
+{
+	if (GSpudCanonicalOutput)
+		RebuildGlobalDataForCanonicalOutput();
+	FSpudChunkedDataArchive ChunkedAr(SPUDAr);
+	SaveData.PrepareForWrite();
+	SaveData.WriteGlobalsToArchive(ChunkedAr, Timestamp);
+	if (ChunkedAr.IsError())
+		SPUDAr.SetError();
+}
+
+bool USpudState::LoadGlobalsFromArchive(FArchive& SPUDAr)
+{
+	FSpudChunkedDataArchive ChunkedAr(SPUDAr);
+	const bool bNewer = SaveData.ReadGlobalsFromArchive(ChunkedAr);
+	if (Telemetry)
+		Telemetry->BytesRead += ChunkedAr.BytesRead;
+	if (!bNewer)
+		return false;
+	StoredGlobalObjects.Empty();
+	return true;
 }
 
 bool USpudState::IsLevelDataLoaded(const FString& LevelName)
@@ -1089,6 +2162,7 @@ bool USpudState::IsLevelDataLoaded(const FString& LevelName)
 
 void USpudState::ClearLevel(const FString& LevelName)
 {
+	FlushDestroyedActors();
 	SaveData.DeleteLevelData(LevelName, GetActiveGameLevelFolder());
 }
 
@@ -1325,6 +2399,9 @@ bool USpudState::RenameProperty(const FString& ClassName, const FString& OldProp
 
 bool USpudState::RenameGlobalObject(const FString& OldName, const FString& NewName)
 {
+	TWeakObjectPtr<UObject> Stored;
+	if (StoredGlobalObjects.RemoveAndCopyValue(OldName, Stored))
+		StoredGlobalObjects.Add(NewName, Stored);
 	return SaveData.GlobalData.Objects.RenameObject(OldName, NewName);
 }
 
@@ -1333,7 +2410,7 @@ bool USpudState::RenameLevelObject(const FString& LevelName, const FString& OldN
 	auto LevelData = GetLevelData(LevelName, false);
 	if (LevelData.IsValid())
 	{
-		FScopeLock LevelLock(&LevelData->Mutex);
+		FSpudScopeLock LevelLock(&LevelData->Mutex, &GSpudLevelLockStats);
 
 		return LevelData->LevelActors.RenameObject(OldName, NewName);
 	}
@@ -1343,11 +2420,11 @@ bool USpudState::RenameLevelObject(const FString& LevelName, const FString& OldN
 TArray<FString> USpudState::GetLevelNames(bool bLoadedOnly)
 {
 	TArray<FString> Ret;
-	FScopeLock MapLock(&SaveData.LevelDataMapMutex);
+	FSpudScopeLock MapLock(&SaveData.LevelDataMapMutex, &GSpudLevelDataMapLockStats);
 	for (auto && Pair : SaveData.LevelDataMap)
 	{
 		auto Lvl = Pair.Value;
-		FScopeLock LvlLock(&Lvl->Mutex);
+		FSpudScopeLock LvlLock(&Lvl->Mutex, &GSpudLevelLockStats);
 		if (!bLoadedOnly || Lvl->Status != LDS_Unloaded)
 		{
 			Ret.Add(Lvl->Name);
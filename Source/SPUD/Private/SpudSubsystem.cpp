@@ -6,6 +6,10 @@
 #include "Kismet/GameplayStatics.h"
 #include "ImageUtils.h"
 #include "TimerManager.h"
+#include "Async/Async.h"
+#include "Serialization/MemoryWriter.h"
+
+#include <atomic>
 
 DEFINE_LOG_CATEGORY(LogSpudSubsystem)
 
@@ -13,6 +17,49 @@ DEFINE_LOG_CATEGORY(LogSpudSubsystem)
 #define SPUD_QUICKSAVE_SLOTNAME "__QuickSave__"
 #define SPUD_AUTOSAVE_SLOTNAME "__AutoSave__"
 
+/// Adds the game thread time within its scope to one phase of an operation's telemetry, along with time spent
+/// waiting for level data locks. Time already added to other phases by the state within the scope isn't counted
+/// twice. Optionally also collects counts from the state within the scope
+struct FSpudTelemetryScope
+{
+	FSpudOperationTelemetry& Telemetry;
+	float& Phase;
+	USpudState* State;
+	FSpudOperationTelemetry* PrevStateTelemetry = nullptr;
+	double StartTime;
+	float StartPhaseTotal;
+	uint64 StartLockWaitCycles;
+
+	FSpudTelemetryScope(FSpudOperationTelemetry& InTelemetry, float& InPhase, USpudState* InState = nullptr)
+		: Telemetry(InTelemetry), Phase(InPhase), State(InState)
+	{
+		if (State)
+		{
+			PrevStateTelemetry = State->Telemetry;
+			State->Telemetry = &Telemetry;
+		}
+		StartPhaseTotal = GetPhaseTotal();
+		StartLockWaitCycles = SpudGetThreadLockWaitCycles();
+		StartTime = FPlatformTime::Seconds();
+	}
+
+	~FSpudTelemetryScope()
+	{
+		const float ElapsedMs = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Phase += ElapsedMs - (GetPhaseTotal() - StartPhaseTotal);
+		Telemetry.GameThreadTimeMs += ElapsedMs;
+		Telemetry.LockWaitTimeMs += static_cast<float>(
+			FPlatformTime::ToMilliseconds64(SpudGetThreadLockWaitCycles() - StartLockWaitCycles));
+		if (State)
+			State->Telemetry = PrevStateTelemetry;
+	}
+
+	float GetPhaseTotal() const
+	{
+		return Telemetry.CaptureTimeMs + Telemetry.EncodeTimeMs + Telemetry.IOTimeMs + Telemetry.RestoreTimeMs;
+	}
+};
+
 
 void USpudSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
@@ -22,6 +69,7 @@ void USpudSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	OnPreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &USpudSubsystem::OnPreLoadMap);
 	
 	OnSeamlessTravelHandle = FWorldDelegates::OnSeamlessTravelTransition.AddUObject(this, &USpudSubsystem::OnSeamlessTravelTransition);
+	OnLevelAddedToWorldHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &USpudSubsystem::OnLevelAddedToWorld);
 	
 #if WITH_EDITORONLY_DATA
 	// The one problem we have is that in PIE mode, PostLoadMap doesn't get fired for the current map you're on
@@ -41,6 +89,7 @@ void USpudSubsystem::Deinitialize()
 	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(OnPostLoadMapHandle);
 	FCoreUObjectDelegates::PreLoadMap.Remove(OnPreLoadMapHandle);
 	FWorldDelegates::OnSeamlessTravelTransition.Remove(OnSeamlessTravelHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(OnLevelAddedToWorldHandle);
 }
 
 
@@ -156,6 +205,10 @@ void USpudSubsystem::OnPreLoadMap(const FString& MapName)
 			StoreWorld(World, true, true);
 		}
 	}
+
+	// Idle pooled actors belong to the world being left, they can't be reused in the next one
+	if (ActiveState)
+		ActiveState->EmptyActorPool();
 }
 
 void USpudSubsystem::OnSeamlessTravelTransition(UWorld* World)
@@ -187,7 +240,12 @@ void USpudSubsystem::OnPostLoadMap(UWorld* World)
 
 			auto State = GetActiveState();
 			PreLevelRestore.Broadcast(LevelName);
-			State->RestoreLoadedWorld(World);
+			auto Telemetry = BeginTelemetry(ESpudOperation::LevelRestore, LevelName);
+			{
+				FSpudTelemetryScope Scope(Telemetry, Telemetry.RestoreTimeMs, State);
+				State->RestoreLoadedWorld(World);
+			}
+			CompleteTelemetry(Telemetry, true);
 			PostLevelRestore.Broadcast(LevelName, true);
 
 			SubscribeLevelObjectEvents(World->GetCurrentLevel());
@@ -204,8 +262,25 @@ void USpudSubsystem::OnPostLoadMap(UWorld* World)
 	PostTravelToNewMap.Broadcast();
 }
 
+void USpudSubsystem::OnLevelAddedToWorld(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld() || !ActiveState || !ActiveState->HasDeferredVelocities(Level))
+		return;
+
+	// Same as restoring after visibility, velocities only stick once the bodies have been ticked
+	TWeakObjectPtr<ULevel> WeakLevel(Level);
+	FTimerHandle H;
+	World->GetTimerManager().SetTimer(H, [this, WeakLevel]()
+		{
+			if (WeakLevel.IsValid())
+				GetActiveState()->ApplyDeferredVelocities(WeakLevel.Get());
+		}, 0.01, false);
+}
+
 void USpudSubsystem::SaveGame(const FString& SlotName, const FText& Title, bool bTakeScreenshot, const USpudCustomSaveInfo* ExtraInfo)
 {
+	SaveTelemetry = BeginTelemetry(ESpudOperation::SaveGame, SlotName);
+
 	if (!ServerCheck(true))
 	{
 		SaveComplete(SlotName, false);
@@ -296,20 +371,24 @@ void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title,
 	// a) deleted objects must remain, they're built up over time
 	// b) we may not be updating all levels and must retain for the others
 
-	State->StoreWorldGlobals(World);
-	
-	for (auto Ptr : GlobalObjects)
-	{
-		if (Ptr.IsValid())
-			State->StoreGlobalObject(Ptr.Get());
-	}
-	for (auto Pair : NamedGlobalObjects)
 	{
-		if (Pair.Value.IsValid())
-			State->StoreGlobalObject(Pair.Value.Get(), Pair.Key);
+		FSpudTelemetryScope Scope(SaveTelemetry, SaveTelemetry.CaptureTimeMs, State);
+		State->StoreWorldGlobals(World);
+		
+		for (auto Ptr : GlobalObjects)
+		{
+			if (Ptr.IsValid())
+				State->StoreGlobalObject(Ptr.Get());
+		}
+		for (auto Pair : NamedGlobalObjects)
+		{
+			if (Pair.Value.IsValid())
+				State->StoreGlobalObject(Pair.Value.Get(), Pair.Key);
+		}
 	}
 
 	// Store any data that is currently active in the game world in the state object
+	// Each level has its own telemetry, which is added to the save's
 	StoreWorld(World, false, true);
 
 	State->SetTitle(Title);
@@ -324,14 +403,25 @@ void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title,
 	// I'm not sure if the save game system doesn't do this because of some console hardware issues, but
 	// I'll worry about that at some later point
 	IFileManager& FileMgr = IFileManager::Get();
-	auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*GetSaveGameFilePath(SlotName)));
+	TUniquePtr<FArchive> Archive;
+	{
+		FSpudTelemetryScope Scope(SaveTelemetry, SaveTelemetry.IOTimeMs);
+		Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*GetSaveGameFilePath(SlotName)));
+	}
 
 	bool SaveOK;
 	if(Archive)
 	{
-		State->SaveToArchive(*Archive);
-		// Always explicitly close to catch errors from flush/close
-		Archive->Close();
+		{
+			FSpudTelemetryScope Scope(SaveTelemetry, SaveTelemetry.EncodeTimeMs, State);
+			State->SaveToArchive(*Archive);
+		}
+		SaveTelemetry.BytesWritten += Archive->Tell();
+		{
+			// Always explicitly close to catch errors from flush/close
+			FSpudTelemetryScope Scope(SaveTelemetry, SaveTelemetry.IOTimeMs);
+			Archive->Close();
+		}
 
 		if (Archive->IsError() || Archive->IsCriticalError())
 		{
@@ -342,6 +432,8 @@ void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title,
 		{
 			UE_LOG(LogSpudSubsystem, Log, TEXT("Save to slot %s: Success"), *SlotName);
 			SaveOK = true;
+			// Globals saved separately are now out of date
+			FileMgr.Delete(*GetGlobalsSaveFilePath(SlotName), false, true, true);
 		}
 	}
 	else
@@ -360,6 +452,7 @@ void USpudSubsystem::SaveComplete(const FString& SlotName, bool bSuccess)
 	TitleInProgress = FText();
 	ExtraInfoInProgress = nullptr;
 	CurrentState = ESpudSystemState::RunningIdle;
+	CompleteTelemetry(SaveTelemetry, bSuccess);
 	PostSaveGame.Broadcast(SlotName, bSuccess);
 }
 
@@ -392,6 +485,8 @@ void USpudSubsystem::HandleLevelUnloaded(ULevel* Level)
 		// After storing, the level data is released so doesn't take up memory any more
 		StoreLevel(Level, true, false);
 	}
+	// Pooled actors respawned for this level aren't in it, so would outlive it otherwise
+	GetActiveState()->ReturnPooledActors(USpudState::GetLevelName(Level));
 }
 
 
@@ -408,12 +503,20 @@ void USpudSubsystem::StoreLevel(ULevel* Level, bool bRelease, bool bBlocking)
 {
 	const FString LevelName = USpudState::GetLevelName(Level);
 	PreLevelStore.Broadcast(LevelName);
-	GetActiveState()->StoreLevel(Level, bRelease, bBlocking);
+	auto Telemetry = BeginTelemetry(ESpudOperation::LevelStore, LevelName);
+	{
+		auto State = GetActiveState();
+		FSpudTelemetryScope Scope(Telemetry, Telemetry.CaptureTimeMs, State);
+		State->StoreLevel(Level, bRelease, bBlocking);
+	}
+	CompleteTelemetry(Telemetry, true);
 	PostLevelStore.Broadcast(LevelName, true);
 }
 
 void USpudSubsystem::LoadGame(const FString& SlotName)
 {
+	LoadTelemetry = BeginTelemetry(ESpudOperation::LoadGame, SlotName);
+
 	if (!ServerCheck(true))
 	{
 		LoadComplete(SlotName, false);
@@ -440,13 +543,23 @@ void USpudSubsystem::LoadGame(const FString& SlotName)
 	// TODO: async load
 
 	IFileManager& FileMgr = IFileManager::Get();
-	auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*GetSaveGameFilePath(SlotName)));
+	TUniquePtr<FArchive> Archive;
+	{
+		FSpudTelemetryScope Scope(LoadTelemetry, LoadTelemetry.IOTimeMs);
+		Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*GetSaveGameFilePath(SlotName)));
+	}
 
 	if(Archive)
 	{
-		// Load only global data and page in level data as needed
-		State->LoadFromArchive(*Archive, false);
-		Archive->Close();
+		{
+			// Load only global data and page in level data as needed
+			FSpudTelemetryScope Scope(LoadTelemetry, LoadTelemetry.EncodeTimeMs, State);
+			State->LoadFromArchive(*Archive, false);
+		}
+		{
+			FSpudTelemetryScope Scope(LoadTelemetry, LoadTelemetry.IOTimeMs);
+			Archive->Close();
+		}
 
 		if (Archive->IsError() || Archive->IsCriticalError())
 		{
@@ -462,42 +575,258 @@ void USpudSubsystem::LoadGame(const FString& SlotName)
 		return;
 	}
 
-	// Just do the reverse of what we did
-	// Global objects first before map, these should be only objects which survive map load
-	for (auto Ptr : GlobalObjects)
+	// Globals saved on their own since this full save was written take precedence
+	const FString GlobalsFilename = GetGlobalsSaveFilePath(SlotName);
+	if (FileMgr.FileExists(*GlobalsFilename))
 	{
-		if (Ptr.IsValid())
-			State->RestoreGlobalObject(Ptr.Get());
+		FSpudTelemetryScope Scope(LoadTelemetry, LoadTelemetry.EncodeTimeMs, State);
+		auto GlobalsArchive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*GlobalsFilename));
+		if (GlobalsArchive)
+		{
+			if (State->LoadGlobalsFromArchive(*GlobalsArchive))
+				UE_LOG(LogSpudSubsystem, Verbose, TEXT("Using newer global data from %s"), *GlobalsFilename);
+			GlobalsArchive->Close();
+		}
 	}
-	for (auto Pair : NamedGlobalObjects)
+
+	// Just do the reverse of what we did
+	// Global objects first before map, these should be only objects which survive map load
 	{
-		if (Pair.Value.IsValid())
-			State->RestoreGlobalObject(Pair.Value.Get(), Pair.Key);
+		FSpudTelemetryScope Scope(LoadTelemetry, LoadTelemetry.RestoreTimeMs, State);
+		for (auto Ptr : GlobalObjects)
+		{
+			if (Ptr.IsValid())
+				State->RestoreGlobalObject(Ptr.Get());
+		}
+		for (auto Pair : NamedGlobalObjects)
+		{
+			if (Pair.Value.IsValid())
+				State->RestoreGlobalObject(Pair.Value.Get(), Pair.Key);
+		}
 	}
 
-	// This is deferred, final load process will happen in PostLoadMap
 	SlotNameInProgress = SlotName;
-	UE_LOG(LogSpudSubsystem, Verbose, TEXT("(Re)loading map: %s"), *State->GetPersistentLevel());		
+
+	if (bLoadGameInPlaceIfSameMap && TryLoadGameInPlace(SlotName))
+		return;
+
+	// This is deferred, final load process will happen in PostLoadMap
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("(Re)loading map: %s"), *State->GetPersistentLevel());
 	UGameplayStatics::OpenLevel(GetWorld(), FName(State->GetPersistentLevel()));
 }
 
+bool USpudSubsystem::TryLoadGameInPlace(const FString& SlotName)
+{
+	const auto World = GetWorld();
+	if (!IsValid(World))
+		return false;
+
+	auto State = GetActiveState();
+	if (World->GetFName().ToString() != State->GetPersistentLevel() ||
+		!State->CanRestoreLoadedWorldInPlace(World))
+		return false;
+
+	const FString LevelName = UGameplayStatics::GetCurrentLevelName(World);
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Restoring map in-place: %s"), *LevelName);
+
+	// Re-subscribed afterwards since the set of level actors may change
+	UnsubscribeAllLevelObjectEvents();
+	{
+		FSpudTelemetryScope Scope(LoadTelemetry, LoadTelemetry.RestoreTimeMs);
+		State->ResetLoadedWorldForInPlaceRestore(World);
+	}
+
+	PreLevelRestore.Broadcast(LevelName);
+	auto Telemetry = BeginTelemetry(ESpudOperation::LevelRestore, LevelName);
+	{
+		FSpudTelemetryScope Scope(Telemetry, Telemetry.RestoreTimeMs, State);
+		State->RestoreLoadedWorld(World);
+	}
+	CompleteTelemetry(Telemetry, true);
+	PostLevelRestore.Broadcast(LevelName, true);
+
+	SubscribeAllLevelObjectEvents();
+
+	LoadComplete(SlotName, true);
+	UE_LOG(LogSpudSubsystem, Log, TEXT("Load: Success (in-place)"));
+	return true;
+}
+
 
 void USpudSubsystem::LoadComplete(const FString& SlotName, bool bSuccess)
 {
 	CurrentState = ESpudSystemState::RunningIdle;
 	SlotNameInProgress = "";
+	CompleteTelemetry(LoadTelemetry, bSuccess);
 	PostLoadGame.Broadcast(SlotName, bSuccess);
 }
 
+FSpudOperationTelemetry USpudSubsystem::BeginTelemetry(ESpudOperation Operation, const FString& Name)
+{
+	FSpudOperationTelemetry Telemetry;
+	Telemetry.Operation = Operation;
+	Telemetry.Name = Name;
+	Telemetry.StartTime = FPlatformTime::Seconds();
+	return Telemetry;
+}
+
+void USpudSubsystem::CompleteTelemetry(FSpudOperationTelemetry& Telemetry, bool bSuccess)
+{
+	Telemetry.bSuccess = bSuccess;
+	Telemetry.WallTimeMs = static_cast<float>((FPlatformTime::Seconds() - Telemetry.StartTime) * 1000.0);
+
+	// Levels stored / restored as part of a save or load count towards it too
+	if (Telemetry.Operation == ESpudOperation::LevelStore && IsSavingGame())
+		SaveTelemetry.Accumulate(Telemetry);
+	else if (Telemetry.Operation == ESpudOperation::LevelRestore && IsLoadingGame())
+		LoadTelemetry.Accumulate(Telemetry);
+
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Telemetry for %s %s: %.2fms wall, %.2fms game thread, %lld bytes read, %lld bytes written"),
+	       *UEnum::GetValueAsString(Telemetry.Operation), *Telemetry.Name, Telemetry.WallTimeMs,
+	       Telemetry.GameThreadTimeMs, Telemetry.BytesRead, Telemetry.BytesWritten);
+	LastTelemetry.Add(Telemetry.Operation, Telemetry);
+	PostOperationTelemetry.Broadcast(Telemetry);
+}
+
+FSpudOperationTelemetry USpudSubsystem::GetLastOperationTelemetry(ESpudOperation Operation) const
+{
+	return LastTelemetry.FindRef(Operation);
+}
+
 bool USpudSubsystem::DeleteSave(const FString& SlotName)
 {
 	if (!ServerCheck(true))
 		return false;
 	
 	IFileManager& FileMgr = IFileManager::Get();
+	FileMgr.Delete(*GetGlobalsSaveFilePath(SlotName), false, true, true);
 	return FileMgr.Delete(*GetSaveGameFilePath(SlotName), false, true);
 }
 
+bool USpudSubsystem::UpdateSaveGameInfo(const FString& SlotName, TFunctionRef<void(FSpudSaveInfo&)> Update)
+{
+	if (!ServerCheck(true))
+		return false;
+
+	if (CurrentState == ESpudSystemState::SavingGame || CurrentState == ESpudSystemState::LoadingGame)
+	{
+		UE_LOG(LogSpudSubsystem, Warning, TEXT("Cannot update save info for %s while a save or load is in progress"), *SlotName);
+		return false;
+	}
+
+	return FSpudSaveData::UpdateSaveInfoInFile(GetSaveGameFilePath(SlotName), Update);
+}
+
+bool USpudSubsystem::SetSaveGameTitle(const FString& SlotName, const FText& Title)
+{
+	return UpdateSaveGameInfo(SlotName, [&Title](FSpudSaveInfo& Info)
+	{
+		Info.Title = Title;
+	});
+}
+
+bool USpudSubsystem::SetSaveGameCustomInfo(const FString& SlotName, const USpudCustomSaveInfo* ExtraInfo)
+{
+	return UpdateSaveGameInfo(SlotName, [ExtraInfo](FSpudSaveInfo& Info)
+	{
+		if (ExtraInfo)
+			Info.CustomInfo = ExtraInfo->GetData();
+		else
+			Info.CustomInfo.Reset();
+	});
+}
+
+bool USpudSubsystem::SetSaveGameScreenshot(const FString& SlotName, const TArray<uint8>& ImageData)
+{
+	return UpdateSaveGameInfo(SlotName, [&ImageData](FSpudSaveInfo& Info)
+	{
+		Info.Screenshot.ImageData = ImageData;
+	});
+}
+
+bool USpudSubsystem::SaveGlobals(const FString& SlotName)
+{
+	if (!ServerCheck(true))
+		return false;
+
+	if (SlotName.IsEmpty())
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Cannot save globals with a blank slot name"));
+		return false;
+	}
+
+	if (CurrentState != ESpudSystemState::RunningIdle)
+	{
+		UE_LOG(LogSpudSubsystem, Warning, TEXT("Cannot save globals to %s while a save or load is in progress"), *SlotName);
+		return false;
+	}
+
+	auto Telemetry = BeginTelemetry(ESpudOperation::SaveGlobals, SlotName);
+	auto State = GetActiveState();
+	{
+		FSpudTelemetryScope Scope(Telemetry, Telemetry.CaptureTimeMs, State);
+		for (auto Ptr : GlobalObjects)
+		{
+			if (Ptr.IsValid())
+				State->StoreGlobalObject(Ptr.Get());
+		}
+		for (auto Pair : NamedGlobalObjects)
+		{
+			if (Pair.Value.IsValid())
+				State->StoreGlobalObject(Pair.Value.Get(), Pair.Key);
+		}
+	}
+
+	// Only encoding to memory happens here, file I/O is in the background
+	TSharedRef<TArray<uint8>, ESPMode::ThreadSafe> Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	{
+		FSpudTelemetryScope Scope(Telemetry, Telemetry.EncodeTimeMs, State);
+		FMemoryWriter Writer(*Data);
+		State->SaveGlobalsToArchive(Writer, FDateTime::Now());
+	}
+	// Written in the background, so success here only means it was queued
+	Telemetry.BytesWritten = Data->Num();
+	CompleteTelemetry(Telemetry, true);
+
+	static std::atomic<uint64> GlobalsSaveSequence { 0 };
+	const uint64 Sequence = ++GlobalsSaveSequence;
+	const FString Filename = GetGlobalsSaveFilePath(SlotName);
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Data, Filename, Sequence]()
+	{
+		// Background tasks can run out of order, never overwrite a newer globals save with an older one
+		static FCriticalSection WriteMutex;
+		static TMap<FString, uint64> LastWritten;
+		FScopeLock Lock(&WriteMutex);
+		if (LastWritten.FindRef(Filename) > Sequence)
+			return;
+
+		// Write to a temp file and move it into place so there's never a partial file
+		IFileManager& FileMgr = IFileManager::Get();
+		const FString TempFilename = Filename + TEXT(".tmp");
+		auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*TempFilename));
+		bool bOK = false;
+		if (Archive)
+		{
+			Archive->Serialize(Data->GetData(), Data->Num());
+			Archive->Close();
+			bOK = !Archive->IsError() && !Archive->IsCriticalError();
+			Archive.Reset();
+			bOK = bOK && FileMgr.Move(*Filename, *TempFilename, true, true);
+		}
+		if (bOK)
+		{
+			LastWritten.Add(Filename, Sequence);
+			UE_LOG(LogSpudSubsystem, Verbose, TEXT("Saved globals to %s"), *Filename);
+		}
+		else
+		{
+			UE_LOG(LogSpudSubsystem, Error, TEXT("Error while saving globals to %s"), *Filename);
+		}
+	});
+
+	return true;
+}
+
 void USpudSubsystem::AddPersistentGlobalObject(UObject* Obj)
 {
 	GlobalObjects.AddUnique(TWeakObjectPtr<UObject>(Obj));	
@@ -637,34 +966,53 @@ void USpudSubsystem::LoadStreamLevel(FName LevelName, bool Blocking)
 
 void USpudSubsystem::PostLoadStreamLevel(int32 LinkID)
 {
-	FScopeLock PendingLoadLock(&LevelsPendingLoadMutex);
-	
-	// We should be able to obtain the level name
-	if (LevelsPendingLoad.Contains(LinkID))
-	{
-		FName LevelName = LevelsPendingLoad.FindAndRemoveChecked(LinkID);
-
-		// This might look odd but for physics restoration to work properly we need a very specific
-		// set of circumstances:
-		// 1. Level must be made visible first
-		// 2. We need to wait for all the objects to be ticked at least once
-		// 3. Then we restore
-		//
-		// Failure to do this means SetPhysicsLinearVelocity etc just does *nothing* silently
-
-		// Make visible
-		auto StreamLevel = UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName);
-		if (StreamLevel)
+	FName LevelName;
+	{
+		// Only hold the lock while looking up the request, the rest can take a while
+		FScopeLock PendingLoadLock(&LevelsPendingLoadMutex);
+		// We should be able to obtain the level name
+		if (!LevelsPendingLoad.RemoveAndCopyValue(LinkID, LevelName))
 		{
-			StreamLevel->SetShouldBeVisible(true);
-		}		
-
-		HandleLevelLoaded(LevelName);
+			UE_LOG(LogSpudSubsystem, Error, TEXT("PostLoadStreamLevel called but not for a level we loaded??"));
+			return;
+		}
 	}
-	else
+
+	if (bRestoreStreamLevelsBeforeVisible)
 	{
-		UE_LOG(LogSpudSubsystem, Error, TEXT("PostLoadStreamLevel called but not for a level we loaded??"));
+		// Loaded but not visible, so nothing has ticked yet; restore as soon as possible & make visible afterwards
+		// Load the level data here in case this is the loading thread, but the restore itself must be on the game thread
+		GetActiveState()->PreLoadLevelData(LevelName.ToString());
+		if (IsInGameThread())
+		{
+			PostLoadStreamLevelGameThread(LevelName);
+		}
+		else
+		{
+			AsyncTask(ENamedThreads::GameThread, [this, LevelName]()
+			{
+				PostLoadStreamLevelGameThread(LevelName);
+			});
+		}
+		return;
 	}
+
+	// This might look odd but for physics restoration to work properly we need a very specific
+	// set of circumstances:
+	// 1. Level must be made visible first
+	// 2. We need to wait for all the objects to be ticked at least once
+	// 3. Then we restore
+	//
+	// Failure to do this means SetPhysicsLinearVelocity etc just does *nothing* silently
+
+	// Make visible
+	auto StreamLevel = UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName);
+	if (StreamLevel)
+	{
+		StreamLevel->SetShouldBeVisible(true);
+	}		
+
+	HandleLevelLoaded(LevelName);
 }
 
 
@@ -685,7 +1033,15 @@ void USpudSubsystem::PostLoadStreamLevelGameThread(FName LevelName)
 		// It's important to note that this streaming level won't be added to UWorld::Levels yet
 		// This is usually where things like the TActorIterator get actors from, ULevel::Actors
 		// we have the ULevel here right now, so restore it directly
-		GetActiveState()->RestoreLevel(Level);
+		auto Telemetry = BeginTelemetry(ESpudOperation::LevelRestore, LevelName.ToString());
+		{
+			auto State = GetActiveState();
+			FSpudTelemetryScope Scope(Telemetry, Telemetry.RestoreTimeMs, State);
+			if (bRestoreStreamLevelsBeforeVisible && !Level->bIsVisible)
+				State->RestoreLevelBeforeVisible(Level);
+			else
+				State->RestoreLevel(Level);
+		}
 
 		// NB: after restoring the level, we could release MOST of the memory for this level
 		// However, we don't for 2 reasons:
@@ -694,6 +1050,7 @@ void USpudSubsystem::PostLoadStreamLevelGameThread(FName LevelName)
 		//    memory thrashing to re-use the same memory we have until unload, since it'll likely be almost identical in structure
 		StreamLevel->SetShouldBeVisible(true);
 		SubscribeLevelObjectEvents(Level);
+		CompleteTelemetry(Telemetry, true);
 		PostLevelRestore.Broadcast(LevelName.ToString(), true);
 	}
 }
@@ -744,6 +1101,36 @@ int32 USpudSubsystem::GetUserDataModelVersion() const
 	return GCurrentUserDataModelVersion;
 }
 
+void USpudSubsystem::SetCompactDataFormat(bool bCompact)
+{
+	GSpudDataFormat = bCompact ? SDF_Compact : SDF_FixedWidth;
+}
+
+bool USpudSubsystem::IsCompactDataFormat() const
+{
+	return GSpudDataFormat == SDF_Compact;
+}
+
+void USpudSubsystem::SetCompressedLevelDataBudget(int32 BudgetMB)
+{
+	GSpudCompressedLevelDataBudget = static_cast<int64>(FMath::Max(BudgetMB, 0)) * 1024 * 1024;
+}
+
+int32 USpudSubsystem::GetCompressedLevelDataBudget() const
+{
+	return static_cast<int32>(GSpudCompressedLevelDataBudget / (1024 * 1024));
+}
+
+void USpudSubsystem::SetCanonicalOutput(bool bCanonical)
+{
+	GSpudCanonicalOutput = bCanonical;
+}
+
+bool USpudSubsystem::IsCanonicalOutput() const
+{
+	return GSpudCanonicalOutput;
+}
+
 void USpudSubsystem::PostUnloadStreamLevel(int32 LinkID)
 {
 	FScopeLock PendingUnloadLock(&LevelsPendingUnloadMutex);
@@ -827,8 +1214,9 @@ void USpudSubsystem::OnActorDestroyed(AActor* Actor)
 		// Ignore actor destruction caused by levels being unloaded
 		if (Level && !Level->bIsBeingRemoved)
 		{
+			// Mass destruction can fire thousands of these in a frame, so just buffer them until the next tick
 			auto State = GetActiveState();
-			State->StoreLevelActorDestroyed(Actor);
+			State->BufferLevelActorDestroyed(Actor);
 		}
 	}
 }
@@ -942,6 +1330,12 @@ FString USpudSubsystem::GetSaveGameFilePath(const FString& SlotName)
 	return FString::Printf(TEXT("%s%s.sav"), *GetSaveGameDirectory(), *SlotName);
 }
 
+FString USpudSubsystem::GetGlobalsSaveFilePath(const FString& SlotName)
+{
+	// Different extension so it's not listed as a save
+	return FString::Printf(TEXT("%s%s.gsav"), *GetSaveGameDirectory(), *SlotName);
+}
+
 void USpudSubsystem::ListSaveGameFiles(TArray<FString>& OutSaveFileList)
 {
 	IFileManager& FM = IFileManager::Get();
@@ -1095,6 +1489,9 @@ USpudCustomSaveInfo* USpudSubsystem::CreateCustomSaveInfo()
 
 void USpudSubsystem::Tick(float DeltaTime)
 {
+	if (ActiveState)
+		ActiveState->FlushDestroyedActors();
+
 	if (ScreenshotTimeout > 0)
 	{
 		ScreenshotTimeout -= DeltaTime;
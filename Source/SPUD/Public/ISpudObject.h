@@ -52,6 +52,25 @@ public:
 	/// You can override this to true if you want this object to manage its own velocity on load.
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "SPUD Interface")
 	bool ShouldSkipRestoreVelocity() const; virtual bool ShouldSkipRestoreVelocity_Implementation() const { return false; }
+
+	/// Return whether the SaveGame properties of this actor's components should be stored along with it. Components
+	/// which have SaveGame properties are found once per class, by name, and stored in a table with the actor; you
+	/// don't need (and shouldn't have) SaveGame properties referencing them. Only components created natively or
+	/// in the Blueprint components list are included, since only those have names which are stable between runs.
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "SPUD Interface")
+	bool ShouldStoreComponents() const; virtual bool ShouldStoreComponents_Implementation() const { return false; }
+
+	/// Return whether runtime instances of this class should be pooled when they're respawned into streaming levels,
+	/// which is worth it for classes with lots of instances in areas that are often revisited (pickups, debris etc).
+	/// Instead of being destroyed when their level unloads, they're hidden & kept to be reused the next time an
+	/// instance of the same class is respawned. Called on the class default object.
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "SPUD Interface")
+	bool ShouldPoolOnRespawn() const; virtual bool ShouldPoolOnRespawn_Implementation() const { return false; }
+
+	/// Called on a pooled actor when it's returned to the pool. Reset anything that isn't restored from SaveGame
+	/// properties or core actor data, so that it's like a freshly spawned actor when it's next reused.
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "SPUD Interface")
+	void SpudResetForPool(); virtual void SpudResetForPool_Implementation() {}
 };
 
 UINTERFACE(MinimalAPI)
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpudData.h"
+#include "HAL/CriticalSection.h"
+
+// Bulk entities let things which aren't actors, such as Mass entities, be persisted with their level without
+// turning them into actors. Register an ISpudBulkEntityHandler, and whenever a level is stored or restored it's
+// given the chance to store / restore archetypes of entities, each as columns of blittable structs (see
+// SpudPropertyUtil::RegisterBlittableStruct), e.g. one column per fragment type:
+//
+//   auto& Archetype = Entities.AddArchetype("Deer", Num);
+//   FTransformFragment* Transforms = Entities.AddColumn<FTransformFragment>(Archetype);
+//   // ...copy each chunk's fragments into Transforms...
+//
+// Every column is one block of memory, so storing & restoring hundreds of thousands of entities is a handful of
+// memory copies. If a struct's layout changes, stored columns are converted field by field when read.
+
+/// Access to the bulk entities of one level, for ISpudBulkEntityHandler
+class SPUD_API FSpudBulkEntities
+{
+public:
+	FSpudBulkEntities(FSpudBulkArchetypeMap& InArchetypes, FSpudClassMetadata& InMeta);
+	/// Zeroes the padding of columns added through this, once the caller has filled them
+	~FSpudBulkEntities();
+
+	/// Add an archetype of NumEntities entities, replacing any of the same name, then add its columns with AddColumn.
+	/// The reference is only valid until the next archetype is added
+	FSpudBulkArchetypeData& AddArchetype(const FString& Name, int32 NumEntities);
+	/**
+	 * @brief Add a column of a registered blittable struct to an archetype
+	 * @return Uninitialised memory for NumEntities structs, for the caller to fill. Null if the struct isn't
+	 * registered as blittable or the archetype already has a column for it
+	 */
+	uint8* AddColumn(FSpudBulkArchetypeData& Archetype, const UScriptStruct* Struct);
+	template <typename T>
+	T* AddColumn(FSpudBulkArchetypeData& Archetype)
+	{
+		return reinterpret_cast<T*>(AddColumn(Archetype, T::StaticStruct()));
+	}
+
+	/// All archetypes stored for the level
+	const TMap<FString, FSpudBulkArchetypeData>& GetArchetypes() const { return Archetypes.Contents; }
+	const FSpudBulkArchetypeData* FindArchetype(const FString& Name) const { return Archetypes.Contents.Find(Name); }
+	/**
+	 * @brief Copy a column of an archetype out to NumEntities structs, converting it if the struct has changed
+	 * @param Archetype The archetype to read from
+	 * @param Struct The registered blittable struct of the column
+	 * @param OutValues NumEntities structs to populate. Fields which weren't stored are left alone when converting,
+	 * so these should be initialised
+	 * @return Whether the archetype has a column for this struct
+	 */
+	bool ReadColumn(const FSpudBulkArchetypeData& Archetype, const UScriptStruct* Struct, void* OutValues) const;
+	template <typename T>
+	bool ReadColumn(const FSpudBulkArchetypeData& Archetype, TArray<T>& OutValues) const
+	{
+		OutValues.SetNum(Archetype.NumEntities);
+		return ReadColumn(Archetype, T::StaticStruct(), OutValues.GetData());
+	}
+
+protected:
+	FSpudBulkArchetypeMap& Archetypes;
+	FSpudClassMetadata& Meta;
+	/// Columns added through this, by archetype name & layout hash
+	TArray<TPair<FString, uint32>> AddedColumns;
+};
+
+/// Implement to persist entities which aren't actors with the level they belong to
+/// @see FSpudBulkEntityHandlers
+class SPUD_API ISpudBulkEntityHandler
+{
+public:
+	virtual ~ISpudBulkEntityHandler() {}
+
+	/// Called when a level is stored, after its actors. Add archetypes for the entities which belong to Level
+	virtual void StoreBulkEntities(ULevel* Level, FSpudBulkEntities& Entities) = 0;
+	/// Called when a level is restored, after its actors. Create entities in bulk from the stored archetypes
+	virtual void RestoreBulkEntities(ULevel* Level, const FSpudBulkEntities& Entities) = 0;
+};
+
+/// Registry of bulk entity handlers, called for every level stored & restored
+class SPUD_API FSpudBulkEntityHandlers
+{
+public:
+	static void Register(TSharedRef<ISpudBulkEntityHandler> Handler);
+	static void Unregister(TSharedRef<ISpudBulkEntityHandler> Handler);
+
+	/// Call all handlers to store the bulk entities of a level. Caller should hold the level data Mutex
+	static void Store(ULevel* Level, FSpudLevelData& LevelData);
+	/// Call all handlers to restore the bulk entities of a level. Caller should hold the level data Mutex
+	static void Restore(ULevel* Level, FSpudLevelData& LevelData);
+
+protected:
+	static FRWLock& GetLock();
+	static TArray<TSharedRef<ISpudBulkEntityHandler>>& GetHandlers();
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpudData.h"
+#include "SpudPropertyUtil.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Tuple.h"
+#include <type_traits>
+
+// Compiled serializers let a C++ class skip reflection when storing / restoring its properties.
+// Declare the SaveGame properties of the class in a .cpp, in the same order they're declared in the class:
+//
+//   SPUD_PERSIST(AMyActor,
+//       SPUD_FIELD(Health),
+//       SPUD_FIELD(Ammo),
+//       SPUD_FIELD(Waypoints));
+//
+// The data written is identical to the reflection path, so saves can be read by either, and the slow path still
+// works if the class changes later. The field list is checked against reflection the first time it's needed; if it
+// doesn't match exactly (or the class has properties compiled serializers don't support, such as custom structs,
+// actor references and nested UObjects), a warning is logged and the class falls back to reflection.
+// Only applies to instances of exactly this class, not subclasses (e.g. Blueprints), which can add properties.
+// Fields must be accessible from where SPUD_PERSIST is used, and bitfield bools are not supported.
+
+/// Compile-time equivalent of SpudPropertyUtil::GetPropertyDataType & the property read / write for a member type
+template <typename T, typename Enable = void>
+struct TSpudCompiledField
+{
+	static constexpr bool bIsBool = std::is_same<T, bool>::value;
+	static uint16 GetDataType() { return SpudTypeInfo<T>::EnumType; }
+	static void Write(const T& Value, FArchive& Out, const FSpudClassMetadata& Meta)
+	{
+		SpudPropertyUtil::WriteEncoded(Value, Out, Meta);
+	}
+	static void Read(T& Value, FArchive& In, const FSpudClassMetadata& Meta)
+	{
+		SpudPropertyUtil::ReadEncoded(Value, In, Meta);
+	}
+};
+
+/// Enums are stored as uint16, like FEnumProperty
+template <typename T>
+struct TSpudCompiledField<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+	static constexpr bool bIsBool = false;
+	static uint16 GetDataType() { return SpudTypeInfo<SpudAnyEnum>::EnumType; }
+	static void Write(const T& Value, FArchive& Out, const FSpudClassMetadata& Meta)
+	{
+		SpudPropertyUtil::WriteEncoded(static_cast<uint16>(Value), Out, Meta);
+	}
+	static void Read(T& Value, FArchive& In, const FSpudClassMetadata& Meta)
+	{
+		uint16 Val;
+		SpudPropertyUtil::ReadEncoded(Val, In, Meta);
+		Value = static_cast<T>(Val);
+	}
+};
+
+/// Arrays are the count followed by the elements
+template <typename T>
+struct TSpudCompiledField<TArray<T>>
+{
+	static constexpr bool bIsBool = TSpudCompiledField<T>::bIsBool;
+	static uint16 GetDataType() { return ESST_ArrayOf | TSpudCompiledField<T>::GetDataType(); }
+	static void Write(const TArray<T>& Value, FArchive& Out, const FSpudClassMetadata& Meta)
+	{
+		const int32 Num = SpudPropertyUtil::WriteArrayCount(Value.Num(), Out, Meta);
+		for (int32 i = 0; i < Num; ++i)
+		{
+			TSpudCompiledField<T>::Write(Value[i], Out, Meta);
+		}
+	}
+	static void Read(TArray<T>& Value, FArchive& In, const FSpudClassMetadata& Meta)
+	{
+		Value.SetNum(SpudPropertyUtil::ReadArrayCount(In, Meta));
+		for (auto& Elem : Value)
+		{
+			TSpudCompiledField<T>::Read(Elem, In, Meta);
+		}
+	}
+};
+
+/// Description of one persisted field of a class
+template <typename ClassType, typename MemberType>
+struct TSpudPersistField
+{
+	using FieldInfo = TSpudCompiledField<MemberType>;
+
+	const TCHAR* Name;
+	MemberType ClassType::* Member;
+
+	void Write(const ClassType& Obj, FArchive& Out, const FSpudClassMetadata& Meta) const
+	{
+		FieldInfo::Write(Obj.*Member, Out, Meta);
+	}
+	void Read(ClassType& Obj, FArchive& In, const FSpudClassMetadata& Meta) const
+	{
+		FieldInfo::Read(Obj.*Member, In, Meta);
+	}
+};
+
+/// Member may be declared on a superclass of ClassType
+template <typename ClassType, typename OwnerType, typename MemberType>
+TSpudPersistField<ClassType, MemberType> SpudPersistField(const TCHAR* Name, MemberType OwnerType::* Member)
+{
+	return TSpudPersistField<ClassType, MemberType> { Name, Member };
+}
+
+/// Base class of a compiled serializer for the persistent properties of one C++ class
+class SPUD_API FSpudCompiledSerializer
+{
+public:
+	/// Name, data type and whether it's a bool, for checking against reflection
+	struct FFieldDesc
+	{
+		FString Name;
+		uint16 DataType;
+		bool bIsBool;
+	};
+
+	virtual ~FSpudCompiledSerializer() {}
+
+	virtual UClass* GetClass() const = 0;
+	virtual void GetFields(TArray<FFieldDesc>& OutFields) const = 0;
+
+	/// Store the properties of Obj, which must be exactly the class of this serializer
+	virtual void Store(const UObject* Obj, TSharedPtr<FSpudClassDef> ClassDef, TArray<uint32>& PropertyOffsets,
+	                   FSpudClassMetadata& Meta, FArchive& Out) const = 0;
+	/// Restore the properties of Obj, only valid when the stored class def matches the runtime class (fast path)
+	virtual void Restore(UObject* Obj, const FSpudClassMetadata& Meta, FArchive& In) const = 0;
+
+	/// Validate the field list against reflection and resolve properties. Returns whether this serializer can be used
+	bool Validate();
+
+protected:
+	/// Reflection properties matching the fields, resolved by Validate
+	TArray<FProperty*> Properties;
+
+	/// Must be called before writing each field, records the property in the class def like RegisterProperty
+	void RegisterField(int32 Index, bool bDirectIndex, TSharedPtr<FSpudClassDef> ClassDef,
+	                   TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out) const;
+	/// Whether properties in ClassDef are already exactly our fields, so that indexes can be used directly
+	bool CanUseDirectIndex(TSharedPtr<FSpudClassDef> ClassDef, const FSpudClassMetadata& Meta) const;
+};
+
+template <typename ClassType, typename... FieldTypes>
+class TSpudCompiledSerializer : public FSpudCompiledSerializer
+{
+protected:
+	TTuple<FieldTypes...> Fields;
+
+public:
+	TSpudCompiledSerializer(FieldTypes... InFields) : Fields(InFields...) {}
+
+	virtual UClass* GetClass() const override { return ClassType::StaticClass(); }
+
+	virtual void GetFields(TArray<FFieldDesc>& OutFields) const override
+	{
+		VisitTupleElements([&OutFields](const auto& Field)
+		{
+			using FieldInfo = typename std::decay<decltype(Field)>::type::FieldInfo;
+			OutFields.Add(FFieldDesc { Field.Name, FieldInfo::GetDataType(), FieldInfo::bIsBool });
+		}, Fields);
+	}
+
+	virtual void Store(const UObject* Obj, TSharedPtr<FSpudClassDef> ClassDef, TArray<uint32>& PropertyOffsets,
+	                   FSpudClassMetadata& Meta, FArchive& Out) const override
+	{
+		const ClassType& Typed = *static_cast<const ClassType*>(Obj);
+		const bool bDirectIndex = CanUseDirectIndex(ClassDef, Meta);
+		int32 Index = 0;
+		VisitTupleElements([&](const auto& Field)
+		{
+			RegisterField(Index++, bDirectIndex, ClassDef, PropertyOffsets, Meta, Out);
+			Field.Write(Typed, Out, Meta);
+		}, Fields);
+	}
+
+	virtual void Restore(UObject* Obj, const FSpudClassMetadata& Meta, FArchive& In) const override
+	{
+		ClassType& Typed = *static_cast<ClassType*>(Obj);
+		VisitTupleElements([&](const auto& Field)
+		{
+			Field.Read(Typed, In, Meta);
+		}, Fields);
+	}
+};
+
+/// Registry of compiled serializers, looked up per class when storing & restoring
+class SPUD_API FSpudCompiledSerializers
+{
+public:
+	static void Register(TSharedRef<FSpudCompiledSerializer> Serializer);
+	static void Unregister(TSharedRef<FSpudCompiledSerializer> Serializer);
+	/// Find a valid serializer for exactly this class, or null. Hold on to the pointer while using the serializer,
+	/// its module can unregister it on another thread
+	static TSharedPtr<const FSpudCompiledSerializer> Find(const UClass* Class);
+
+protected:
+	// Function statics since registration happens during static initialisation of other modules
+	static FRWLock& GetLock();
+	static TArray<TSharedRef<FSpudCompiledSerializer>>& GetPending();
+	static TMap<const UClass*, TSharedRef<FSpudCompiledSerializer>>& GetSerializers();
+	static void ResolvePending();
+};
+
+/// Registers a serializer for the lifetime of the module which declares it
+template <typename ClassType, typename... FieldTypes>
+struct TSpudCompiledSerializerRegistrar
+{
+	TSharedRef<FSpudCompiledSerializer> Serializer;
+
+	TSpudCompiledSerializerRegistrar(FieldTypes... InFields)
+		: Serializer(MakeShared<TSpudCompiledSerializer<ClassType, FieldTypes...>>(InFields...))
+	{
+		FSpudCompiledSerializers::Register(Serializer);
+	}
+	~TSpudCompiledSerializerRegistrar()
+	{
+		FSpudCompiledSerializers::Unregister(Serializer);
+	}
+};
+
+template <typename ClassType, typename... FieldTypes>
+TSpudCompiledSerializerRegistrar<ClassType, FieldTypes...>* MakeSpudCompiledSerializerRegistrar(FieldTypes... InFields)
+{
+	static TSpudCompiledSerializerRegistrar<ClassType, FieldTypes...> Registrar(InFields...);
+	return &Registrar;
+}
+
+#define SPUD_PERSIST(ClassType, ...) \
+	namespace SpudPersist_##ClassType \
+	{ \
+		using SpudPersistClass = ClassType; \
+		static const auto Registrar = MakeSpudCompiledSerializerRegistrar<ClassType>(__VA_ARGS__); \
+	}
+
+#define SPUD_FIELD(Name) SpudPersistField<SpudPersistClass>(TEXT(#Name), &SpudPersistClass::Name)
@@ -2,6 +2,8 @@
 
 #include "CoreMinimal.h"
 
+#include <atomic>
+
 DECLARE_LOG_CATEGORY_EXTERN(LogSpudData, Verbose, Verbose);
 
 extern int32 GCurrentUserDataModelVersion;
@@ -18,6 +20,7 @@ extern int32 GCurrentUserDataModelVersion;
 #define SPUDDATA_CLASSNAMEINDEX_MAGIC "CNIX"
 #define SPUDDATA_PROPERTYNAMEINDEX_MAGIC "PNIX"
 #define SPUDDATA_VERSIONINFO_MAGIC "VERS"
+#define SPUDDATA_DATAFORMAT_MAGIC "FMTV"
 #define SPUDDATA_NAMEDOBJECT_MAGIC "NOBJ"
 #define SPUDDATA_SPAWNEDACTOR_MAGIC "SPWN"
 #define SPUDDATA_DESTROYEDACTOR_MAGIC "KILL"
@@ -25,6 +28,7 @@ extern int32 GCurrentUserDataModelVersion;
 #define SPUDDATA_LEVELDATA_MAGIC "LEVL"
 #define SPUDDATA_GLOBALDATA_MAGIC "GLOB"
 #define SPUDDATA_GLOBALOBJECTLIST_MAGIC "GOBS"
+#define SPUDDATA_GLOBALOBJECTDIRECTORY_MAGIC "GODR"
 #define SPUDDATA_LEVELACTORLIST_MAGIC "LATS"
 #define SPUDDATA_SPAWNEDACTORLIST_MAGIC "SATS"
 #define SPUDDATA_DESTROYEDACTORLIST_MAGIC "DATS"
@@ -33,11 +37,38 @@ extern int32 GCurrentUserDataModelVersion;
 // custom per-object data
 #define SPUDDATA_CUSTOMDATA_MAGIC "CUST" 
 #define SPUDDATA_COREACTORDATA_MAGIC "CORA"
+#define SPUDDATA_STRUCTLAYOUTLIST_MAGIC "SLYS"
+#define SPUDDATA_STRUCTLAYOUT_MAGIC "SLAY"
+#define SPUDDATA_OBJECTSNAPSHOT_MAGIC "SNAP"
+#define SPUDDATA_SNAPSHOTOBJECTLIST_MAGIC "SOBS"
+#define SPUDDATA_SNAPSHOTOBJECT_MAGIC "SOBJ"
+#define SPUDDATA_LEVELSNAPSHOT_MAGIC "LSNP"
+#define SPUDDATA_BULKARCHETYPELIST_MAGIC "BLKS"
+#define SPUDDATA_BULKARCHETYPE_MAGIC "BARC"
+#define SPUDDATA_INSTANCECOMPONENTLIST_MAGIC "INSS"
+#define SPUDDATA_INSTANCECOMPONENT_MAGIC "INST"
+#define SPUDDATA_COMPONENTTABLE_MAGIC "CMPS"
+#define SPUDDATA_BLOBLIST_MAGIC "BLBS"
+#define SPUDDATA_BLOB_MAGIC "BLOB"
+#define SPUDDATA_SAVEINFOPADDING_MAGIC "IPAD"
+#define SPUDDATA_SAVEINFOPOINTER_MAGIC "IPTR"
+
+// A chunk header Length of this value means the real length follows as a uint64 (see FSpudChunkHeader)
+#define SPUDDATA_LARGE_CHUNK_LENGTH 0xFFFFFFFF
+// Chunks estimated to be at least this big are written with a large header. Deliberately well below 4GB because
+// estimates are approximate, and the large header only costs 8 bytes
+#define SPUDDATA_LARGE_CHUNK_THRESHOLD 0x80000000LL
+
+// System version covers our internal format changes. Passed to ReadFromArchive of chunks which aren't read as part
+// of a whole save, e.g. level data written on its own
+#define SPUD_CURRENT_SYSTEM_VERSION 2
 
 #define SPUDDATA_INDEX_NONE 0xFFFFFFFF
 #define SPUDDATA_PROPERTYID_NONE 0xFFFFFFFF
 #define SPUDDATA_PREFIXID_NONE 0xFFFFFFFF
 #define SPUDDATA_CLASSID_NONE 0xFFFFFFFF
+/// Written instead of a class ID for a nested UObject already stored earlier in the same property stream
+#define SPUDDATA_CLASSID_BACKREF 0xFFFFFFFE
 
 // None of the structs in this file are exposed to Blueprints. They are theoretically available to external code
 // via C++ but honestly external code should just use the API on USpudSubsystem, or USpudState at a push (save upgrading)
@@ -52,6 +83,7 @@ extern int32 GCurrentUserDataModelVersion;
 // Header:
 // - MAGIC (char[4]) "SAVE"
 // - Total Data Length (uint32) (validation check, excluding header, including all nested chunks)
+//   If this is 0xFFFFFFFF it's a large header and the real length follows as a uint64. Any chunk can use this.
 // Data:
 // - Save Info Chunk
 // - Global Data Chunk
@@ -83,6 +115,8 @@ enum SPUD_API ESpudStorageType // (stored as uint16 but not using enum class to
     ESST_Transform = 22,
 	ESST_Guid = 23,
     	
+	/// A custom struct registered as blittable, stored as a single memory block (see SpudPropertyUtil::RegisterBlittableStruct)
+	ESST_BlittableStruct = 28,
 	ESST_CustomStruct = 29,
 
 	ESST_String = 30,
@@ -101,18 +135,110 @@ enum SPUD_API ESpudStorageType // (stored as uint16 but not using enum class to
 	
 };
 
+/// How scalar values are encoded in property data and the metadata chunks which describe it.
+/// Every FSpudClassMetadata records the format of the data it describes, since level data is paged in & out
+/// independently and so one save can contain levels written in either format.
+enum SPUD_API ESpudDataFormat
+{
+	/// Scalars at their natural fixed width, bools as one byte each, array counts as uint16 (max 65535 elements)
+	SDF_FixedWidth = 0,
+	/// Integers, enums, IDs and counts as varints (zig-zag for signed values), bools bit-packed per object,
+	/// no array element limit
+	SDF_Compact = 1
+};
+
+/// The format that newly generated metadata (and therefore newly stored objects) will use
+/// @see USpudSubsystem::SetCompactDataFormat
+extern SPUD_API ESpudDataFormat GSpudDataFormat;
+
+/// Budget in bytes for released level data kept compressed in memory rather than written to disk. 0 disables
+/// @see USpudSubsystem::SetCompressedLevelDataBudget
+extern SPUD_API int64 GSpudCompressedLevelDataBudget;
+
+/// Whether to write canonical output: maps & lists are written sorted by key, and actors are stored in a stable
+/// order so that IDs are assigned the same way, so identical state produces identical bytes.
+/// @see USpudSubsystem::SetCanonicalOutput
+extern SPUD_API bool GSpudCanonicalOutput;
+
+/// Bytes reserved after the save info when writing a save, so that its title, custom info & screenshot can be
+/// changed later without rewriting the rest of the file. @see FSpudSaveData::UpdateSaveInfoInFile
+extern SPUD_API int64 GSpudSaveInfoPadding;
+
+/// Total time the calling thread has spent waiting for level data locks, in cycles (see FPlatformTime::Cycles64).
+/// Take the difference across an operation to find out how long it was held up by other threads
+SPUD_API uint64 SpudGetThreadLockWaitCycles();
+
+/// Thread-safe count, total and maximum of a duration in cycles (see FPlatformTime::Cycles64). For diagnostics
+struct SPUD_API FSpudTimingStats
+{
+	std::atomic<uint64> Count { 0 };
+	std::atomic<uint64> TotalCycles { 0 };
+	std::atomic<uint64> MaxCycles { 0 };
+
+	void Add(uint64 Cycles);
+	void Reset();
+	double GetTotalMs() const { return FPlatformTime::ToMilliseconds64(TotalCycles); }
+	double GetMaxMs() const { return FPlatformTime::ToMilliseconds64(MaxCycles); }
+	double GetAverageMs() const { return Count > 0 ? GetTotalMs() / Count : 0; }
+};
+
+/// Contention stats for one kind of level data lock
+struct SPUD_API FSpudLockStats
+{
+	/// Waits for the lock, only when it was already held by another thread
+	FSpudTimingStats Waits;
+	/// How long the lock was held, for every acquisition
+	FSpudTimingStats Holds;
+
+	void Reset() { Waits.Reset(); Holds.Reset(); }
+};
+
+/// Whether to collect lock & background write stats below. Off by default since timing every lock isn't free.
+/// Atomic so it can be toggled while background threads are taking level data locks
+extern SPUD_API std::atomic<bool> GSpudCollectContentionStats;
+/// Stats for FSpudSaveData::LevelDataMapMutex
+extern SPUD_API FSpudLockStats GSpudLevelDataMapLockStats;
+/// Stats for FSpudLevelData::Mutex, across all levels
+extern SPUD_API FSpudLockStats GSpudLevelLockStats;
+/// Time from queueing a background level write & unload to it finishing
+extern SPUD_API FSpudTimingStats GSpudBackgroundWriteStats;
+
+/// Scope lock for the level data locks, which records the time spent waiting if the lock is contended, and
+/// if GSpudCollectContentionStats is set, wait & hold times in Stats
+class SPUD_API FSpudScopeLock
+{
+public:
+	explicit FSpudScopeLock(FCriticalSection* InMutex, FSpudLockStats* InStats = nullptr);
+	~FSpudScopeLock();
+
+	UE_NONCOPYABLE(FSpudScopeLock);
+
+private:
+	FCriticalSection* Mutex;
+	FSpudLockStats* Stats = nullptr;
+	uint64 AcquiredCycles = 0;
+};
+
 /// Common header for all data types
+/// There's a large variant for chunks over 4GB, where the 32-bit length is SPUDDATA_LARGE_CHUNK_LENGTH and a 64-bit
+/// length follows. Readers handle both automatically, writers decide which to use in FSpudChunk::ChunkStart
 struct SPUD_API FSpudChunkHeader
 {
 
 	uint32 Magic; // Identifier
-	uint32 Length; // Excluding header, including nested data
+	uint64 Length; // Excluding header, including nested data
+	bool bLarge; // Whether this is serialised as a large header
 
+	/// Size of a standard header, which is also the minimum size of any header
 	static constexpr int64 GetHeaderSize() { return sizeof(uint32) + sizeof(uint32); }
+	/// Size of a large header
+	static constexpr int64 GetLargeHeaderSize() { return GetHeaderSize() + sizeof(uint64); }
+	/// Size of this header when serialised
+	int64 GetSerializedSize() const { return bLarge ? GetLargeHeaderSize() : GetHeaderSize(); }
 
 	char MagicFriendly[4]; // not saved, for easier debugging
 
-	FSpudChunkHeader(): Magic(0), Length(0), MagicFriendly{' ', ' ', ' ', ' '}
+	FSpudChunkHeader(): Magic(0), Length(0), bLarge(false), MagicFriendly{' ', ' ', ' ', ' '}
 	{
 	}
 
@@ -137,10 +263,11 @@ struct SPUD_API FSpudChunkHeader
 		return FString(4, InMagic);
 	}
 
-	void Set(const char* InMagic, uint32 InLen)
+	void Set(const char* InMagic, uint64 InLen, bool bInLarge = false)
 	{
 		Magic = EncodeMagic(InMagic);
 		Length = InLen;
+		bLarge = bInLarge;
 		DecodeMagic(Magic, MagicFriendly);
 	}
 
@@ -152,7 +279,16 @@ struct SPUD_API FSpudChunkHeader
 	friend FArchive& operator<<(FArchive& Ar, FSpudChunkHeader& Data)
 	{
 		Ar << Data.Magic;
-		Ar << Data.Length;
+
+		uint32 ShortLength = Data.bLarge ? SPUDDATA_LARGE_CHUNK_LENGTH : static_cast<uint32>(Data.Length);
+		Ar << ShortLength;
+		if (Ar.IsLoading())
+		{
+			Data.bLarge = ShortLength == SPUDDATA_LARGE_CHUNK_LENGTH;
+			Data.Length = ShortLength;
+		}
+		if (Data.bLarge)
+			Ar << Data.Length;
 
 		if (Ar.IsLoading())
 			DecodeMagic(Data.Magic, Data.MagicFriendly);
@@ -161,6 +297,25 @@ struct SPUD_API FSpudChunkHeader
 	}
 };
 
+/**
+ * @brief Write an unsigned value as a varint: 7 bits per byte, least significant first, high bit set when more
+ * bytes follow. Values under 128 take a single byte.
+ * @param Ar Archive to write to
+ * @param Value The value to write
+ */
+SPUD_API void SpudWriteVarUInt(FArchive& Ar, uint64 Value);
+/// Read a varint written by SpudWriteVarUInt
+SPUD_API uint64 SpudReadVarUInt(FArchive& Ar);
+/**
+ * @brief Write a signed value as a zig-zag encoded varint (0, -1, 1, -2... map to 0, 1, 2, 3...) so that small
+ * negative values stay small.
+ * @param Ar Archive to write to
+ * @param Value The value to write
+ */
+SPUD_API void SpudWriteVarInt(FArchive& Ar, int64 Value);
+/// Read a zig-zag varint written by SpudWriteVarInt
+SPUD_API int64 SpudReadVarInt(FArchive& Ar);
+
 struct SPUD_API FSpudChunkedDataArchive : public FArchiveProxy
 {
 	FSpudChunkedDataArchive(FArchive& InInnerArchive)
@@ -175,6 +330,29 @@ struct SPUD_API FSpudChunkedDataArchive : public FArchiveProxy
 	bool NextChunkIs(uint32 EncodedMagic);
 	bool NextChunkIs(const char* Magic);
 	void SkipNextChunk();
+
+	virtual void Serialize(void* V, int64 Length) override
+	{
+		if (IsLoading())
+			BytesRead += Length;
+		FArchiveProxy::Serialize(V, Length);
+	}
+
+	/// Bytes actually read through this archive. Data seeked past, such as skipped chunks or lazy blob payloads,
+	/// isn't counted
+	int64 BytesRead = 0;
+
+	/// Magic of every chunk skipped while reading because the reader didn't recognise it, in the order they
+	/// were found. Reserved padding isn't included, since skipping it loses nothing
+	TArray<FString> SkippedChunks;
+
+	/// The format of scalar values within the chunks currently being read / written. This isn't stored in the
+	/// archive itself, it's set by level / global data from their FSpudClassMetadata
+	ESpudDataFormat DataFormat = SDF_FixedWidth;
+	bool IsCompact() const { return DataFormat == SDF_Compact; }
+	/// If set, the file this archive is reading from. Blob payloads are then left in the file and only read when
+	/// requested, instead of being loaded with everything else. Like DataFormat, this isn't stored in the archive
+	FString LazyBlobSource;
 };
 
 struct SPUD_API FSpudChunk
@@ -189,8 +367,14 @@ struct SPUD_API FSpudChunk
 	virtual const char* GetMagic() const = 0;
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) = 0;
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) = 0;
+	/// Approximate size of this chunk's data when written, used to decide whether it needs a large header
+	/// Only chunks which can realistically get near 4GB (containers) need to override this
+	virtual int64 EstimateSize() const { return 0; }
 
+	/// Start a chunk. When writing, the header size is picked based on EstimateSize()
 	bool ChunkStart(FArchive& Ar);
+	/// Start a chunk, using a specific size estimate if writing
+	bool ChunkStart(FArchive& Ar, int64 EstimatedSize);
 	void ChunkEnd(FArchive& Ar);
 	bool IsStillInChunk(FArchive& Ar) const;
 };
@@ -244,6 +428,55 @@ struct SPUD_API FSpudVersionInfo : public FSpudChunk
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
 };
 
+/// Records the ESpudDataFormat of the data alongside it. Only written when not SDF_FixedWidth, so that absence
+/// means fixed width and data from before this existed reads back unchanged
+struct SPUD_API FSpudDataFormatInfo : public FSpudVersionInfo
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_DATAFORMAT_MAGIC; }
+
+	ESpudDataFormat GetFormat() const { return static_cast<ESpudDataFormat>(Version); }
+	bool IsCompact() const { return Version == SDF_Compact; }
+};
+
+/// Transient state for bit-packing bools in a single stream of compact property data
+/// Bools are packed 8 to a byte in the order they're written; the byte is reserved in the stream when the first
+/// bool of each group is written
+struct SPUD_API FSpudBoolPackingState
+{
+	/// Position of the byte currently being filled (only used when writing)
+	int64 BytePos = -1;
+	uint8 Byte = 0;
+	/// Next bit to use within Byte, 8 means a new byte is needed
+	uint8 NextBit = 8;
+
+	void Reset() { BytePos = -1; Byte = 0; NextBit = 8; }
+};
+
+/// Nested UObjects seen so far in the property stream being read or written, so that an object referenced more than
+/// once is only stored once. Later references are stored as the stream offset where the object's class was written
+struct SPUD_API FSpudNestedObjectState
+{
+	/// Stream offset where each object written so far had its class written (only used when writing)
+	TMap<const UObject*, uint32> WrittenOffsets;
+	/// Objects read so far by the stream offset of their class, null if they couldn't be created (only used when
+	/// reading). By offset rather than order since the slow restore path doesn't read properties in stream order
+	TMap<uint32, UObject*> ReadObjects;
+	/// Whether the last nested UObject written / read was a reference back to one earlier in the stream, whose
+	/// properties must not be cascaded into again
+	bool bLastWasBackReference = false;
+	/// If the last nested UObject read was a reference to one that hadn't been read yet, where that object's
+	/// properties start, so they can be read from there. -1 otherwise
+	int64 MaterialisePos = -1;
+
+	void Reset()
+	{
+		WrittenOffsets.Reset();
+		ReadObjects.Reset();
+		bLastWasBackReference = false;
+		MaterialisePos = -1;
+	}
+};
+
 
 /// Definition of a class, to share property definitions
 struct SPUD_API FSpudClassDef : public FSpudChunk
@@ -329,6 +562,25 @@ struct SPUD_API FSpudCustomData : public FSpudDataHolder
 	virtual const char* GetMagic() const override { return SPUDDATA_CUSTOMDATA_MAGIC; }
 };
 
+/// Properties of one component of an actor, identified by the component's name
+struct SPUD_API FSpudComponentData
+{
+	FString Name;
+	FSpudPropertyData Properties;
+};
+
+/// Components stored along with an actor which opted in (see ISpudObject::ShouldStoreComponents)
+struct SPUD_API FSpudComponentTable : public FSpudChunk
+{
+	TArray<FSpudComponentData> Components;
+
+	virtual const char* GetMagic() const override { return SPUDDATA_COMPONENTTABLE_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override;
+	void Reset() { Components.Reset(); }
+};
+
 // Abstract general def of object data
 struct SPUD_API FSpudObjectData : public FSpudChunk
 {
@@ -338,6 +590,18 @@ struct SPUD_API FSpudObjectData : public FSpudChunk
 	FSpudPropertyData Properties;
 	// Chunk of custom data (may be empty, only present if ISpudCallback implementation populates it)
 	FSpudCustomData CustomData;
+	// Properties of components, only present for actors which opted in. Written after everything else so it's optional
+	FSpudComponentTable Components;
+
+	virtual int64 EstimateSize() const override
+	{
+		return CoreData.Data.Num() + Properties.Data.Num() + Properties.PropertyOffsets.Num() * sizeof(uint32) +
+			CustomData.Data.Num() + 3 * FSpudChunkHeader::GetHeaderSize() + Components.EstimateSize();
+	}
+
+protected:
+	void WriteComponentsToArchive(FSpudChunkedDataArchive& Ar);
+	void ReadComponentsFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion);
 };
 
 
@@ -395,14 +659,39 @@ struct FSpudStructMapData : public FSpudChunk
 
 	virtual const char* GetChildMagic() const = 0;
 
+	virtual int64 EstimateSize() const override
+	{
+		int64 Total = 0;
+		for (auto && Tuple : Contents)
+		{
+			Total += Tuple.Value.EstimateSize() + FSpudChunkHeader::GetHeaderSize();
+		}
+		return Total;
+	}
+
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override
 	{
 		if (ChunkStart(Ar))
 		{
-			// Just write values, those will write chunks
-			for (auto && Tuple : Contents)
+			// Hash order depends on history, not just contents. Sort the keys rather than the map, writing
+			// shouldn't change anything
+			if (GSpudCanonicalOutput)
 			{
-				Tuple.Value.WriteToArchive(Ar);
+				TArray<K> Keys;
+				Contents.GetKeys(Keys);
+				Keys.Sort();
+				for (const auto& Key : Keys)
+				{
+					Contents.FindChecked(Key).WriteToArchive(Ar);
+				}
+			}
+			else
+			{
+				// Just write values, those will write chunks
+				for (auto && Tuple : Contents)
+				{
+					Tuple.Value.WriteToArchive(Ar);
+				}
 			}
 			ChunkEnd(Ar);
 		}
@@ -498,10 +787,79 @@ struct FSpudNamedObjectMap : public FSpudStructMapData<FString /* FName or Guid
 	virtual bool RenameObject(const FString& OldName, const FString& NewName);
 };
 
+/// Location of one global object chunk within the global object list
+struct SPUD_API FSpudGlobalObjectDirectoryEntry
+{
+	FString Name;
+	/// Offset of the object chunk (including header) from the start of the global object list data
+	uint64 Offset;
+	/// Length of the object chunk including header
+	uint64 Length;
+
+	friend FArchive& operator<<(FArchive& Ar, FSpudGlobalObjectDirectoryEntry& Entry)
+	{
+		Ar << Entry.Name;
+		Ar << Entry.Offset;
+		Ar << Entry.Length;
+		return Ar;
+	}
+};
+
+/// Directory of global objects, written just before the global object list so that objects can be located
+/// without parsing the list. Older versions skip it and read the list as normal
+struct SPUD_API FSpudGlobalObjectDirectory : public FSpudChunk
+{
+	TArray<FSpudGlobalObjectDirectoryEntry> Entries;
+
+	virtual const char* GetMagic() const override { return SPUDDATA_GLOBALOBJECTDIRECTORY_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+};
+
+/// Global objects are kept encoded as they were read, and only decoded when first requested via Find(). When
+/// written, only objects which have been marked dirty (or were never encoded) are re-encoded, the rest are copied as-is.
+/// Contents only holds decoded objects, so use Find() rather than accessing it directly.
 struct FSpudGlobalObjectMap : public FSpudNamedObjectMap
 {
+	/// An encoded object chunk, within a buffer which may be shared with other objects
+	struct FEncodedObject
+	{
+		TSharedPtr<TArray<uint8>> Buffer;
+		int64 Offset;
+		int64 Length;
+	};
+	/// Every object as last read or written, by name. Decoded objects are also in Contents
+	TMap<FString, FEncodedObject> Encoded;
+	/// Decoded objects which have changed since they were encoded
+	TSet<FString> Dirty;
+	/// Data format of the Encoded objects
+	ESpudDataFormat EncodedFormat = SDF_FixedWidth;
+	/// Directory read just before the list, used & discarded when the list is read
+	FSpudGlobalObjectDirectory Directory;
+
 	virtual const char* GetMagic() const override { return SPUDDATA_GLOBALOBJECTLIST_MAGIC; }
 	virtual const char* GetChildMagic() const override { return SPUDDATA_NAMEDOBJECT_MAGIC; }
+
+	/// Find an object by name, decoding it if this is the first time it's been requested
+	FSpudNamedObjectData* Find(const FString& Name);
+	/// Add a new object, or return the existing one
+	FSpudNamedObjectData& FindOrAdd(const FString& Name);
+	/// Record that an object's data has changed, so it must be re-encoded when written
+	void MarkDirty(const FString& Name) { Dirty.Add(Name); }
+	/// Total number of objects, decoded or not
+	int32 Num() const;
+	/// Names of all objects, decoded or not
+	void GetNames(TArray<FString>& OutNames) const;
+	void Empty();
+
+	virtual bool RenameObject(const FString& OldName, const FString& NewName) override;
+	virtual int64 EstimateSize() const override;
+	/// Writes the directory, then the object list
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+
+protected:
+	void DecodeAll();
 };
 struct FSpudLevelActorMap : public FSpudNamedObjectMap
 {
@@ -518,6 +876,9 @@ struct FSpudDestroyedActorArray : public FSpudArray<FSpudDestroyedLevelActor>
 {
 	virtual const char* GetMagic() const override { return SPUDDATA_DESTROYEDACTORLIST_MAGIC; }
 	virtual const char* GetChildMagic() const override { return SPUDDATA_DESTROYEDACTOR_MAGIC; }
+	/// Sorted by name in canonical output, rather than in order of destruction
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual int64 EstimateSize() const override;
 
 	void Add(const FString& Name);
 };
@@ -588,7 +949,14 @@ struct FSpudIndex : public FSpudChunk
 		{
 			// We only store the array of values
 			// Technically dupes some data because TArray self-describes length but convenient
-			Ar << UniqueValues;
+			if (Ar.IsCompact())
+			{
+				SpudWriteVarUInt(Ar, UniqueValues.Num());
+				for (auto && Value : UniqueValues)
+					Ar << Value;
+			}
+			else
+				Ar << UniqueValues;
 			ChunkEnd(Ar);
 		}
 	}
@@ -598,7 +966,14 @@ struct FSpudIndex : public FSpudChunk
 		if (ChunkStart(Ar))
 		{
 			Empty();
-			Ar << UniqueValues;
+			if (Ar.IsCompact())
+			{
+				UniqueValues.SetNum(static_cast<int32>(SpudReadVarUInt(Ar)));
+				for (auto && Value : UniqueValues)
+					Ar << Value;
+			}
+			else
+				Ar << UniqueValues;
 			// Build the lookup
 			uint32 Num = static_cast<uint32>(UniqueValues.Num());
 			for (uint32 i = 0; i < Num; ++i)
@@ -622,6 +997,182 @@ struct FSpudPropertyNameIndex : public FSpudIndex<FString>
 	virtual const char* GetMagic() const override { return SPUDDATA_PROPERTYNAMEINDEX_MAGIC; }
 };
 
+/// One plain data field of a blittable struct, flattened so nested struct members are named "Outer.Inner"
+/// Offsets are from the start of the outermost struct
+struct SPUD_API FSpudStructLayoutField
+{
+	FString Name;
+	/// Property class name e.g. "FloatProperty", or the enum / struct name for those
+	FString TypeName;
+	uint32 Offset = 0;
+	uint32 Size = 0;
+	/// Only for bools, which may be bitfields
+	uint8 BoolMask = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FSpudStructLayoutField& Field)
+	{
+		Ar << Field.Name;
+		Ar << Field.TypeName;
+		Ar << Field.Offset;
+		Ar << Field.Size;
+		Ar << Field.BoolMask;
+		return Ar;
+	}
+	bool operator==(const FSpudStructLayoutField& Other) const
+	{
+		return Name == Other.Name && TypeName == Other.TypeName && Offset == Other.Offset &&
+			Size == Other.Size && BoolMask == Other.BoolMask;
+	}
+};
+
+/// The memory layout of a struct stored as a single block. Recorded in metadata so that if the struct layout
+/// changes, the stored blocks can still be converted field by field
+struct SPUD_API FSpudStructLayout : public FSpudChunk
+{
+	/// Path name of the struct
+	FString StructName;
+	/// Hash of Size & Fields, a mismatch means the memory block can't be copied directly
+	uint32 LayoutHash = 0;
+	uint32 Size = 0;
+	TArray<FSpudStructLayoutField> Fields;
+
+	/// Key value for indexing this item. Layouts are indexed by hash rather than name since data stored with
+	/// older layouts of the same struct can co-exist with new data in the same metadata
+	uint32 Key() const { return LayoutHash; }
+
+	void CalculateHash();
+	/// Zero the bytes (and unused bits of bitfield bytes) of Count structs which aren't part of any field. Padding is
+	/// uninitialised otherwise, so the same state could be stored as different bytes
+	void ZeroPadding(uint8* Data, int32 Count = 1) const;
+
+	virtual const char* GetMagic() const override { return SPUDDATA_STRUCTLAYOUT_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+};
+
+struct FSpudStructLayoutMap : public FSpudStructMapData<uint32 /* Layout hash */, FSpudStructLayout>
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_STRUCTLAYOUTLIST_MAGIC; }
+	virtual const char* GetChildMagic() const override { return SPUDDATA_STRUCTLAYOUT_MAGIC; }
+};
+
+/// Changes to the instances of an instanced static mesh (or foliage) component placed in a level, by the index of
+/// each instance as placed in the level
+/// @see USpudState::RemoveInstances
+struct SPUD_API FSpudInstanceComponentData : public FSpudChunk
+{
+	/// Level actor name, then "." and the component name
+	FString Name;
+	/// Number of instances the component had when placed in the level; if that changes the indexes are out of date
+	int32 NumInstances = 0;
+	/// Instances which have been removed. Stored run-length encoded
+	TBitArray<> Removed;
+	/// Instances which have been moved, with their new local transform
+	TMap<int32, FTransform> Modified;
+
+	/// Stored instance counts above this are treated as corrupt, since Removed is allocated from the count
+	static constexpr int32 MaxInstances = 64 * 1024 * 1024;
+
+	/// Key value for indexing this item; name is unique in the level
+	FString Key() const { return Name; }
+
+	virtual const char* GetMagic() const override { return SPUDDATA_INSTANCECOMPONENT_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override;
+};
+
+struct FSpudInstanceComponentMap : public FSpudStructMapData<FString, FSpudInstanceComponentData>
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_INSTANCECOMPONENTLIST_MAGIC; }
+	virtual const char* GetChildMagic() const override { return SPUDDATA_INSTANCECOMPONENT_MAGIC; }
+};
+
+/// A large blob of data stored for an actor alongside its level data, but separately from its custom data so that
+/// it's only read when requested. The payload may be compressed, and may still be in the level file it was read from
+/// @see USpudState::StoreBlob
+struct SPUD_API FSpudBlobData : public FSpudChunk
+{
+	/// Owner name, then "/" and the blob name
+	FString Name;
+	/// Level actor name or spawned actor GUID of the actor the blob belongs to
+	FString Owner;
+	bool bCompressed = false;
+	/// Size of the data once decompressed
+	int32 UncompressedSize = 0;
+	/// Size of the stored payload (compressed if bCompressed)
+	int32 PayloadSize = 0;
+	/// Stored payload, or null if it hasn't been read from SourceFile yet. Never modified once set, only replaced,
+	/// so it's safe to hold on to a reference & read it outside the level lock
+	TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Payload;
+	/// Non-persistent location of the payload if it hasn't been read yet
+	FString SourceFile;
+	int64 SourceOffset = 0;
+
+	/// Key value for indexing this item; name is unique in the level
+	FString Key() const { return Name; }
+
+	/// Replace the data, compressing it if requested & it makes it smaller
+	void SetData(const TArray<uint8>& Data, bool bCompress);
+	/// Read the payload from SourceFile if it hasn't been already. Caller should hold the level lock
+	bool LoadPayload();
+	/// Load & decode the data. Caller should hold the level lock
+	bool GetData(TArray<uint8>& OutData);
+	/// Decode a payload into the original data
+	static bool DecodePayload(const TArray<uint8>& InPayload, bool bIsCompressed, int32 InUncompressedSize,
+	                          TArray<uint8>& OutData);
+
+	virtual const char* GetMagic() const override { return SPUDDATA_BLOB_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override { return Name.Len() + Owner.Len() + PayloadSize + 16; }
+};
+
+struct FSpudBlobMap : public FSpudStructMapData<FString, FSpudBlobData>
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_BLOBLIST_MAGIC; }
+	virtual const char* GetChildMagic() const override { return SPUDDATA_BLOB_MAGIC; }
+
+	/// Whether any payloads are still only in the file they were read from
+	bool HasUnloadedPayloads() const;
+};
+
+/// One column of a bulk archetype: a registered blittable struct for every entity, in one contiguous block
+struct SPUD_API FSpudBulkColumn
+{
+	/// Layout of the struct, described in the metadata's StructLayouts
+	uint32 LayoutHash = 0;
+	/// Size of each element
+	uint32 Stride = 0;
+	/// NumEntities * Stride bytes
+	TArray<uint8> Data;
+};
+
+/// Entities which aren't actors (e.g. Mass entities), stored in bulk per archetype as structure-of-arrays columns,
+/// so that very large numbers of them can be stored & restored with a handful of memory copies.
+/// @see FSpudBulkEntities
+struct SPUD_API FSpudBulkArchetypeData : public FSpudChunk
+{
+	/// Name of the archetype, chosen by whatever stored it
+	FString Name;
+	int32 NumEntities = 0;
+	TArray<FSpudBulkColumn> Columns;
+
+	/// Key value for indexing this item; name is unique in the level
+	FString Key() const { return Name; }
+
+	virtual const char* GetMagic() const override { return SPUDDATA_BULKARCHETYPE_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override;
+};
+
+struct FSpudBulkArchetypeMap : public FSpudStructMapData<FString, FSpudBulkArchetypeData>
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_BULKARCHETYPELIST_MAGIC; }
+	virtual const char* GetChildMagic() const override { return SPUDDATA_BULKARCHETYPE_MAGIC; }
+};
+
 struct SPUD_API FSpudClassMetadata : public FSpudChunk
 {
 	/// Description of classes. This allows us to quickly find out what properties are available
@@ -631,14 +1182,31 @@ struct SPUD_API FSpudClassMetadata : public FSpudChunk
 	FSpudClassNameIndex ClassNameIndex;
 	/// Property Name string -> number index (also used for prefixes, but prefix and property name are separate to help name re-use)
 	FSpudPropertyNameIndex PropertyNameIndex;
+	/// Layouts of any blittable structs stored against this metadata. Only written when not empty
+	FSpudStructLayoutMap StructLayouts;
 
 	/// The user data model version number when this metadata was generated
 	/// @see USpudSubsystem::SetUserDataModelVersion
 	FSpudVersionInfo UserDataModelVersion;
+
+	/// The format of all property data described by this metadata. Picked up from GSpudDataFormat when the
+	/// metadata is created or reset, so everything stored against one metadata block always shares a format
+	FSpudDataFormatInfo DataFormat;
+
+	/// Bool packing state for the property stream currently being read or written against this metadata
+	/// Not persistent. @see BeginPropertyStream
+	mutable FSpudBoolPackingState BoolPacking;
+	/// Nested UObjects in the property stream currently being read or written. Not persistent
+	mutable FSpudNestedObjectState NestedObjects;
+	/// Classes already resolved from class IDs, so that each is only looked up once per load. Not persistent
+	mutable TMap<uint32, TWeakObjectPtr<UClass>> ResolvedClasses;
+
+	FSpudClassMetadata();
 	
 	virtual const char* GetMagic() const override { return SPUDDATA_METADATA_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override;
 
 
 	TSharedPtr<FSpudClassDef> FindOrAddClassDef(const FString& ClassName);
@@ -652,6 +1220,8 @@ struct SPUD_API FSpudClassMetadata : public FSpudChunk
 	const FString& GetClassNameFromID(uint32 ID) const;
 	uint32 FindOrAddClassIDFromName(const FString& Name);
 	uint32 GetClassIDFromName(const FString& Name) const;
+	/// Find (loading if necessary) the class for a class ID, or null if it no longer exists. Cached per class ID
+	UClass* ResolveClass(uint32 ClassID) const;
 	void Reset();
 
 	
@@ -660,13 +1230,24 @@ struct SPUD_API FSpudClassMetadata : public FSpudChunk
 	
 	bool IsUserDataModelOutdated() const { return UserDataModelVersion.Version != GCurrentUserDataModelVersion; }
 	uint32 GetUserDataModelVersion() const { return UserDataModelVersion.Version; }
+
+	ESpudDataFormat GetDataFormat() const { return DataFormat.GetFormat(); }
+	bool IsCompact() const { return DataFormat.IsCompact(); }
+	/// Must be called before reading or writing each top-level object's property data, to reset per-stream state
+	void BeginPropertyStream() const
+	{
+		BoolPacking.Reset();
+		NestedObjects.Reset();
+	}
 };
 
 enum SPUD_API ELevelDataStatus
 {
 	LDS_Unloaded,
 	LDS_BackgroundWriteAndUnload,
-	LDS_Loaded
+	LDS_Loaded,
+	/// Released, but kept in memory as a compressed copy of the level chunk
+	LDS_Compressed
 };
 
 struct SPUD_API FSpudGlobalData : public FSpudChunk
@@ -682,12 +1263,52 @@ struct SPUD_API FSpudGlobalData : public FSpudChunk
 	virtual const char* GetMagic() const override { return SPUDDATA_GLOBALDATA_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override { return Metadata.EstimateSize() + Objects.EstimateSize(); }
 	void Reset();
 	
 	bool IsUserDataModelOutdated() const { return Metadata.IsUserDataModelOutdated(); }
 	uint32 GetUserDataModelVersion() const { return Metadata.GetUserDataModelVersion(); }
 };
 
+/// One object in an object snapshot. Identified only by its position in the snapshot, so no name or core data
+struct SPUD_API FSpudSnapshotObjectData : public FSpudObjectData
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_SNAPSHOTOBJECT_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	void Reset();
+};
+
+/// A standalone snapshot of an arbitrary list of objects, independent of any save game.
+/// Self-describing, since it carries the system version and the class metadata shared by all objects in it.
+/// Re-using the same instance for repeated snapshots re-uses its buffers.
+/// @see USpudState::StoreObjectSnapshot
+struct SPUD_API FSpudObjectSnapshot : public FSpudChunk
+{
+	/// The system version the snapshot was written with
+	FSpudVersionInfo SystemVersion;
+	/// Class definitions etc for all objects in this snapshot
+	FSpudClassMetadata Metadata;
+	/// Object data, in the same order as the objects which were stored. Entries beyond NumObjects are spare
+	TArray<FSpudSnapshotObjectData> Objects;
+	/// Number of valid entries in Objects
+	int32 NumObjects = 0;
+
+	virtual const char* GetMagic() const override { return SPUDDATA_OBJECTSNAPSHOT_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override;
+	/// Clear the snapshot ready to hold Num objects, keeping allocated buffers
+	void Reset(int32 Num = 0);
+
+	/// Write the snapshot to a byte buffer, replacing its contents
+	void WriteToBuffer(TArray<uint8>& OutData);
+	/// Read a snapshot from a byte buffer written by WriteToBuffer. Returns false if the data isn't a valid snapshot
+	bool ReadFromBuffer(const TArray<uint8>& InData);
+
+	uint32 GetUserDataModelVersion() const { return Metadata.GetUserDataModelVersion(); }
+};
+
 struct SPUD_API FSpudLevelData : public FSpudChunk
 {
 	/// Level Name
@@ -707,6 +1328,14 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 	FSpudSpawnedActorMap SpawnedActors;
 	/// Actors which were present in the level at load time but have been subsequently destroyed
 	FSpudDestroyedActorArray DestroyedActors;
+	/// Non-actor entities stored in bulk by ISpudBulkEntityHandler implementations. Only written when not empty
+	FSpudBulkArchetypeMap BulkEntities;
+	/// Instanced static mesh & foliage instances which have been removed or moved. Like DestroyedActors, these are
+	/// recorded as they happen. Only written when not empty
+	FSpudInstanceComponentMap InstanceComponents;
+	/// Large blobs stored for actors. Like DestroyedActors, these persist across stores of the level, but are dropped
+	/// once their actor is no longer stored. Only written when not empty
+	FSpudBlobMap Blobs;
 
 	/// non-persistent status flag to support placeholder level data which is not currently loaded
 	ELevelDataStatus Status;
@@ -717,6 +1346,20 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 	bool IsLoaded();
 	/// Release the memory associated with this level but keep basic data like Name
 	void ReleaseMemory();
+
+	/// Non-persistent compressed copy of the entire level chunk, when Status is LDS_Compressed
+	TArray<uint8> CompressedData;
+	/// Size of the level chunk in CompressedData when decompressed
+	int32 UncompressedSize = 0;
+	/// Order levels were compressed in, so the oldest can be written to disk first when over budget
+	uint64 CompressedSequence = 0;
+	/// Compress the level chunk into CompressedData and release everything else. Returns false (and leaves the data
+	/// loaded) if it couldn't be compressed
+	bool Compress();
+	/// Decompress the level chunk from CompressedData without changing state
+	bool DecompressChunk(TArray<uint8>& OutChunk);
+	/// Decompress and read back the level data, becoming LDS_Loaded
+	bool Decompress();
 	
 	/// Key value for indexing this item; name is unique
 	FString Key() const { return Name; }
@@ -731,19 +1374,36 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 		  LevelActors(Other.LevelActors),
 		  SpawnedActors(Other.SpawnedActors),
 		  DestroyedActors(Other.DestroyedActors),
-		  Status(Other.Status)
+		  BulkEntities(Other.BulkEntities),
+		  InstanceComponents(Other.InstanceComponents),
+		  Blobs(Other.Blobs),
+		  Status(Other.Status),
+		  CompressedData(Other.CompressedData),
+		  UncompressedSize(Other.UncompressedSize),
+		  CompressedSequence(Other.CompressedSequence)
 	{
 	}
 
 	virtual const char* GetMagic() const override { return SPUDDATA_LEVELDATA_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	/// Caller should hold Mutex
+	virtual int64 EstimateSize() const override
+	{
+		// Headers of the lists, plus everything in them
+		return 8 * FSpudChunkHeader::GetHeaderSize() + Name.Len() * sizeof(TCHAR) + Metadata.EstimateSize() +
+			LevelActors.EstimateSize() + SpawnedActors.EstimateSize() + DestroyedActors.EstimateSize() +
+			BulkEntities.EstimateSize() + InstanceComponents.EstimateSize() + Blobs.EstimateSize();
+	}
 
 	/// Empty the lists of actors ready to be re-populated
 	virtual void PreStoreWorld();
+	/// Remove blobs whose owners aren't stored in this level any more. Caller should hold Mutex
+	void RemoveOrphanedBlobs();
 
 	/// Read just enough of the next level chunk to retrieve the name, then optionally return the read pointer to where it was
-	static bool ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool bReturnToStart, FString& OutLevelName, int64& OutDataSize);
+	/// OutChunkSize is the total size of the level chunk, including its header
+	static bool ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool bReturnToStart, FString& OutLevelName, int64& OutChunkSize);
 
 	void Reset();
 
@@ -786,6 +1446,40 @@ struct SPUD_API FSpudSaveCustomInfo : public FSpudChunk
 	void Reset();
 };
 
+/// Snapshot of the placed actors in one level, and the placed actors which have been destroyed, for example to send
+/// to a late-joining client. Runtime spawned actors aren't included, they're expected to replicate as normal.
+/// Self-describing like FSpudObjectSnapshot, and always uses the compact data format.
+/// @see USpudState::StoreLevelSnapshot
+struct SPUD_API FSpudLevelSnapshot : public FSpudChunk
+{
+	/// The system version the snapshot was written with
+	FSpudVersionInfo SystemVersion;
+	/// The snapshot data. SpawnedActors is always empty
+	TSharedPtr<FSpudLevelData, ESPMode::ThreadSafe> Level;
+
+	FSpudLevelSnapshot();
+
+	virtual const char* GetMagic() const override { return SPUDDATA_LEVELSNAPSHOT_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	virtual int64 EstimateSize() const override { return Level->EstimateSize(); }
+	/// Clear the snapshot ready to store the given level
+	void Reset(const FString& LevelName);
+
+	/**
+	 * @brief Remove placed actors whose data is identical in an earlier snapshot of the same level, e.g. one taken
+	 * just after the level was loaded, so only changed actors remain. Nothing is removed if the class metadata of
+	 * the baseline isn't compatible with this snapshot's, since the data can't be compared directly.
+	 * @return The number of actors removed
+	 */
+	int32 RemoveUnchangedActors(const FSpudLevelSnapshot& Baseline);
+
+	/// Write the snapshot to a byte buffer, replacing its contents
+	void WriteToBuffer(TArray<uint8>& OutData);
+	/// Read a snapshot from a byte buffer written by WriteToBuffer. Returns false if the data isn't a valid snapshot
+	bool ReadFromBuffer(const TArray<uint8>& InData);
+};
+
 /// Description of the save game, so we can just read this chunk to get info about it
 /// This is better than having a separate metadata file describing the save in order to get description, date/time etc
 /// because it means saves can just be copied as single standalone files
@@ -800,18 +1494,38 @@ struct SPUD_API FSpudSaveInfo : public FSpudChunk
 	FText Title;
 	/// Timestamp of the save. Used for display and also to find the latest save for "Continue" behaviour
 	FDateTime Timestamp;
+	/// The data format this save was written with. Level & global data also record their own format in their
+	/// metadata, which is what's used to decode them, since levels which weren't revisited keep the format they
+	/// were originally written in
+	FSpudDataFormatInfo DataFormat;
 	/// Custom fields to be made available in info header
 	FSpudSaveCustomInfo CustomInfo;
 	/// Optional screenshot
 	FSpudScreenshot Screenshot;
 
+	/// Bytes of padding to write after the info, so that it can be updated in place later. Not stored
+	int64 PaddingSize = 0;
+	/// Where the full info was read from, if it outgrew its padding and was moved to the end of the file; 0 if not.
+	/// Not stored, the info at the start of the file is then just a stub pointing there
+	int64 RelocatedOffset = 0;
+	/// Total size of the relocated info chunk, if RelocatedOffset is set
+	int64 RelocatedSize = 0;
+
 	// TODO: support custom data. Should be encapsulated in child chunk(s)
 	
 	virtual const char* GetMagic() const override { return SPUDDATA_SAVEINFO_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	/// Write the info, or if FullInfoOffset is non-zero, a stub without the screenshot & custom info which points
+	/// to the full info at that offset
+	void WriteToArchive(FSpudChunkedDataArchive& Ar, int64 FullInfoOffset);
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
 	
 	void Reset();
+
+protected:
+	/// Read the info, only following a pointer to relocated info if bFollowPointer is set. The relocated info is
+	/// read without it, so a corrupt pointer can't make reading recurse
+	void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion, bool bFollowPointer);
 };
 
 /// The top-level structure for the entire save file
@@ -828,6 +1542,12 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	TMap<FString, TLevelDataPtr> LevelDataMap;
 	// Mutex for altering the level data map
 	FCriticalSection LevelDataMapMutex;
+	/// Source of FSpudLevelData::CompressedSequence
+	std::atomic<uint64> NextCompressedSequence { 0 };
+	/// Number of background level writes queued which haven't finished yet
+	std::atomic<int32> PendingBackgroundWrites { 0 };
+
+	virtual ~FSpudSaveData() override;
 
 	virtual const char* GetMagic() const override { return SPUDDATA_SAVEGAME_MAGIC; }
 	void PrepareForWrite();
@@ -837,6 +1557,26 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	void WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& LevelPath);
 	/// Read the entire save file into memory
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+	/// Write only the save info and global data, i.e. a save with no level data. The info written has the given
+	/// timestamp, Info itself isn't changed
+	void WriteGlobalsToArchive(FSpudChunkedDataArchive& Ar, const FDateTime& Timestamp);
+	/**
+	 * @brief Change the info of an existing save file without rewriting the rest of it. The info is rewritten in
+	 * place using the padding reserved after it (@see GSpudSaveInfoPadding); if it's outgrown that, the full info
+	 * is moved to the end of the file and the info at the start becomes a stub pointing there. Readers which
+	 * don't know about relocated info still see the title & timestamp from the stub.
+	 * @param Filename The save file
+	 * @param Update Called to change the info that was read from the file
+	 * @return Whether the file was updated
+	 */
+	static bool UpdateSaveInfoInFile(const FString& Filename, TFunctionRef<void(FSpudSaveInfo&)> Update);
+	/**
+	 * @brief Read the global data from a save written by WriteGlobalsToArchive, replacing the current global data,
+	 * but only if it's newer than the current save info. The current level is kept, since it relates to level data.
+	 * @param Ar Archive to read from
+	 * @return Whether the global data was replaced
+	 */
+	bool ReadGlobalsFromArchive(FSpudChunkedDataArchive& Ar);
 
 	/**
 	 * @brief Read a save file with extra options. Options to pipe all level data chunks
@@ -853,9 +1593,10 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	 * @param LevelName The name of the level
 	 * @param bLoadIfNeeded Load (synchronously) if the level is present but unloaded
 	 * @param LevelPath The parent directory where level chunks can be found as separate files
+	 * @param OutBytesRead If set, incremented by the bytes read from the level file when it had to be loaded
 	 * @return The level data or null if not available
 	 */
-	virtual TLevelDataPtr GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath);
+	virtual TLevelDataPtr GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath, int64* OutBytesRead = nullptr);
 
 	
 	/**
@@ -869,6 +1610,8 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	/**
 	* @brief Write any loaded data for a single level to disk, and unload it from memory . It becomes part of the
 	* on-disk state for the active game which can later be re-combined with others into a single save game.
+	* If GSpudCompressedLevelDataBudget is set, the level is kept compressed in memory instead, and only the oldest
+	* compressed levels are written to disk when over budget.
 	* @param LevelName The name of the level
     * @param LevelPath The path in which to write the level data
 	*/
@@ -897,9 +1640,22 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 
 	/// Write Level Data to disk
 	static void WriteLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath);
+	/// Write a compressed level's chunk to disk and release it
+	static void WriteCompressedLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath);
+
+	/// Release loaded level data, compressing it in memory if there's a budget for that, otherwise writing it to disk.
+	/// Returns whether it was compressed
+	bool PageOutLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath);
+	/// Write the oldest compressed levels to disk until the compressed level data fits in GSpudCompressedLevelDataBudget
+	void EnforceCompressedLevelDataBudget(const FString& LevelPath);
+	/// Block until all queued background level writes have finished
+	void WaitForBackgroundWrites();
 
 	/// Utility method to read an archive just up to the end of the FSpudSaveInfo, and output details
 	static bool ReadSaveInfoFromArchive(FSpudChunkedDataArchive& Ar, FSpudSaveInfo& OutInfo);
+
+	/// Approximate size of all level data when written, including levels which will be piped from files in LevelPath
+	int64 EstimateLevelDataSize(const FString& LevelPath);
 };
 
 
@@ -911,3 +1667,4 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
  * @return The length of the data actually copied
  */
 int64 SpudCopyArchiveData(FArchive& InArchive, FArchive& OutArchive, int64 Length);
+
@@ -151,8 +151,39 @@ public:
 	 */
 	static bool IsBuiltInStructProperty(const FStructProperty* SProp);
 
+	/// Whether a property is a custom struct whose properties are visited individually (not builtin or blittable)
 	static bool IsCustomStructProperty(const FProperty* Property);
 
+	/**
+	 * @brief Register a custom struct to be stored as a single block of memory rather than property by property.
+	 * Only plain data structs are eligible: all properties must be numbers, bools, enums, or structs of the same.
+	 * The whole struct is copied, so every property is stored whether it's marked SaveGame or not, and any
+	 * non-UPROPERTY members must also be plain data. If the struct layout changes, data stored with the old
+	 * layout is converted field by field on restore.
+	 * Register at startup, before any state is stored or restored.
+	 * @param Struct The struct to register
+	 * @return Whether the struct was eligible and has been registered
+	 */
+	static bool RegisterBlittableStruct(const UScriptStruct* Struct);
+	template <typename T>
+	static bool RegisterBlittableStruct() { return RegisterBlittableStruct(T::StaticStruct()); }
+	static void UnregisterBlittableStruct(const UScriptStruct* Struct);
+	static bool IsBlittableStruct(const UScriptStruct* Struct);
+	static bool IsBlittableStructProperty(const FProperty* Property);
+	/// Get the runtime layout of a registered blittable struct, or null if not registered. Hold on to the pointer
+	/// while using the layout, registration can change on another thread
+	static TSharedPtr<const FSpudStructLayout> GetBlittableStructLayout(const UScriptStruct* Struct);
+	/// Copy fields which still exist with the same type from data in an old layout to a struct with a new layout
+	static void ConvertBlittableStructData(const FSpudStructLayout& FromLayout, const uint8* FromData,
+	                                       const FSpudStructLayout& ToLayout, uint8* ToData);
+	/**
+	 * @brief Get the column layout used to store arrays of a custom struct, or null if arrays of it can't be stored.
+	 * Arrays of custom structs are stored column-wise, one contiguous column per leaf field (numbers, bools, enums,
+	 * strings and names, including inside nested structs). The layout is recorded in the metadata alongside the
+	 * class defs, and columns are matched by name & type on restore so the struct can change between saves.
+	 */
+	static const FSpudStructLayout* GetColumnarStructLayout(const UScriptStruct* Struct);
+
 	/// Whether a property is an actor reference
 	static bool IsActorObjectProperty(const FProperty* Property);
 	/// Whether a property represents a nested UObject 
@@ -263,6 +294,38 @@ public:
 
 protected:
 	static bool IsValidArrayType(FArrayProperty* AProp);
+	static TMap<const UScriptStruct*, TSharedPtr<const FSpudStructLayout>>& GetBlittableStructs();
+	/// Column layouts of custom structs, null for structs that can't be stored in columns
+	static TMap<const UScriptStruct*, TSharedPtr<FSpudStructLayout>>& GetColumnarStructs();
+	/// Guards both struct layout maps, since levels can be stored & restored from other threads
+	static FRWLock& GetStructLayoutLock();
+	/// Add the plain data fields of a struct to a layout, returns false if any are not plain data (or strings / names
+	/// if allowed)
+	static bool BuildStructLayout(const UStruct* Struct, const FString& NamePrefix, uint32 BaseOffset, TArray<uint8>& ProbeBuffer, FSpudStructLayout& Layout,
+	                              bool bAllowStrings = false);
+	static void WriteColumnarStructArrayData(FStructProperty* SProp,
+	                                         FScriptArrayHelper& ArrayHelper,
+	                                         int32 NumElements,
+	                                         int Depth,
+	                                         FSpudClassMetadata& Meta,
+	                                         FArchive& Out);
+	static void ReadColumnarStructArrayData(FStructProperty* SProp,
+	                                        FScriptArrayHelper& ArrayHelper,
+	                                        int32 NumElements,
+	                                        int Depth,
+	                                        const FSpudClassMetadata& Meta,
+	                                        FArchive& In);
+	static void WriteBlittableStructPropertyData(FStructProperty* SProp,
+	                                             uint32 PrefixID,
+	                                             const void* Data,
+	                                             bool bIsArrayElement,
+	                                             int Depth,
+	                                             TSharedPtr<FSpudClassDef> ClassDef,
+	                                             TArray<uint32>& PropertyOffsets,
+	                                             FSpudClassMetadata& Meta,
+	                                             FArchive& Out);
+	static bool TryReadBlittableStructPropertyData(FStructProperty* SProp, void* Data, const FSpudPropertyDef& StoredProperty,
+	                                               int Depth, const FSpudClassMetadata& Meta, FArchive& In);
 	/// General recursive visitation of properties, returns false to early-out, object/container can be null
 	static bool VisitPersistentProperties(UObject* RootObject, const UStruct* Definition, uint32 PrefixID,
 	                                      void* ContainerPtr, bool IsChildOfSaveGame, int Depth,
@@ -294,9 +357,9 @@ protected:
 	{
     	if (!bIsArrayElement)
     		RegisterProperty(Prop, PrefixID, ClassDef, PropertyOffsets, Meta, Out);
-    	auto Val = static_cast<typename SpudTypeInfo<ValueType>::StorageType>(Prop->GetPropertyValue(Data)); // Cast in case we want to compress into smaller type
-    	Out << Val;
-    	return Val;
+    	const ValueType Val = Prop->GetPropertyValue(Data);
+    	WriteEncoded(Val, Out, Meta);
+    	return static_cast<typename SpudTypeInfo<ValueType>::StorageType>(Val);
     }
 
 
@@ -407,14 +470,13 @@ protected:
 	}
 	
 	template <class PropType, typename ValueType>
-    static typename SpudTypeInfo<ValueType>::StorageType ReadPropertyData(PropType* Prop, void* Data, FArchive& In)
+    static typename SpudTypeInfo<ValueType>::StorageType ReadPropertyData(PropType* Prop, void* Data, const FSpudClassMetadata& Meta, FArchive& In)
 	{
-		// Read as per storage type
-		typename SpudTypeInfo<ValueType>::StorageType Val;
-		In << Val;
-		// reverse the conversion we applied when writing to set property
-		Prop->SetPropertyValue(Data, static_cast<ValueType>(Val));
-		return Val;
+		// Read as per storage type / format, ReadEncoded reverses the conversion we applied when writing
+		ValueType Val;
+		ReadEncoded(Val, In, Meta);
+		Prop->SetPropertyValue(Data, Val);
+		return static_cast<typename SpudTypeInfo<ValueType>::StorageType>(Val);
 	}
 
 
@@ -432,21 +494,22 @@ protected:
 		return false;
 	}
 	template <class PropType, typename ValueType>
-    static bool TryReadPropertyData(FProperty* Prop, void* Data, const FSpudPropertyDef& StoredProperty, int Depth, FArchive& In)
+    static bool TryReadPropertyData(FProperty* Prop, void* Data, const FSpudPropertyDef& StoredProperty, int Depth,
+	                                const FSpudClassMetadata& Meta, FArchive& In)
 	{
 		auto IProp = CastField<PropType>(Prop);
 		if (IProp && StoredPropertyTypeMatchesRuntime(Prop, StoredProperty, true)) // we ignore array flag since we could be processing inner
 		{
-			auto Val = ReadPropertyData<PropType, ValueType>(IProp, Data, In);
+			auto Val = ReadPropertyData<PropType, ValueType>(IProp, Data, Meta, In);
     		UE_LOG(LogSpudProps, Verbose, TEXT("%s = %s"), *GetLogPrefix(Prop, Depth), *ToString(Val));
 			return true;
 		}
 		return false;   
 	}
 
-	static uint16 ReadEnumPropertyData(FEnumProperty* EProp, void* Data, FArchive& In);
+	static uint16 ReadEnumPropertyData(FEnumProperty* EProp, void* Data, const FSpudClassMetadata& Meta, FArchive& In);
 	static bool TryReadEnumPropertyData(FProperty* Prop, void* Data, const FSpudPropertyDef& StoredProperty,
-	                                    int Depth, FArchive& In);
+	                                    int Depth, const FSpudClassMetadata& Meta, FArchive& In);
 	static FString ReadActorRefPropertyData(::FObjectProperty* OProp, void* Data, const RuntimeObjectMap* RuntimeObjects, ULevel* Level, FArchive& In);
 	static FString ReadNestedUObjectPropertyData(::FObjectProperty* OProp, void* Data, const RuntimeObjectMap* RuntimeObjects,
 		ULevel* Level, UObject* Outer, const FSpudClassMetadata& Meta, FArchive& In);
@@ -476,6 +539,42 @@ public:
 		Value = static_cast<T>(SerialisedVal);
 	}
 
+	// Scalar values in the format of the metadata they're described by (see ESpudDataFormat). Overloads are on the
+	// original value type rather than the storage type so that bools can be told apart from uint8s.
+
+	/// Write a value in the format used by Meta. Anything without a specific overload is written raw
+	template <typename T>
+	static void WriteEncoded(const T& Value, FArchive& Out, const FSpudClassMetadata& Meta)
+	{
+		WriteRaw(Value, Out);
+	}
+	static void WriteEncoded(bool Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	static void WriteEncoded(uint16 Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	static void WriteEncoded(uint32 Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	static void WriteEncoded(uint64 Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	static void WriteEncoded(int16 Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	static void WriteEncoded(int32 Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	static void WriteEncoded(int64 Value, FArchive& Out, const FSpudClassMetadata& Meta);
+	/// Read a value written by WriteEncoded
+	template <typename T>
+	static void ReadEncoded(T& Value, FArchive& In, const FSpudClassMetadata& Meta)
+	{
+		ReadRaw(Value, In);
+	}
+	static void ReadEncoded(bool& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	static void ReadEncoded(uint16& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	static void ReadEncoded(uint32& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	static void ReadEncoded(uint64& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	static void ReadEncoded(int16& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	static void ReadEncoded(int32& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	static void ReadEncoded(int64& Value, FArchive& In, const FSpudClassMetadata& Meta);
+	/// Write the element count of an array (a uint16 in fixed width, truncating), returns the count written
+	static int32 WriteArrayCount(int32 Num, FArchive& Out, const FSpudClassMetadata& Meta);
+	static int32 ReadArrayCount(FArchive& In, const FSpudClassMetadata& Meta);
+	/// Write a class / property ID. Compact format zig-zag encodes these as signed so that NONE is a single byte
+	static void WriteEncodedID(uint32 ID, FArchive& Out, const FSpudClassMetadata& Meta);
+	static uint32 ReadEncodedID(FArchive& In, const FSpudClassMetadata& Meta);
+
 	template <typename T>
 	void WriteProperty(const FString& Name, uint32 PrefixID, const T& Value, TSharedPtr<FSpudClassDef> ClassDef,
 	                   TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out)
@@ -5,12 +5,16 @@
 #include "SpudCustomSaveInfo.h"
 #include "SpudData.h"
 #include "SpudPropertyUtil.h"
+#include "UObject/ObjectKey.h"
 
 #include "SpudState.generated.h"
 
 
 SPUD_API DECLARE_LOG_CATEGORY_EXTERN(LogSpudState, Verbose, Verbose);
 
+class UInstancedStaticMeshComponent;
+class UPrimitiveComponent;
+
 /// Description of a save game for display in load game lists, finding latest
 /// All properties are read-only because they can only be populated via calls to save game
 UCLASS(BlueprintType)
@@ -38,6 +42,88 @@ class SPUD_API USpudSaveGameInfo : public UObject
 
 };
 
+/// The kinds of persistence operation telemetry is recorded for
+UENUM(BlueprintType)
+enum class ESpudOperation : uint8
+{
+	SaveGame,
+	LoadGame,
+	LevelStore,
+	LevelRestore,
+	SaveGlobals
+};
+
+/// Cost of a single persistence operation, for tracking persistence performance in the field.
+/// Times are in milliseconds. Phases which don't apply to an operation are 0.
+/// @see USpudSubsystem::PostOperationTelemetry
+USTRUCT(BlueprintType)
+struct SPUD_API FSpudOperationTelemetry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	ESpudOperation Operation = ESpudOperation::SaveGame;
+	/// Slot name for games, level name for levels
+	UPROPERTY(BlueprintReadOnly)
+	FString Name;
+	UPROPERTY(BlueprintReadOnly)
+	bool bSuccess = false;
+
+	/// Wall time from the request to completion, including waits such as screenshots and map loads
+	UPROPERTY(BlueprintReadOnly)
+	float WallTimeMs = 0;
+	/// Time the game thread spent on this operation, the sum of the phases below
+	UPROPERTY(BlueprintReadOnly)
+	float GameThreadTimeMs = 0;
+	/// Storing objects in the world into the state
+	UPROPERTY(BlueprintReadOnly)
+	float CaptureTimeMs = 0;
+	/// Encoding the state to, or decoding it from, the save file. Save files are streamed, so this includes the
+	/// time spent in file writes / reads as they happen
+	UPROPERTY(BlueprintReadOnly)
+	float EncodeTimeMs = 0;
+	/// Opening and closing (flushing) files, and writing released level data on the game thread
+	UPROPERTY(BlueprintReadOnly)
+	float IOTimeMs = 0;
+	/// Applying the state to objects in the world
+	UPROPERTY(BlueprintReadOnly)
+	float RestoreTimeMs = 0;
+	/// Time the game thread spent blocked on level data locks held by other threads
+	UPROPERTY(BlueprintReadOnly)
+	float LockWaitTimeMs = 0;
+
+	/// Bytes actually read from save and level files; data skipped over isn't counted. Level data read in the
+	/// background by streaming isn't included
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesRead = 0;
+	/// Bytes written to save files. Level data written in the background isn't included
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesWritten = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActorsStored = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActorsRestored = 0;
+	/// Runtime actors spawned again on restore
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActorsRespawned = 0;
+	/// Level actors destroyed on restore because they were destroyed when stored
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActorsDestroyed = 0;
+	/// Objects (including nested objects) restored by the fast path, because their class hadn't changed
+	UPROPERTY(BlueprintReadOnly)
+	int32 FastPathObjects = 0;
+	/// Objects (including nested objects) restored by the slow path, because their class had changed since stored
+	UPROPERTY(BlueprintReadOnly)
+	int32 SlowPathObjects = 0;
+
+	/// FPlatformTime::Seconds() when the operation started, for WallTimeMs
+	double StartTime = 0;
+
+	/// Add the times, bytes and counts of an operation which was part of this one
+	void Accumulate(const FSpudOperationTelemetry& Other);
+};
+
 /// Holds the persistent state of a game.
 /// Persistent state is any state which should be restored on load; whether that's the load of a save
 /// game, or whether that's the loading of a streaming level section within an active game.
@@ -72,10 +158,55 @@ public:
 	/// Direct access to save data - not recommended but if you really need it...
 	FSpudSaveData SaveData;
 
+	/// The most idle actors kept in the respawn pool for each class, see ISpudObject::ShouldPoolOnRespawn.
+	/// Actors returned to a full pool are destroyed instead. Set from USpudSubsystem::MaxPooledActorsPerClass
+	int32 MaxPooledActorsPerClass = 32;
+
 protected:
 
 	FString Source;
 
+	/// Names of the components to store for each actor class which opted in, found from the first instance
+	TMap<TObjectKey<UClass>, TArray<FName>> ComponentPlans;
+
+	/// A physics velocity, or a body to put to sleep, which couldn't be applied yet because its level wasn't visible
+	struct FSpudDeferredVelocity
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FVector Velocity;
+		FVector AngularVelocity;
+		/// Put the bodies to sleep instead of applying the velocity
+		bool bAsleep = false;
+	};
+	/// Velocities held back by RestoreLevelBeforeVisible, by level name
+	TMap<FString, TArray<FSpudDeferredVelocity>> DeferredVelocities;
+	/// Whether RestoreCoreActorData should hold back physics velocities
+	bool bDeferPhysicsVelocities = false;
+
+	/// Level actors destroyed since the last FlushDestroyedActors, for one level
+	struct FSpudPendingDestroyedActors
+	{
+		FString LevelName;
+		TArray<FString> ActorNames;
+	};
+	TArray<FSpudPendingDestroyedActors> PendingDestroyedActors;
+	/// Index into PendingDestroyedActors for each level, so the level name is only worked out once per flush
+	TMap<TObjectKey<ULevel>, int32> PendingDestroyedLevels;
+
+	/// Transforms of instances as they were before being removed or moved through this state, so that an in-place
+	/// restore can put them back. Not part of the save, the level itself holds these
+	TMap<TObjectKey<UInstancedStaticMeshComponent>, TMap<int32, FTransform>> PlacedInstanceTransforms;
+
+	/// Idle pooled actors by class, waiting to be handed out by RespawnActor
+	TMap<TObjectKey<UClass>, TArray<TWeakObjectPtr<AActor>>> ActorPool;
+	/// Pooled actors currently in use, and the name of the level they were respawned for. Pooled actors always live
+	/// in the persistent level so that they survive streaming levels unloading, so this is where they really belong
+	TMap<TObjectKey<AActor>, FString> PooledActorLevels;
+
+	/// Global objects stored since the state was last reset or loaded, by ID. Lets canonical output store them all
+	/// again in a stable order, since global class metadata is otherwise only ever added to
+	TMap<FString, TWeakObjectPtr<UObject>> StoredGlobalObjects;
+
 	void WriteCoreActorData(AActor* Actor, FArchive& Out) const;
 
 	class StorePropertyVisitor : public SpudPropertyUtil::PropertyVisitor
@@ -108,7 +239,23 @@ protected:
 	bool ShouldActorVelocityBeRestored(AActor* Actor) const;
 	void StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData);
 	void StoreLevelActorDestroyed(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData);
+	void StoreLevelActorDestroyed(const FString& ActorName, FSpudLevelData& LevelData);
+	FString GetBlobOwnerName(AActor* Actor) const;
+	const TArray<FName>& GetComponentPlan(AActor* Actor);
+	void StoreActorComponents(AActor* Actor, FSpudComponentTable& Table, FSpudClassMetadata& Meta);
+	void RestoreActorComponents(AActor* Actor, const FSpudComponentTable& Table, const FSpudClassMetadata& Meta,
+	                            const TMap<FGuid, UObject*>* RuntimeObjects);
+	FSpudInstanceComponentData* GetInstanceComponentData(UInstancedStaticMeshComponent* Component,
+	                                                     FSpudSaveData::TLevelDataPtr LevelData);
+	void RestoreInstanceComponents(ULevel* Level, FSpudLevelData& LevelData);
+	/// Remember an instance's transform before it's first changed, see PlacedInstanceTransforms
+	void RecordPlacedInstanceTransform(UInstancedStaticMeshComponent* Component, int32 Index);
+	/// Put back the instances of a level's components changed since it was loaded, see PlacedInstanceTransforms
+	void ResetInstanceComponents(ULevel* Level);
 	void StoreGlobalObject(UObject* Obj, FSpudNamedObjectData* Data);
+	/// For canonical output; rebuilds the global metadata by storing every global object again, sorted by ID
+	void RebuildGlobalDataForCanonicalOutput();
+	void StoreObjectData(UObject* Obj, FSpudObjectData& Data, FSpudClassMetadata& Meta);
 	void StoreObjectProperties(UObject* Obj, FSpudPropertyData& Properties, FSpudClassMetadata& Meta, int StartDepth = 0);
 	void StoreObjectProperties(UObject* Obj, uint32 PrefixID, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FMemoryWriter& Out, int StartDepth = 0);
 
@@ -121,18 +268,28 @@ protected:
 	void PostRestoreObject(UObject* Obj, const FSpudCustomData& FromCustomData, uint32 StoredUserVersion);
 	void RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, const TMap<FGuid, UObject*>* RuntimeObjects);
 	void RestoreGlobalObject(UObject* Obj, const FSpudNamedObjectData* Data);
+	void RestoreObjectData(UObject* Obj, const FSpudObjectData& Data, const FSpudClassMetadata& Meta);
 	AActor* RespawnActor(const FSpudSpawnedActorData& SpawnedActor, const FSpudClassMetadata& Meta, ULevel* Level);
+	/// Take an idle pooled actor of a class which is in World, or null if there isn't one
+	AActor* TakePooledActor(UClass* Class, UWorld* World);
+	void ReturnPooledActor(AActor* Actor);
+	bool IsPooledActor(const AActor* Actor) const;
+	void GetPooledActorsInLevel(const FString& LevelName, TArray<AActor*>& OutActors);
+	/// The level an actor's state belongs to; the same as GetLevelNameForObject except for pooled actors
+	FString GetLevelNameForActor(const AActor* Actor) const;
 	void DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, ULevel* Level);
 	void RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& FromData);
 	void RestoreObjectProperties(UObject* Obj, const FSpudPropertyData& FromData, const FSpudClassMetadata& Meta,
 	                             const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth = 0);
-	void RestoreObjectProperties(UObject* Obj, FMemoryReader& In, const FSpudClassMetadata& Meta, const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth = 0);
+	void RestoreObjectProperties(UObject* Obj, FMemoryReader& In, const FSpudClassMetadata& Meta, const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth = 0,
+	                             const TArray<uint32>* PropertyOffsets = nullptr);
 	void RestoreObjectPropertiesFast(UObject* Obj, FMemoryReader& In,
 	                                 const FSpudClassMetadata& Meta, TSharedPtr<const FSpudClassDef> ClassDef,
 	                                 const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth = 0);
 	void RestoreObjectPropertiesSlow(UObject* Obj, FMemoryReader& In,
 	                                 const FSpudClassMetadata& Meta,
-	                                 TSharedPtr<const FSpudClassDef> ClassDef, const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth = 0);
+	                                 TSharedPtr<const FSpudClassDef> ClassDef, const TMap<FGuid, UObject*>* RuntimeObjects, int StartDepth = 0,
+	                                 const TArray<uint32>* PropertyOffsets = nullptr);
 
 	class RestorePropertyVisitor : public SpudPropertyUtil::PropertyVisitor
 	{
@@ -172,9 +329,14 @@ protected:
 	// Slow path restoration when runtime class is the same as stored class
 	class RestoreSlowPropertyVisitor : public RestorePropertyVisitor
 	{
+	protected:
+		/// Where each stored property starts in DataIn, if known. Only top-level objects have these, nested
+		/// objects are read in stream order
+		const TArray<uint32>* PropertyOffsets;
 	public:
-		RestoreSlowPropertyVisitor(USpudState* Parent, FMemoryReader& InDataIn, TSharedPtr<const FSpudClassDef> InClassDef, const FSpudClassMetadata& InMeta, const TMap<FGuid, UObject*>* InRuntimeObjects)
-			: RestorePropertyVisitor(Parent, InDataIn, InClassDef, InMeta, InRuntimeObjects) {}
+		RestoreSlowPropertyVisitor(USpudState* Parent, FMemoryReader& InDataIn, TSharedPtr<const FSpudClassDef> InClassDef, const FSpudClassMetadata& InMeta, const TMap<FGuid, UObject*>* InRuntimeObjects,
+		                           const TArray<uint32>* InPropertyOffsets = nullptr)
+			: RestorePropertyVisitor(Parent, InDataIn, InClassDef, InMeta, InRuntimeObjects), PropertyOffsets(InPropertyOffsets) {}
 
 		virtual bool VisitProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID,
 		                           void* ContainerPtr, int Depth) override;
@@ -219,6 +381,64 @@ public:
 	/// Will page in the level data concerned from disk if necessary and will retain it in memory
 	void StoreLevelActorDestroyed(AActor* Actor);
 
+	/// Like StoreLevelActorDestroyed, but only buffers the event so that large numbers of actors destroyed at once are
+	/// cheap. Buffered events are added to their levels by FlushDestroyedActors, which happens automatically before
+	/// anything in this state needs them (storing / restoring / releasing levels, saving)
+	void BufferLevelActorDestroyed(AActor* Actor);
+
+	/// Add level actors destroyed via BufferLevelActorDestroyed to their levels, once per level
+	void FlushDestroyedActors();
+
+	/**
+	 * @brief Remove instances of an instanced static mesh or foliage component placed in a level, and remember that
+	 * they're gone, e.g. for harvested resources. The instances are hidden by scaling them to zero rather than
+	 * being removed from the component, so that instance indexes stay as they were placed in the level for the
+	 * rest of the game. When the level is restored, they're hidden again in one batch.
+	 * @param Component The component, which must belong to an actor placed in the level
+	 * @param Indices Indexes of the instances to remove
+	 */
+	void RemoveInstances(UInstancedStaticMeshComponent* Component, const TArray<int32>& Indices);
+
+	/// Move an instance of an instanced static mesh or foliage component placed in a level, and remember its new
+	/// transform (local to the component) so that it's restored with the level
+	/// @see RemoveInstances
+	void SetInstanceTransform(UInstancedStaticMeshComponent* Component, int32 Index, const FTransform& Transform);
+
+	/**
+	 * @brief Store a large blob of data for an actor, e.g. terrain edits or painted decals. Blobs are kept with the
+	 * actor's level data, but separately from its custom data: when the level is paged back in from disk they're
+	 * left there, and are only read when requested with ReadBlobAsync. Blobs are kept as long as the actor is
+	 * stored with the level, so they only need to be stored again when they change.
+	 * @param Actor The actor the blob belongs to
+	 * @param BlobName Name of the blob, unique for this actor
+	 * @param Data The data to store
+	 * @param bCompress Whether to compress the data (it's stored uncompressed anyway if that doesn't help)
+	 */
+	void StoreBlob(AActor* Actor, const FString& BlobName, const TArray<uint8>& Data, bool bCompress = true);
+	/// Whether a blob has been stored for an actor
+	bool HasBlob(AActor* Actor, const FString& BlobName);
+	/// Forget a blob stored for an actor
+	void RemoveBlob(AActor* Actor, const FString& BlobName);
+	/**
+	 * @brief Read a blob stored for an actor. The read & decompression happen on a background thread.
+	 * @param Actor The actor the blob belongs to
+	 * @param BlobName Name of the blob
+	 * @param OnComplete Called on the game thread with whether the blob was found, and its data. The actor may have
+	 * been destroyed by then, so don't capture it directly
+	 */
+	void ReadBlobAsync(AActor* Actor, const FString& BlobName,
+	                   TFunction<void(bool bSuccess, const TArray<uint8>& Data)> OnComplete);
+	/// Read a blob stored for an actor, blocking until it's been read. Returns whether it was found
+	bool ReadBlob(AActor* Actor, const FString& BlobName, TArray<uint8>& OutData);
+
+	/// Return the pooled actors respawned for a level to their pools, hidden & disabled, e.g. because the level is
+	/// being unloaded. Actors which opt in with ISpudObject::ShouldPoolOnRespawn are then reused by the next restore
+	/// instead of spawning new ones. Store the level first, this doesn't.
+	void ReturnPooledActors(const FString& LevelName);
+
+	/// Destroy all idle pooled actors, e.g. because the world they're in is going away
+	void EmptyActorPool();
+
 	/// Stores any data for all levels to disk and releases the memory being used to store persistent state
 	void ReleaseAllLevelData();
 
@@ -244,6 +464,18 @@ public:
 	/// Specialised function for restoring a specific level by reference
 	void RestoreLevel(ULevel* Level);
 
+	/// Restore a level which has been loaded but isn't visible yet, so that its actors don't tick or simulate with
+	/// their default state first. Physics velocities & sleeping bodies can't be applied until the level is visible, so
+	/// they're held back until ApplyDeferredVelocities is called.
+	void RestoreLevelBeforeVisible(ULevel* Level);
+
+	/// Apply physics velocities & sleep states held back by RestoreLevelBeforeVisible, once the level is visible & has
+	/// ticked
+	void ApplyDeferredVelocities(ULevel* Level);
+
+	/// Whether there are physics velocities held back for a level by RestoreLevelBeforeVisible
+	bool HasDeferredVelocities(ULevel* Level) const;
+
 	/// Request that data for a level is loaded in the calling thread
 	/// Useful for pre-caching before RestoreLevel
 	bool PreLoadLevelData(const FString& LevelName);
@@ -251,6 +483,18 @@ public:
 	// Restores the world and all levels currently in it, on the assumption that it's already loaded into the correct map
 	void RestoreLoadedWorld(UWorld* World);
 
+	/// Determine whether the world currently loaded can be restored from this state without reloading the map.
+	/// Requires that every loaded level has data in this state, and that every level actor this state has data
+	/// for still exists in the world (destroyed level actors cannot be brought back without a reload).
+	bool CanRestoreLoadedWorldInPlace(UWorld* World);
+
+	/// Prepare the currently loaded world to be restored in-place from this state, without a map reload.
+	/// Removes all runtime-spawned persistent actors which would be respawned on restore, so that afterwards
+	/// RestoreLoadedWorld leaves the persistent state of the world as if the map had just been loaded & restored.
+	/// Level actors are NOT reset to their placed state first: anything which isn't persisted (non-SaveGame
+	/// properties, non-persistent actors) keeps its current value.
+	void ResetLoadedWorldForInPlaceRestore(UWorld* World);
+
 	/// Restores a single actor from  this state. Does not require the actor to implement ISpudObject.
 	/// NOTE: this is a limited function, it's less efficient than using RestoreLevel for multiple actors, and it
 	/// also cannot restore object cross-references if those references refer to runtime-spawned objects
@@ -266,6 +510,53 @@ public:
 	/// This version uses a specific ID instead of one generated from the object's FName or SpudGuid property. 
 	void RestoreGlobalObject(UObject* Obj, const FString& ID);
 
+	/**
+	 * @brief Store a standalone snapshot of a list of objects, independent of the save game state. Nested UObjects
+	 * they own are included, and all objects share one set of class metadata. Does not require the objects to
+	 * implement ISpudObject, but ISpudObjectCallback is honoured.
+	 * @param Objects The objects to store. Null entries are allowed, they store nothing
+	 * @param OutSnapshot Snapshot to populate. Re-use the same one for repeated snapshots to re-use its buffers
+	 */
+	void StoreObjectSnapshot(const TArray<UObject*>& Objects, FSpudObjectSnapshot& OutSnapshot);
+	/// Store a standalone snapshot of a list of objects straight to a self-describing byte buffer
+	/// @see StoreObjectSnapshot
+	void StoreObjectSnapshot(const TArray<UObject*>& Objects, TArray<uint8>& OutData);
+
+	/**
+	 * @brief Restore a list of objects from a snapshot made by StoreObjectSnapshot.
+	 * @param Objects The objects to restore, in the same order they were stored. Null entries are skipped
+	 * @param Snapshot The snapshot data
+	 * @return False if the number of objects doesn't match the snapshot, in which case nothing is restored
+	 */
+	bool RestoreObjectSnapshot(const TArray<UObject*>& Objects, const FSpudObjectSnapshot& Snapshot);
+	/// Restore a list of objects from a byte buffer written by StoreObjectSnapshot. Returns false if the data is
+	/// invalid or the number of objects doesn't match
+	bool RestoreObjectSnapshot(const TArray<UObject*>& Objects, const TArray<uint8>& InData);
+
+	/**
+	 * @brief Store a compact snapshot of a loaded level's placed actors, and the placed actors which have been
+	 * destroyed in it, for example on a server to send to a late-joining client instead of replicating every
+	 * modified actor. Runtime spawned actors are not included. Does not alter the level data in this state.
+	 * @param Level The level to snapshot
+	 * @param OutSnapshot Snapshot to populate
+	 * @param Baseline Optional earlier snapshot of the same level, e.g. taken just after it was loaded. Actors
+	 * whose state is identical to the baseline are left out, since a client loading the level already has them
+	 */
+	void StoreLevelSnapshot(ULevel* Level, FSpudLevelSnapshot& OutSnapshot, const FSpudLevelSnapshot* Baseline = nullptr);
+	/// Store a level snapshot straight to a self-describing byte buffer
+	/// @see StoreLevelSnapshot
+	void StoreLevelSnapshot(ULevel* Level, TArray<uint8>& OutData, const FSpudLevelSnapshot* Baseline = nullptr);
+
+	/**
+	 * @brief Apply a snapshot made by StoreLevelSnapshot to a loaded level in one batch: placed actors in the
+	 * snapshot are restored, and destroyed ones are destroyed. Other actors are left alone.
+	 * @return False if the snapshot is for a different level
+	 */
+	bool RestoreLevelSnapshot(ULevel* Level, const FSpudLevelSnapshot& Snapshot);
+	/// Apply a level snapshot from a byte buffer written by StoreLevelSnapshot. Returns false if the data is invalid
+	/// or for a different level
+	bool RestoreLevelSnapshot(ULevel* Level, const TArray<uint8>& InData);
+
 	// Separate Read / Write because it's just better for us and Serialize() often does batshit things
 	// E.g. When this class was subclassed from USaveGame and had a Serialize(), and was used as an argument to an
 	// interface, the Editor would crash on startup, calling my Serialize in the middle of loading some wind component???
@@ -284,6 +575,13 @@ public:
 	 */
 	virtual void LoadFromArchive(FArchive& SPUDAr, bool bFullyLoadAllLevelData);
 
+	/// Save just the save info and global data to an archive, with no level data. The timestamp is only written to
+	/// the archive, the state's own timestamp is still that of the save it was loaded from or last saved as
+	virtual void SaveGlobalsToArchive(FArchive& SPUDAr, const FDateTime& Timestamp);
+	/// Replace global data with that from an archive written by SaveGlobalsToArchive, if it's newer than the
+	/// currently loaded save. Returns whether global data was replaced
+	virtual bool LoadGlobalsFromArchive(FArchive& SPUDAr);
+
 	/// Get the name of the persistent level which the player is on in this state
 	FString GetPersistentLevel() const { return SaveData.GlobalData.CurrentLevel; }
 
@@ -355,8 +653,12 @@ public:
 	/// This only reads the minimum needed to describe the save file and doesn't load any other data.
 	static bool LoadSaveInfoFromArchive(FArchive& SPUDAr, USpudSaveGameInfo& OutInfo);
 
+	/// If set, counts and timings from store & restore calls are added to this record. Game thread only
+	FSpudOperationTelemetry* Telemetry = nullptr;
+
 	bool bTestRequireSlowPath = false;
 	bool bTestRequireFastPath = false;
+	bool bTestDisableCompiledSerializers = false;
 	
 };
 
@@ -20,6 +20,7 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPreLevelStore, const FString&,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSpudPostLevelStore, const FString&, LevelName, bool, bSuccess);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPreLevelRestore, const FString&, LevelName);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSpudPostLevelRestore, const FString&, LevelName, bool, bSuccess);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPostOperationTelemetry, const FSpudOperationTelemetry&, Telemetry);
 
 /// Helper delegates to allow blueprints to listen in on map transitions & streaming if they want
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPreTravelToNewMap, const FString&, NextMapName);
@@ -89,6 +90,10 @@ public:
 	/// Event fired just after we've finished populating a loaded level from the state database
 	UPROPERTY(BlueprintAssignable)
 	FSpudPostLevelRestore PostLevelRestore;
+	/// Event fired with the cost of each save, load, globals save, level store and level restore, just before its
+	/// Post event. Level stores & restores which happen as part of a save or load are also added to its totals
+	UPROPERTY(BlueprintAssignable)
+	FSpudPostOperationTelemetry PostOperationTelemetry;
 
 	/// Event fired just prior to travelling to a new map (convenience for blueprints mainly, who don't have access to FCoreDelegates)
 	UPROPERTY(BlueprintAssignable)
@@ -123,11 +128,33 @@ public:
 	int32 ScreenshotHeight = 135;
 	FDelegateHandle OnScreenshotHandle;
 
+	/// If true, loading a game whose persistent level is the map currently open (e.g. a quickload) restores the
+	/// world in-place rather than re-opening the map. Runtime-spawned persistent actors are removed and respawned
+	/// from the save, level actors have their persistent state restored over their current state. Nothing which
+	/// isn't persisted is reset, so only use this if the persistent state fully describes your actors. Falls back
+	/// to re-opening the map if the world can't be reconciled with the save (e.g. a level actor the save has data
+	/// for has been destroyed)
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bLoadGameInPlaceIfSameMap = false;
+
+	/// If true, streaming levels loaded by this subsystem are restored as soon as they're loaded, before they're
+	/// made visible, rather than after they've been visible for a tick. Actors then never tick or simulate with their
+	/// default state, but note that they're restored before BeginPlay. Physics velocities are applied just after
+	/// the level becomes visible, since bodies don't exist before that.
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bRestoreStreamLevelsBeforeVisible = false;
+
+	/// The most idle actors kept for reuse per class, for runtime actors which opt in to pooling with
+	/// ISpudObject::ShouldPoolOnRespawn. Actors returned to a full pool when their level unloads are destroyed instead.
+	UPROPERTY(BlueprintReadWrite, Config)
+	int32 MaxPooledActorsPerClass = 32;
+
 
 protected:
 	FDelegateHandle OnPreLoadMapHandle;
 	FDelegateHandle OnPostLoadMapHandle;
 	FDelegateHandle OnSeamlessTravelHandle;
+	FDelegateHandle OnLevelAddedToWorldHandle;
 	int32 LoadUnloadRequests = 0;
 	bool FirstStreamRequestSinceMapLoad = true;
 	TMap<int32, FName> LevelsPendingLoad;
@@ -141,6 +168,12 @@ protected:
 	UPROPERTY()
 	const USpudCustomSaveInfo* ExtraInfoInProgress;
 
+	/// Telemetry for the save / load in progress, since they can span frames
+	FSpudOperationTelemetry SaveTelemetry;
+	FSpudOperationTelemetry LoadTelemetry;
+	/// Most recent telemetry for each operation
+	TMap<ESpudOperation, FSpudOperationTelemetry> LastTelemetry;
+
 	UPROPERTY()
 	TArray<TWeakObjectPtr<UObject>> GlobalObjects;
 	UPROPERTY()
@@ -158,6 +191,7 @@ protected:
 		if (!IsValid(ActiveState))
 			ActiveState = NewObject<USpudState>();
 
+		ActiveState->MaxPooledActorsPerClass = MaxPooledActorsPerClass;
 		return ActiveState;
 	}
 
@@ -183,6 +217,7 @@ protected:
 	void OnSeamlessTravelTransition(UWorld* World);
 	UFUNCTION()
 	void OnPostLoadMap(UWorld* World);
+	void OnLevelAddedToWorld(ULevel* Level, UWorld* World);
 	UFUNCTION()
 	void OnActorDestroyed(AActor* Actor);
 	void SubscribeAllLevelObjectEvents();
@@ -210,8 +245,13 @@ protected:
 
 	void FinishSaveGame(const FString& SlotName, const FText& Title, const USpudCustomSaveInfo* ExtraInfo, TArray<uint8>* ScreenshotData);
 	void LoadComplete(const FString& SlotName, bool bSuccess);
+	bool TryLoadGameInPlace(const FString& SlotName);
+	bool UpdateSaveGameInfo(const FString& SlotName, TFunctionRef<void(FSpudSaveInfo&)> Update);
 	void SaveComplete(const FString& SlotName, bool bSuccess);
 
+	static FSpudOperationTelemetry BeginTelemetry(ESpudOperation Operation, const FString& Name);
+	void CompleteTelemetry(FSpudOperationTelemetry& Telemetry, bool bSuccess);
+
 	void HandleLevelLoaded(FName LevelName);
 	void HandleLevelUnloaded(ULevel* Level);
 
@@ -292,6 +332,33 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
     bool DeleteSave(const FString& SlotName);
 
+	/// Change the title of the save game in a given slot. Only the save info at the start of the file is rewritten,
+	/// so this is cheap however big the save is. The timestamp is left alone. Returns whether it succeeded
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool SetSaveGameTitle(const FString& SlotName, const FText& Title);
+
+	/// Replace the custom info of the save game in a given slot, e.g. to mark it as a favourite.
+	/// @see SetSaveGameTitle
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool SetSaveGameCustomInfo(const FString& SlotName, const USpudCustomSaveInfo* ExtraInfo);
+
+	/// Replace the screenshot of the save game in a given slot with PNG data (empty to remove it).
+	/// @see SetSaveGameTitle
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool SetSaveGameScreenshot(const FString& SlotName, const TArray<uint8>& ImageData);
+
+	/**
+	 * Save only the state of global objects (@see AddPersistentGlobalObject) to a slot. This is much cheaper than
+	 * SaveGame, since no levels are stored or written, so it's suitable for very frequent saves of progress like
+	 * achievements or "save on every pickup". The data is written in the background to a small file alongside the
+	 * slot's full save, and when the slot is loaded it replaces the full save's global data if it's newer.
+	 * A full save to the same slot supersedes it.
+	 * @param SlotName The slot to save globals for
+	 * @return Whether the save was started
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool SaveGlobals(const FString& SlotName);
+
 	/**
 	* Add a global object to the list of objects which will have their state saved / loaded
 	* Level actors which implement ISpudObject will automatically be saved/loaded but global objects like GameInstance
@@ -404,6 +471,45 @@ public:
 	UFUNCTION(BlueprintCallable)
     int32 GetUserDataModelVersion() const;
 
+	/// Choose whether newly stored state uses the compact data format: integers, enums and IDs as varints, bools
+	/// bit-packed, and variable-length array counts (which also removes the 65,535 element array limit).
+	/// The default is the fixed width format. Data is always read in whatever format it was written in, so this can be
+	/// changed at any time; it takes effect for each level the next time it's stored, and for global objects on the
+	/// next new game / load. Saves using the compact format cannot be read by versions of SPUD without it.
+	UFUNCTION(BlueprintCallable)
+	void SetCompactDataFormat(bool bCompact);
+
+	/// Whether newly stored state uses the compact data format (@see SetCompactDataFormat)
+	UFUNCTION(BlueprintCallable)
+	bool IsCompactDataFormat() const;
+
+	/// Set how much memory (in megabytes) may be used to keep the state of unloaded levels compressed in memory,
+	/// rather than writing it to disk. Levels the player moves back and forth between are then restored from memory.
+	/// When the budget is exceeded, the least recently unloaded levels are written to disk. 0 (the default) disables
+	/// this, so level state is always written to disk when unloaded.
+	UFUNCTION(BlueprintCallable)
+	void SetCompressedLevelDataBudget(int32 BudgetMB);
+
+	/// Get the compressed level data budget in megabytes (@see SetCompressedLevelDataBudget)
+	UFUNCTION(BlueprintCallable)
+	int32 GetCompressedLevelDataBudget() const;
+
+	/// Choose whether saves are written in a canonical form, so that identical state always produces identical
+	/// bytes (apart from the save info, which includes the timestamp). Actors, objects & levels are written sorted
+	/// by name and class / property IDs are assigned in a stable order, which makes saves cheap to diff and
+	/// deduplicate. Off by default since sorting costs a little time on every store & save.
+	UFUNCTION(BlueprintCallable)
+	void SetCanonicalOutput(bool bCanonical);
+
+	/// Whether saves are written in canonical form (@see SetCanonicalOutput)
+	UFUNCTION(BlueprintCallable)
+	bool IsCanonicalOutput() const;
+
+	/// Get the telemetry of the most recent operation of a given type, blank if there hasn't been one.
+	/// @see PostOperationTelemetry
+	UFUNCTION(BlueprintPure)
+	FSpudOperationTelemetry GetLastOperationTelemetry(ESpudOperation Operation) const;
+
 	/**
 	 * Triggers the upgrade process for all save games (asynchronously)
 	 * 
@@ -457,6 +563,8 @@ public:
 
 	static FString GetSaveGameDirectory();
 	static FString GetSaveGameFilePath(const FString& SlotName);
+	/// Path of the file written by SaveGlobals for a slot
+	static FString GetGlobalsSaveFilePath(const FString& SlotName);
 	// Lists saves: note that this is only the filenames, not the directory
 	static void ListSaveGameFiles(TArray<FString>& OutSaveFileList);
 	static FString GetActiveGameFolder();
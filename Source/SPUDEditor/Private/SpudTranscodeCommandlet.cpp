@@ -0,0 +1,259 @@
+#include "SpudTranscodeCommandlet.h"
+#include "SpudEditorModule.h"
+#include "SpudData.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace SpudTranscode
+{
+	struct FFileResult
+	{
+		FString Source;
+		/// Where the result should end up
+		FString Dest;
+		/// Where the result was written before being verified
+		FString Written;
+		int64 OldSize = 0;
+		int64 NewSize = 0;
+		/// Time taken to read the original and the transcoded save, measured back to back during verification
+		double OldReadMs = 0;
+		double NewReadMs = 0;
+		double WriteMs = 0;
+		/// Empty if all went well
+		FString Error;
+	};
+
+	/// Read a whole save. Chunks the reader doesn't recognise are dropped, so their magic is returned in OutSkipped;
+	/// a transcode would lose them
+	bool ReadSave(const FString& Filename, FSpudSaveData& OutData, TArray<FString>& OutSkipped, double& OutReadMs)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+		if (!Archive)
+			return false;
+
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		OutData.ReadFromArchive(ChunkedAr, true, "");
+		OutReadMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		OutSkipped = MoveTemp(ChunkedAr.SkippedChunks);
+		return !ChunkedAr.IsError() &&
+			OutData.ChunkHeader.Magic == FSpudChunkHeader::EncodeMagic(SPUDDATA_SAVEGAME_MAGIC);
+	}
+
+	template<typename T>
+	TArray<uint8> GetChunkBytes(T& Chunk)
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter MemAr(Bytes);
+		FSpudChunkedDataArchive ChunkedAr(MemAr);
+		Chunk.WriteToArchive(ChunkedAr);
+		return Bytes;
+	}
+
+	/// Compare two saves chunk by chunk, returning the first difference or an empty string if they're equivalent.
+	/// Relies on canonical output so that the order things were written in doesn't matter
+	FString Compare(FSpudSaveData& A, FSpudSaveData& B)
+	{
+		if (!A.Info.Title.EqualTo(B.Info.Title) || A.Info.Timestamp != B.Info.Timestamp)
+			return TEXT("save info differs");
+		if (A.Info.Screenshot.ImageData != B.Info.Screenshot.ImageData)
+			return TEXT("screenshot differs");
+		if (GetChunkBytes(A.Info.CustomInfo) != GetChunkBytes(B.Info.CustomInfo))
+			return TEXT("custom info differs");
+		if (GetChunkBytes(A.GlobalData) != GetChunkBytes(B.GlobalData))
+			return TEXT("global data differs");
+		if (A.LevelDataMap.Num() != B.LevelDataMap.Num())
+			return TEXT("number of levels differs");
+		for (auto&& KV : A.LevelDataMap)
+		{
+			const auto Other = B.LevelDataMap.Find(KV.Key);
+			if (!Other)
+				return FString::Printf(TEXT("level %s is missing"), *KV.Key);
+			if (GetChunkBytes(*KV.Value) != GetChunkBytes(**Other))
+				return FString::Printf(TEXT("level %s differs"), *KV.Key);
+		}
+		return FString();
+	}
+
+	void Transcode(FFileResult& Result)
+	{
+		IFileManager& FileMgr = IFileManager::Get();
+		Result.OldSize = FileMgr.FileSize(*Result.Source);
+
+		FSpudSaveData SaveData;
+		TArray<FString> Skipped;
+		double ReadMs;
+		if (!ReadSave(Result.Source, SaveData, Skipped, ReadMs))
+		{
+			Result.Error = TEXT("not a readable save file");
+			return;
+		}
+		if (Skipped.Num() > 0)
+		{
+			// Comparing what was read would pass, but the rewritten file would silently drop these
+			Result.Error = FString::Printf(TEXT("contains chunks this version doesn't understand (%s)"),
+			                               *FString::Join(Skipped, TEXT(", ")));
+			return;
+		}
+
+		// Property data isn't re-encoded, so the format recorded in the info stays the same too
+		const auto DataFormat = SaveData.Info.DataFormat.Version;
+		SaveData.PrepareForWrite();
+		SaveData.Info.DataFormat.Version = DataFormat;
+
+		const double StartTime = FPlatformTime::Seconds();
+		auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*Result.Written));
+		if (!Archive)
+		{
+			Result.Error = FString::Printf(TEXT("unable to write %s"), *Result.Written);
+			return;
+		}
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		SaveData.WriteToArchive(ChunkedAr, "");
+		if (ChunkedAr.IsError() || !Archive->Close())
+		{
+			Result.Error = FString::Printf(TEXT("error writing %s"), *Result.Written);
+			return;
+		}
+		Result.WriteMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		Result.NewSize = FileMgr.FileSize(*Result.Written);
+	}
+
+	void Verify(FFileResult& Result)
+	{
+		FSpudSaveData Original, Transcoded;
+		TArray<FString> OriginalSkipped, TranscodedSkipped;
+		if (!ReadSave(Result.Source, Original, OriginalSkipped, Result.OldReadMs) ||
+			!ReadSave(Result.Written, Transcoded, TranscodedSkipped, Result.NewReadMs))
+		{
+			Result.Error = TEXT("transcoded save could not be read back");
+			return;
+		}
+		// Anything skipped wasn't compared, so the check can't vouch for it
+		if (OriginalSkipped.Num() > 0 || TranscodedSkipped.Num() > 0)
+		{
+			Result.Error = FString::Printf(TEXT("round trip check failed, unknown chunks skipped (%s)"),
+			                               *FString::Join(OriginalSkipped.Num() > 0 ? OriginalSkipped : TranscodedSkipped, TEXT(", ")));
+			return;
+		}
+		const FString Difference = Compare(Original, Transcoded);
+		if (!Difference.IsEmpty())
+			Result.Error = FString::Printf(TEXT("round trip check failed, %s"), *Difference);
+	}
+
+	double PercentChange(int64 OldSize, int64 NewSize)
+	{
+		return OldSize > 0 ? (NewSize - OldSize) * 100.0 / OldSize : 0.0;
+	}
+}
+
+USpudTranscodeCommandlet::USpudTranscodeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USpudTranscodeCommandlet::Main(const FString& Params)
+{
+	using namespace SpudTranscode;
+
+	FString Input, Output;
+	if (!FParse::Value(*Params, TEXT("Input="), Input))
+	{
+		UE_LOG(LogSpudEditor, Error, TEXT("Usage: -run=SpudTranscode -Input=<.sav file or folder> [-Output=<folder>] "
+			"[-Canonical | -NonCanonical] [-InfoPadding=<bytes>]"));
+		return 1;
+	}
+	FParse::Value(*Params, TEXT("Output="), Output);
+
+	IFileManager& FileMgr = IFileManager::Get();
+	TArray<FString> Files;
+	if (FPaths::DirectoryExists(Input))
+	{
+		FileMgr.FindFiles(Files, *Input, TEXT(".sav"));
+		for (auto& File : Files)
+			File = FPaths::Combine(Input, File);
+	}
+	else if (FPaths::FileExists(Input))
+	{
+		Files.Add(Input);
+	}
+	if (Files.Num() == 0)
+	{
+		UE_LOG(LogSpudEditor, Error, TEXT("No save files found at %s"), *Input);
+		return 1;
+	}
+	if (!Output.IsEmpty())
+		FileMgr.MakeDirectory(*Output, true);
+
+	TArray<FFileResult> Results;
+	Results.SetNum(Files.Num());
+	for (int i = 0; i < Files.Num(); ++i)
+	{
+		auto& Result = Results[i];
+		Result.Source = Files[i];
+		Result.Dest = Output.IsEmpty() ? Files[i] : FPaths::Combine(Output, FPaths::GetCleanFilename(Files[i]));
+		// Never overwrite the original until the new one has been verified
+		Result.Written = FPaths::IsSamePath(Result.Dest, Result.Source) ? Result.Dest + TEXT(".tmp") : Result.Dest;
+	}
+
+	const bool bPrevCanonical = GSpudCanonicalOutput;
+	const int64 PrevInfoPadding = GSpudSaveInfoPadding;
+	if (FParse::Param(*Params, TEXT("Canonical")))
+		GSpudCanonicalOutput = true;
+	else if (FParse::Param(*Params, TEXT("NonCanonical")))
+		GSpudCanonicalOutput = false;
+	FParse::Value(*Params, TEXT("InfoPadding="), GSpudSaveInfoPadding);
+	UE_LOG(LogSpudEditor, Display, TEXT("Transcoding %d saves, canonical output: %s, info padding: %lld bytes"),
+	       Files.Num(), GSpudCanonicalOutput ? TEXT("on") : TEXT("off"), GSpudSaveInfoPadding);
+
+	const double StartTime = FPlatformTime::Seconds();
+	ParallelFor(Results.Num(), [&Results](int32 Index)
+	{
+		Transcode(Results[Index]);
+	});
+	// Compare canonical forms, so that the check doesn't depend on the options the files were written with
+	GSpudCanonicalOutput = true;
+	ParallelFor(Results.Num(), [&Results](int32 Index)
+	{
+		if (Results[Index].Error.IsEmpty())
+			Verify(Results[Index]);
+	});
+	GSpudCanonicalOutput = bPrevCanonical;
+	GSpudSaveInfoPadding = PrevInfoPadding;
+
+	int32 NumFailed = 0;
+	int64 TotalOldSize = 0, TotalNewSize = 0;
+	double TotalOldReadMs = 0, TotalNewReadMs = 0;
+	for (auto& Result : Results)
+	{
+		if (Result.Error.IsEmpty() && Result.Written != Result.Dest && !FileMgr.Move(*Result.Dest, *Result.Written, true))
+			Result.Error = FString::Printf(TEXT("unable to replace %s"), *Result.Dest);
+
+		if (!Result.Error.IsEmpty())
+		{
+			++NumFailed;
+			UE_LOG(LogSpudEditor, Error, TEXT("%s: %s"), *Result.Source, *Result.Error);
+			FileMgr.Delete(*Result.Written, false, true, true);
+			continue;
+		}
+
+		TotalOldSize += Result.OldSize;
+		TotalNewSize += Result.NewSize;
+		TotalOldReadMs += Result.OldReadMs;
+		TotalNewReadMs += Result.NewReadMs;
+		UE_LOG(LogSpudEditor, Display, TEXT("%s: %lld -> %lld bytes (%+.1f%%), read %.1f -> %.1fms (%+.1fms), write %.1fms"),
+		       *Result.Source, Result.OldSize, Result.NewSize, PercentChange(Result.OldSize, Result.NewSize),
+		       Result.OldReadMs, Result.NewReadMs, Result.NewReadMs - Result.OldReadMs, Result.WriteMs);
+	}
+
+	UE_LOG(LogSpudEditor, Display, TEXT("Transcoded %d of %d saves in %.2fs, %lld -> %lld bytes (%+.1f%%), read %.1f -> %.1fms (%+.1fms)"),
+	       Results.Num() - NumFailed, Results.Num(), FPlatformTime::Seconds() - StartTime,
+	       TotalOldSize, TotalNewSize, PercentChange(TotalOldSize, TotalNewSize),
+	       TotalOldReadMs, TotalNewReadMs, TotalNewReadMs - TotalOldReadMs);
+
+	return NumFailed > 0 ? 1 : 0;
+}
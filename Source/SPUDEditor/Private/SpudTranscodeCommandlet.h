@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "SpudTranscodeCommandlet.generated.h"
+
+/**
+* Rewrites existing save files with the current save format options, without a game world, e.g. to convert saves in
+* bulk on build machines or as part of a live update. Files are processed in parallel, and each one is read back and
+* compared with the original chunk by chunk before anything is replaced. Files with chunks this version doesn't
+* recognise fail, since they'd be dropped by the rewrite.
+*
+* Usage: UnrealEditor-Cmd <Project> -run=SpudTranscode -Input=<.sav file or folder> [-Output=<folder>]
+*        [-Canonical | -NonCanonical] [-InfoPadding=<bytes>]
+*
+* Without -Output, files are replaced in place. Property data keeps the format it was written in (fixed width or
+* compact), since converting it needs the classes it belongs to; it's converted as objects are next stored in game.
+*/
+UCLASS()
+class USpudTranscodeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USpudTranscodeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -14,7 +14,8 @@ public class SPUDEditor : ModuleRules
                 "Core",
                 "CoreUObject",
                 "Engine",
-                "UnrealEd"
+                "UnrealEd",
+                "SPUD"
             }
         );
         
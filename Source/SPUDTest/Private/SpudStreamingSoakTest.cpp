@@ -0,0 +1,156 @@
+#include "Misc/AutomationTest.h"
+#include "Async/Async.h"
+#include "Misc/CommandLine.h"
+#include "SpudData.h"
+#include "SpudState.h"
+#include "SpudTestWorld.h"
+#include "TestSaveObject.h"
+
+// Streaming churn soak: levels are rapidly restored, then stored & released on the game thread like the subsystem
+// does when they stream in & out, while a loading thread pre-loads level data like PostLoadStreamLevel does. Measures
+// the game thread stall per level, lock contention and background write latency. Stress filter only since it takes
+// a while.
+
+namespace SpudSoak
+{
+	constexpr int32 NumLevels = 24;
+	constexpr int32 ActorsPerLevel = 200;
+	constexpr int32 CharsPerActor = 256;
+	constexpr double DurationSeconds = 10;
+	/// Fail if 99% of game thread stalls aren't below this. Loose so it only catches real regressions; pass
+	/// -SpudSoakMaxP99StallMs=N on the command line to hold a known machine to a tighter limit
+	constexpr double DefaultMaxP99StallMs = 50;
+
+	FString LevelName(int32 Index)
+	{
+		return FString::Printf(TEXT("SpudSoakLevel%d"), Index);
+	}
+
+	void ChangeLevel(ULevel* Level, int32 Seed)
+	{
+		for (auto Actor : Level->Actors)
+		{
+			if (auto SaveActor = Cast<ATestSaveActor>(Actor))
+			{
+				SaveActor->IntVal = Seed;
+				SaveActor->StringVal = FString::ChrN(CharsPerActor, static_cast<TCHAR>(TEXT('a') + Seed % 26));
+			}
+		}
+	}
+
+	double Percentile(const TArray<double>& Sorted, double Pct)
+	{
+		if (Sorted.Num() == 0)
+			return 0;
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Pct * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestStreamingChurnSoak, "SPUDTest.Soak.StreamingChurn",
+                                 EAutomationTestFlags::EditorContext |
+                                 EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::StressFilter)
+
+bool FTestStreamingChurnSoak::RunTest(const FString& Parameters)
+{
+	using namespace SpudSoak;
+
+	double MaxP99StallMs = DefaultMaxP99StallMs;
+	FParse::Value(FCommandLine::Get(), TEXT("SpudSoakMaxP99StallMs="), MaxP99StallMs);
+
+	FSpudTestWorld TestWorld;
+	TArray<ULevel*> Levels;
+	for (int32 i = 0; i < NumLevels; ++i)
+	{
+		ULevel* Level = TestWorld.AddLevel(LevelName(i));
+		for (int32 a = 0; a < ActorsPerLevel; ++a)
+			TestWorld.Spawn<ATestSaveActor>(*FString::Printf(TEXT("SoakActor%d"), a), true, Level);
+		Levels.Add(Level);
+	}
+
+	auto State = NewObject<USpudState>();
+	// Every level starts out streamed out, with its data on disk
+	for (int32 i = 0; i < NumLevels; ++i)
+	{
+		ChangeLevel(Levels[i], i);
+		State->StoreLevel(Levels[i], true, true);
+	}
+
+	const bool bPrevCollect = GSpudCollectContentionStats;
+	GSpudCollectContentionStats = true;
+	GSpudLevelDataMapLockStats.Reset();
+	GSpudLevelLockStats.Reset();
+	GSpudBackgroundWriteStats.Reset();
+
+	TArray<double> StallsMs;
+	{
+		std::atomic<bool> bStop { false };
+		std::atomic<int32> StreamLoads { 0 };
+		TFuture<void> StreamThread = Async(EAsyncExecution::Thread, [State, &bStop, &StreamLoads]()
+		{
+			FRandomStream Rand(5678);
+			while (!bStop)
+			{
+				// What the subsystem does on the loading thread when a level has loaded, before the game thread restore
+				State->PreLoadLevelData(LevelName(Rand.RandRange(0, NumLevels - 1)));
+				++StreamLoads;
+				FPlatformProcess::Sleep(0.0005f);
+			}
+		});
+
+		FRandomStream Rand(1234);
+		const double EndTime = FPlatformTime::Seconds() + DurationSeconds;
+		while (FPlatformTime::Seconds() < EndTime)
+		{
+			ULevel* Level = Levels[Rand.RandRange(0, NumLevels - 1)];
+
+			// Streamed in: restored on the game thread, as in PostLoadStreamLevelGameThread
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			State->RestoreLevel(Level);
+			StallsMs.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+
+			// Played in, then streamed out: stored & released in the background, as in HandleLevelUnloaded
+			ChangeLevel(Level, StallsMs.Num());
+			StartCycles = FPlatformTime::Cycles64();
+			State->StoreLevel(Level, true, false);
+			StallsMs.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+
+			// Roughly one level streaming change per frame
+			FPlatformProcess::Sleep(0.002f);
+		}
+
+		bStop = true;
+		StreamThread.Wait();
+		State->SaveData.WaitForBackgroundWrites();
+		AddInfo(FString::Printf(TEXT("Levels restored & stored: %d, streaming pre-loads: %d"), StallsMs.Num() / 2,
+		                        StreamLoads.load()));
+	}
+
+	StallsMs.Sort();
+	const double P99 = Percentile(StallsMs, 0.99);
+	AddInfo(FString::Printf(TEXT("Game thread stall ms: p50 %.3f p95 %.3f p99 %.3f max %.3f"),
+	                        Percentile(StallsMs, 0.5), Percentile(StallsMs, 0.95), P99,
+	                        StallsMs.Num() ? StallsMs.Last() : 0.0));
+
+	auto LockInfo = [this](const TCHAR* Label, const FSpudLockStats& Stats)
+	{
+		AddInfo(FString::Printf(
+			TEXT("%s: %llu holds avg %.4fms max %.3fms, %llu contended waits avg %.4fms max %.3fms"),
+			Label, Stats.Holds.Count.load(), Stats.Holds.GetAverageMs(), Stats.Holds.GetMaxMs(),
+			Stats.Waits.Count.load(), Stats.Waits.GetAverageMs(), Stats.Waits.GetMaxMs()));
+	};
+	LockInfo(TEXT("LevelDataMapMutex"), GSpudLevelDataMapLockStats);
+	LockInfo(TEXT("Level Mutex"), GSpudLevelLockStats);
+	AddInfo(FString::Printf(TEXT("Background writes: %llu, latency avg %.3fms max %.3fms"),
+	                        GSpudBackgroundWriteStats.Count.load(), GSpudBackgroundWriteStats.GetAverageMs(),
+	                        GSpudBackgroundWriteStats.GetMaxMs()));
+
+	GSpudCollectContentionStats = bPrevCollect;
+	State->RemoveAllActiveGameLevelFiles();
+
+	TestTrue(FString::Printf(TEXT("p99 game thread stall %.3fms should be under %.1fms"), P99, MaxP99StallMs),
+	         P99 < MaxP99StallMs);
+
+	return true;
+}
@@ -1,7 +1,13 @@
 ﻿#include "Misc/AutomationTest.h"
 #include "Engine.h"
+#include "EngineUtils.h"
 #include "SpudState.h"
+#include "SpudBulkEntities.h"
+#include "SpudCompiledSerializer.h"
+#include "SpudSubsystem.h"
+#include "Async/Async.h"
 #include "TestSaveObject.h"
+#include "SpudTestWorld.h"
 
 
 template<typename T>
@@ -336,3 +342,1631 @@ bool FTestNestedObject::RunTest(const FString& Parameters)
 
 	return true;
 }
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestSharedNestedObject, "SPUDTest.SharedNestedObject",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestSharedNestedObject::RunTest(const FString& Parameters)
+{
+	auto SavedObj = NewObject<UTestSaveObjectSharedNested>();
+	SavedObj->First = NewObject<UTestNestedUObject>(SavedObj);
+	SavedObj->First->NestedStringVal = "Shared";
+	SavedObj->First->NestedIntVal = 42;
+	SavedObj->Second = SavedObj->First;
+	SavedObj->AfterNestedVal = 7;
+
+	auto State = NewObject<USpudState>();
+	State->StoreGlobalObject(SavedObj, "TestObject");
+
+	auto LoadedObj = NewObject<UTestSaveObjectSharedNested>();
+	State->RestoreGlobalObject(LoadedObj, "TestObject");
+
+	if (TestNotNull("First shouldn't be null", LoadedObj->First))
+	{
+		TestEqual("Second should be the same instance as First", LoadedObj->Second, LoadedObj->First);
+		TestEqual("Shared string", LoadedObj->First->NestedStringVal, SavedObj->First->NestedStringVal);
+		TestEqual("Shared int", LoadedObj->First->NestedIntVal, SavedObj->First->NestedIntVal);
+	}
+	TestEqual("Value after nested objects", LoadedObj->AfterNestedVal, SavedObj->AfterNestedVal);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestSharedNestedObjectReordered, "SPUDTest.SharedNestedObjectReordered",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestSharedNestedObjectReordered::RunTest(const FString& Parameters)
+{
+	// Swapping the stored names of First and Second is the same as the properties changing order in the class, so
+	// the restore has to use the slow path and reads Second's data (written later in the stream) first
+	const auto SwapFirstAndSecond = [](USpudState* State)
+	{
+		const FString ClassName = SpudPropertyUtil::GetClassName(GetDefault<UTestSaveObjectSharedNested>());
+		State->RenameProperty(ClassName, "First", "Swap", "", "");
+		State->RenameProperty(ClassName, "Second", "First", "", "");
+		State->RenameProperty(ClassName, "Swap", "Second", "", "");
+	};
+
+	{
+		auto SavedObj = NewObject<UTestSaveObjectSharedNested>();
+		SavedObj->First = NewObject<UTestNestedUObject>(SavedObj);
+		SavedObj->First->NestedStringVal = "First";
+		SavedObj->First->NestedIntVal = 1;
+		SavedObj->Second = NewObject<UTestNestedUObject>(SavedObj);
+		SavedObj->Second->NestedStringVal = "Second";
+		SavedObj->Second->NestedIntVal = 2;
+		SavedObj->AfterNestedVal = 7;
+
+		auto State = NewObject<USpudState>();
+		State->StoreGlobalObject(SavedObj, "TestObject");
+		SwapFirstAndSecond(State);
+
+		auto LoadedObj = NewObject<UTestSaveObjectSharedNested>();
+		State->RestoreGlobalObject(LoadedObj, "TestObject");
+
+		if (TestNotNull("Distinct First shouldn't be null", LoadedObj->First) &&
+			TestNotNull("Distinct Second shouldn't be null", LoadedObj->Second))
+		{
+			TestEqual("First should have the data stored as Second", LoadedObj->First->NestedStringVal, SavedObj->Second->NestedStringVal);
+			TestEqual("First should have the data stored as Second", LoadedObj->First->NestedIntVal, SavedObj->Second->NestedIntVal);
+			TestEqual("Second should have the data stored as First", LoadedObj->Second->NestedStringVal, SavedObj->First->NestedStringVal);
+			TestEqual("Second should have the data stored as First", LoadedObj->Second->NestedIntVal, SavedObj->First->NestedIntVal);
+		}
+		TestEqual("Distinct value after nested objects", LoadedObj->AfterNestedVal, SavedObj->AfterNestedVal);
+	}
+
+	{
+		// Now the back-reference is read before the object it refers to
+		auto SavedObj = NewObject<UTestSaveObjectSharedNested>();
+		SavedObj->First = NewObject<UTestNestedUObject>(SavedObj);
+		SavedObj->First->NestedStringVal = "Shared";
+		SavedObj->First->NestedIntVal = 42;
+		SavedObj->Second = SavedObj->First;
+		SavedObj->AfterNestedVal = 7;
+
+		auto State = NewObject<USpudState>();
+		State->StoreGlobalObject(SavedObj, "TestObject");
+		SwapFirstAndSecond(State);
+
+		auto LoadedObj = NewObject<UTestSaveObjectSharedNested>();
+		State->RestoreGlobalObject(LoadedObj, "TestObject");
+
+		if (TestNotNull("Shared First shouldn't be null", LoadedObj->First))
+		{
+			TestEqual("Second should be the same instance as First", LoadedObj->Second, LoadedObj->First);
+			TestEqual("Shared string", LoadedObj->First->NestedStringVal, SavedObj->First->NestedStringVal);
+			TestEqual("Shared int", LoadedObj->First->NestedIntVal, SavedObj->First->NestedIntVal);
+		}
+		TestEqual("Shared value after nested objects", LoadedObj->AfterNestedVal, SavedObj->AfterNestedVal);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestCompactFormat, "SPUDTest.CompactFormat",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestCompactFormat::RunTest(const FString& Parameters)
+{
+	auto SavedObj = NewObject<UTestSaveObjectBasic>();
+
+	PopulateAllTypes(*SavedObj);
+
+	// State picks up the format when its metadata is created
+	const ESpudDataFormat PrevFormat = GSpudDataFormat;
+	GSpudDataFormat = SDF_Compact;
+	auto State = NewObject<USpudState>();
+	GSpudDataFormat = PrevFormat;
+
+	State->StoreGlobalObject(SavedObj, "TestObject");
+
+	auto LoadedObj = NewObject<UTestSaveObjectBasic>();
+	State->RestoreGlobalObject(LoadedObj, "TestObject");
+
+	CheckAllTypes(this, "CompactObject|", *LoadedObj, *SavedObj);
+
+	// Round trip through an archive, with an array longer than the fixed width format's 16-bit counts allow
+	SavedObj->IntArray.SetNumUninitialized(70000);
+	for (int i = 0; i < SavedObj->IntArray.Num(); ++i)
+		SavedObj->IntArray[i] = i * 37 - 100000;
+	State->StoreGlobalObject(SavedObj, "TestObject");
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	State->SaveToArchive(Writer);
+	TestFalse("Compact save should be written without error", Writer.IsError());
+
+	auto LoadedState = NewObject<USpudState>();
+	FMemoryReader Reader(Bytes);
+	LoadedState->LoadFromArchive(Reader, true);
+	TestFalse("Compact save should be read without error", Reader.IsError());
+	LoadedObj = NewObject<UTestSaveObjectBasic>();
+	LoadedState->RestoreGlobalObject(LoadedObj, "TestObject");
+	TestEqual("Long array should be restored in full", LoadedObj->IntArray.Num(), 70000);
+	CheckAllTypes(this, "CompactArchive|", *LoadedObj, *SavedObj);
+
+	// A corrupt count mustn't be used to size an array
+	FSpudClassMetadata CompactMeta;
+	CompactMeta.DataFormat.Version = SDF_Compact;
+	AddExpectedError(TEXT("Array count"), EAutomationExpectedErrorFlags::Contains, 2);
+	for (const uint64 BadCount : { static_cast<uint64>(MAX_uint32) + 1, static_cast<uint64>(1000) })
+	{
+		TArray<uint8> CountBytes;
+		FMemoryWriter CountWriter(CountBytes);
+		SpudWriteVarUInt(CountWriter, BadCount);
+		FMemoryReader CountReader(CountBytes);
+		TestEqual("Corrupt array count should be rejected", SpudPropertyUtil::ReadArrayCount(CountReader, CompactMeta), 0);
+		TestTrue("Corrupt array count should fail the read", CountReader.IsError());
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBlittableStructs, "SPUDTest.BlittableStruct",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestBlittableStructs::RunTest(const FString& Parameters)
+{
+	TestTrue("Struct should be eligible for blittable", SpudPropertyUtil::RegisterBlittableStruct<FTestBlittableStruct>());
+
+	auto SavedObj = NewObject<UTestSaveObjectBlittable>();
+	SavedObj->SingleStruct.IntVal = -123456;
+	SavedObj->SingleStruct.FloatVal = 12.3456f;
+	SavedObj->SingleStruct.bFlag = true;
+	SavedObj->SingleStruct.EnumVal = ETestEnum::Third;
+	SavedObj->SingleStruct.VectorVal = FVector(1, 2, 3);
+	for (int i = 0; i < 3; ++i)
+	{
+		FTestBlittableStruct S;
+		S.IntVal = i * 100;
+		S.bFlag = (i % 2) == 1;
+		S.VectorVal = FVector(i, -i, i * 2);
+		SavedObj->StructArray.Add(S);
+	}
+	SavedObj->AfterStructVal = 998877;
+
+	auto State = NewObject<USpudState>();
+	State->bTestRequireFastPath = true;
+	State->StoreGlobalObject(SavedObj, "BlittableTest");
+
+	auto LoadedObj = NewObject<UTestSaveObjectBlittable>();
+	State->RestoreGlobalObject(LoadedObj, "BlittableTest");
+
+	SpudPropertyUtil::UnregisterBlittableStruct(FTestBlittableStruct::StaticStruct());
+
+	TestEqual("Int should match", LoadedObj->SingleStruct.IntVal, SavedObj->SingleStruct.IntVal);
+	TestEqual("Float should match", LoadedObj->SingleStruct.FloatVal, SavedObj->SingleStruct.FloatVal);
+	TestEqual("Bool should match", (bool)LoadedObj->SingleStruct.bFlag, (bool)SavedObj->SingleStruct.bFlag);
+	TestEqual("Enum should match", LoadedObj->SingleStruct.EnumVal, SavedObj->SingleStruct.EnumVal);
+	TestEqual("Vector should match", LoadedObj->SingleStruct.VectorVal, SavedObj->SingleStruct.VectorVal);
+	if (TestEqual("Array size should match", LoadedObj->StructArray.Num(), SavedObj->StructArray.Num()))
+	{
+		for (int i = 0; i < SavedObj->StructArray.Num(); ++i)
+		{
+			TestEqual("Array int should match", LoadedObj->StructArray[i].IntVal, SavedObj->StructArray[i].IntVal);
+			TestEqual("Array bool should match", (bool)LoadedObj->StructArray[i].bFlag, (bool)SavedObj->StructArray[i].bFlag);
+			TestEqual("Array vector should match", LoadedObj->StructArray[i].VectorVal, SavedObj->StructArray[i].VectorVal);
+		}
+	}
+	TestEqual("Value after struct should match", LoadedObj->AfterStructVal, SavedObj->AfterStructVal);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBlittablePadding, "SPUDTest.BlittablePadding",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestBlittablePadding::RunTest(const FString& Parameters)
+{
+	SpudPropertyUtil::RegisterBlittableStruct<FTestBlittableStruct>();
+
+	// Same field values, different garbage in the padding & unused bitfield bits
+	auto SetFields = [](FTestBlittableStruct& S, uint8 Garbage)
+	{
+		FMemory::Memset(&S, Garbage, sizeof(FTestBlittableStruct));
+		S.IntVal = 42;
+		S.FloatVal = 1.5f;
+		S.bFlag = true;
+		S.EnumVal = ETestEnum::Second;
+		S.VectorVal = FVector(1, 2, 3);
+	};
+	auto CleanObj = NewObject<UTestSaveObjectBlittable>();
+	SetFields(CleanObj->SingleStruct, 0);
+	auto DirtyObj = NewObject<UTestSaveObjectBlittable>();
+	SetFields(DirtyObj->SingleStruct, 0xCD);
+
+	auto State = NewObject<USpudState>();
+	State->StoreGlobalObject(CleanObj, "Clean");
+	State->StoreGlobalObject(DirtyObj, "Dirty");
+	const auto Clean = State->SaveData.GlobalData.Objects.Find("Clean");
+	const auto Dirty = State->SaveData.GlobalData.Objects.Find("Dirty");
+	if (TestNotNull("Clean data should exist", Clean) && TestNotNull("Dirty data should exist", Dirty))
+		TestTrue("Padding should not be stored", Clean->Properties.Data == Dirty->Properties.Data);
+
+	SpudPropertyUtil::UnregisterBlittableStruct(FTestBlittableStruct::StaticStruct());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestColumnarStructArray, "SPUDTest.ColumnarStructArray",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestColumnarStructArray::RunTest(const FString& Parameters)
+{
+	TestNotNull("Struct should be eligible for columns",
+	            SpudPropertyUtil::GetColumnarStructLayout(FTestColumnarStruct::StaticStruct()));
+
+	auto SavedObj = NewObject<UTestSaveObjectColumnar>();
+	for (int i = 0; i < 50; ++i)
+	{
+		FTestColumnarStruct S;
+		S.Name = FString::Printf(TEXT("Item %d"), i);
+		S.Tag = i % 3 ? FName("Weapon") : FName("Armour");
+		S.Count = i * 7;
+		S.bEquipped = (i % 4) == 0;
+		S.EnumVal = static_cast<ETestEnum>(i % 3);
+		S.Location = FVector(i, -i, i * 0.5);
+		SavedObj->Items.Add(S);
+	}
+	SavedObj->AfterArrayVal = 998877;
+
+	for (bool bFastPath : { true, false })
+	{
+		auto State = NewObject<USpudState>();
+		State->bTestRequireFastPath = bFastPath;
+		State->bTestRequireSlowPath = !bFastPath;
+		State->StoreGlobalObject(SavedObj, "ColumnarTest");
+
+		auto LoadedObj = NewObject<UTestSaveObjectColumnar>();
+		State->RestoreGlobalObject(LoadedObj, "ColumnarTest");
+
+		if (TestEqual("Array size should match", LoadedObj->Items.Num(), SavedObj->Items.Num()))
+		{
+			for (int i = 0; i < SavedObj->Items.Num(); ++i)
+			{
+				const auto& Saved = SavedObj->Items[i];
+				const auto& Loaded = LoadedObj->Items[i];
+				TestEqual("Name should match", Loaded.Name, Saved.Name);
+				TestEqual("Tag should match", Loaded.Tag, Saved.Tag);
+				TestEqual("Count should match", Loaded.Count, Saved.Count);
+				TestEqual("Bool should match", Loaded.bEquipped, Saved.bEquipped);
+				TestEqual("Enum should match", Loaded.EnumVal, Saved.EnumVal);
+				TestEqual("Vector should match", Loaded.Location, Saved.Location);
+			}
+		}
+		TestEqual("Value after array should match", LoadedObj->AfterArrayVal, SavedObj->AfterArrayVal);
+	}
+
+	for (bool bFastPath : { true, false })
+	{
+		// Without the stored layout the columns can't be read, but they're skipped so later properties still restore
+		auto State = NewObject<USpudState>();
+		State->bTestRequireSlowPath = !bFastPath;
+		State->StoreGlobalObject(SavedObj, "ColumnarTest");
+		State->SaveData.GlobalData.Metadata.StructLayouts.Contents.Empty();
+
+		auto LoadedObj = NewObject<UTestSaveObjectColumnar>();
+		AddExpectedError(TEXT("stored layout not found"), EAutomationExpectedErrorFlags::Contains, 1);
+		State->RestoreGlobalObject(LoadedObj, "ColumnarTest");
+		TestEqual("Value after array with missing layout should match", LoadedObj->AfterArrayVal, SavedObj->AfterArrayVal);
+	}
+
+	return true;
+}
+
+SPUD_PERSIST(UTestSaveObjectCompiled,
+	SPUD_FIELD(IntVal),
+	SPUD_FIELD(FloatVal),
+	SPUD_FIELD(bBoolVal),
+	SPUD_FIELD(StringVal),
+	SPUD_FIELD(EnumVal),
+	SPUD_FIELD(VectorVal),
+	SPUD_FIELD(IntArray),
+	SPUD_FIELD(BoolArray));
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestCompiledSerializer, "SPUDTest.CompiledSerializer",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestCompiledSerializer::RunTest(const FString& Parameters)
+{
+	TestTrue("Compiled serializer should be valid",
+	         FSpudCompiledSerializers::Find(UTestSaveObjectCompiled::StaticClass()).IsValid());
+
+	auto SavedObj = NewObject<UTestSaveObjectCompiled>();
+	SavedObj->IntVal = -123456;
+	SavedObj->FloatVal = 12.3456f;
+	SavedObj->bBoolVal = true;
+	SavedObj->StringVal = "Hello compiled";
+	SavedObj->EnumVal = ETestEnum::Third;
+	SavedObj->VectorVal = FVector(1, 2, 3);
+	SavedObj->IntArray = { 1, -2, 300000 };
+	SavedObj->BoolArray = { true, false, true };
+
+	// Output must be identical to reflection
+	auto State = NewObject<USpudState>();
+	State->StoreGlobalObject(SavedObj, "CompiledTest");
+	auto ReflectedState = NewObject<USpudState>();
+	ReflectedState->bTestDisableCompiledSerializers = true;
+	ReflectedState->StoreGlobalObject(SavedObj, "CompiledTest");
+	const auto Compiled = State->SaveData.GlobalData.Objects.Contents.Find("CompiledTest");
+	const auto Reflected = ReflectedState->SaveData.GlobalData.Objects.Contents.Find("CompiledTest");
+	if (TestNotNull("Compiled data should exist", Compiled) && TestNotNull("Reflected data should exist", Reflected))
+	{
+		TestTrue("Property data should match reflection", Compiled->Properties.Data == Reflected->Properties.Data);
+		TestTrue("Property offsets should match reflection",
+		         Compiled->Properties.PropertyOffsets == Reflected->Properties.PropertyOffsets);
+	}
+
+	// Store again now the class def exists to cover the direct index path
+	State->StoreGlobalObject(SavedObj, "CompiledTest");
+
+	auto LoadedObj = NewObject<UTestSaveObjectCompiled>();
+	State->bTestRequireFastPath = true;
+	State->RestoreGlobalObject(LoadedObj, "CompiledTest");
+
+	TestEqual("Int should match", LoadedObj->IntVal, SavedObj->IntVal);
+	TestEqual("Float should match", LoadedObj->FloatVal, SavedObj->FloatVal);
+	TestEqual("Bool should match", LoadedObj->bBoolVal, SavedObj->bBoolVal);
+	TestEqual("String should match", LoadedObj->StringVal, SavedObj->StringVal);
+	TestEqual("Enum should match", LoadedObj->EnumVal, SavedObj->EnumVal);
+	TestEqual("Vector should match", LoadedObj->VectorVal, SavedObj->VectorVal);
+	TestTrue("Int array should match", LoadedObj->IntArray == SavedObj->IntArray);
+	TestTrue("Bool array should match", LoadedObj->BoolArray == SavedObj->BoolArray);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLargeChunkHeader, "SPUDTest.LargeChunkHeader",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestLargeChunkHeader::RunTest(const FString& Parameters)
+{
+	// Writing 4GB isn't practical, so force a small chunk to use the large header
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	FSpudChunkedDataArchive WriteAr(Writer);
+	FSpudAdhocWrapperChunk LargeChunk("LRGE");
+	FSpudVersionInfo Inner;
+	Inner.Version = 1234;
+	FSpudVersionInfo After;
+	After.Version = 5678;
+	int32 Payload = 42;
+	if (TestTrue("Large chunk should start", LargeChunk.ChunkStart(WriteAr, SPUDDATA_LARGE_CHUNK_THRESHOLD)))
+	{
+		Inner.WriteToArchive(WriteAr);
+		WriteAr << Payload;
+		LargeChunk.ChunkEnd(WriteAr);
+	}
+	After.WriteToArchive(WriteAr);
+	TestFalse("Write should succeed", WriteAr.IsError());
+	const int64 ExpectedLength = FSpudChunkHeader::GetHeaderSize() + sizeof(int32) + sizeof(int32);
+	TestEqual("Large header size", LargeChunk.ChunkDataStart - LargeChunk.ChunkHeaderStart,
+	          FSpudChunkHeader::GetLargeHeaderSize());
+
+	FMemoryReader Reader(Bytes);
+	FSpudChunkedDataArchive ReadAr(Reader);
+	FSpudChunkHeader Hdr;
+	TestTrue("Large chunk should preview", ReadAr.PreviewNextChunk(Hdr, true));
+	TestTrue("Header should be large", Hdr.bLarge);
+	TestEqual("Header length", Hdr.Length, static_cast<uint64>(ExpectedLength));
+
+	// Skipping must land on the next chunk
+	ReadAr.SkipNextChunk();
+	FSpudVersionInfo ReadAfter;
+	ReadAfter.ReadFromArchive(ReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Chunk after skipped large chunk", ReadAfter.Version, After.Version);
+
+	// And reading it properly gets the contents
+	Reader.Seek(0);
+	FSpudAdhocWrapperChunk ReadChunk("LRGE");
+	if (TestTrue("Large chunk should be read", ReadChunk.ChunkStart(ReadAr)))
+	{
+		FSpudVersionInfo ReadInner;
+		ReadInner.ReadFromArchive(ReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+		TestEqual("Chunk inside large chunk", ReadInner.Version, Inner.Version);
+		int32 ReadPayload = 0;
+		ReadAr << ReadPayload;
+		TestEqual("Data inside large chunk", ReadPayload, Payload);
+		TestFalse("Large chunk should be finished", ReadChunk.IsStillInChunk(ReadAr));
+		ReadChunk.ChunkEnd(ReadAr);
+	}
+	ReadAfter.ReadFromArchive(ReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Chunk after large chunk", ReadAfter.Version, After.Version);
+	TestFalse("Read should succeed", ReadAr.IsError());
+
+	return true;
+}
+
+static void PopulateTestLevelData(FSpudSaveData& SaveData, const FString& LevelName)
+{
+	auto LevelData = SaveData.CreateLevelData(LevelName);
+	for (int i = 0; i < 100; ++i)
+	{
+		auto& Obj = LevelData->LevelActors.Contents.Add(FString::Printf(TEXT("Actor%d"), i));
+		Obj.Name = FString::Printf(TEXT("Actor%d"), i);
+		Obj.Properties.Data.Init(static_cast<uint8>(i), 64);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestCompressedLevelData, "SPUDTest.CompressedLevelData",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestCompressedLevelData::RunTest(const FString& Parameters)
+{
+	const int64 PrevBudget = GSpudCompressedLevelDataBudget;
+	const FString LevelPath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("SpudCompressedLevelTest/"));
+	GSpudCompressedLevelDataBudget = 1024 * 1024;
+
+	FSpudSaveData SaveData;
+	PopulateTestLevelData(SaveData, "LevelA");
+	PopulateTestLevelData(SaveData, "LevelB");
+
+	SaveData.WriteAndReleaseLevelData("LevelA", LevelPath, true);
+	auto LevelA = SaveData.GetLevelData("LevelA", false, LevelPath);
+	TestTrue("Level A should be compressed", LevelA->Status == LDS_Compressed);
+	TestFalse("Level A should not have been written to disk",
+	          IFileManager::Get().FileExists(*FSpudSaveData::GetLevelDataPath(LevelPath, "LevelA")));
+
+	SaveData.GetLevelData("LevelA", true, LevelPath);
+	TestTrue("Level A should be loaded from memory", LevelA->Status == LDS_Loaded);
+	TestEqual("Level A actors should be restored", LevelA->LevelActors.Contents.Num(), 100);
+	TArray<uint8> ExpectedData;
+	ExpectedData.Init(42, 64);
+	if (const auto Obj = LevelA->LevelActors.Contents.Find("Actor42"))
+		TestTrue("Level A actor data should be restored", Obj->Properties.Data == ExpectedData);
+	else
+		AddError("Level A actor missing after decompression");
+
+	// Only room for one level, so the oldest is written to disk
+	SaveData.WriteAndReleaseLevelData("LevelA", LevelPath, true);
+	GSpudCompressedLevelDataBudget = LevelA->CompressedData.Num() * 3 / 2;
+	SaveData.WriteAndReleaseLevelData("LevelB", LevelPath, true);
+	auto LevelB = SaveData.GetLevelData("LevelB", false, LevelPath);
+	TestTrue("Level A should have been written to disk", LevelA->Status == LDS_Unloaded);
+	TestTrue("Level B should be compressed", LevelB->Status == LDS_Compressed);
+
+	SaveData.GetLevelData("LevelA", true, LevelPath);
+	TestEqual("Level A actors should be restored from disk", LevelA->LevelActors.Contents.Num(), 100);
+
+	IFileManager::Get().DeleteDirectory(*LevelPath, false, true);
+	GSpudCompressedLevelDataBudget = PrevBudget;
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLazyBlobs, "SPUDTest.LazyBlobs",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestLazyBlobs::RunTest(const FString& Parameters)
+{
+	const int64 PrevBudget = GSpudCompressedLevelDataBudget;
+	const FString LevelPath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("SpudLazyBlobTest/"));
+	GSpudCompressedLevelDataBudget = 0;
+
+	FSpudSaveData SaveData;
+	PopulateTestLevelData(SaveData, "LevelA");
+	TArray<uint8> BlobData;
+	for (int i = 0; i < 256 * 1024; ++i)
+		BlobData.Add(static_cast<uint8>(i / 1024));
+	{
+		auto LevelA = SaveData.GetLevelData("LevelA", false, LevelPath);
+		auto& Blob = LevelA->Blobs.Contents.Add("Actor42/Terrain");
+		Blob.Name = "Actor42/Terrain";
+		Blob.Owner = "Actor42";
+		Blob.SetData(BlobData, true);
+		TestTrue("Blob should be compressed", Blob.bCompressed);
+	}
+
+	SaveData.WriteAndReleaseLevelData("LevelA", LevelPath, true);
+	auto LevelA = SaveData.GetLevelData("LevelA", true, LevelPath);
+	auto Blob = LevelA->Blobs.Contents.Find("Actor42/Terrain");
+	if (!TestNotNull("Blob should be listed after paging in", Blob))
+	{
+		GSpudCompressedLevelDataBudget = PrevBudget;
+		return false;
+	}
+	TestFalse("Blob payload should not be loaded with the level", Blob->Payload.IsValid());
+
+	// Paging out again has to carry the unread payload over to the new level file
+	SaveData.WriteAndReleaseLevelData("LevelA", LevelPath, true);
+	LevelA = SaveData.GetLevelData("LevelA", true, LevelPath);
+	Blob = LevelA->Blobs.Contents.Find("Actor42/Terrain");
+	TArray<uint8> ReadData;
+	TestTrue("Blob should be readable on demand", Blob && Blob->GetData(ReadData));
+	TestTrue("Blob data should match", ReadData == BlobData);
+
+	// Blobs go with their owner
+	LevelA->LevelActors.Contents.Remove("Actor42");
+	LevelA->RemoveOrphanedBlobs();
+	TestEqual("Orphaned blob should be removed", LevelA->Blobs.Contents.Num(), 0);
+
+	IFileManager::Get().DeleteDirectory(*LevelPath, false, true);
+	GSpudCompressedLevelDataBudget = PrevBudget;
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLazyGlobalObjects, "SPUDTest.LazyGlobalObjects",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestLazyGlobalObjects::RunTest(const FString& Parameters)
+{
+	auto SavedObj = NewObject<UTestSaveObjectBasic>();
+	PopulateAllTypes(*SavedObj);
+	auto OtherObj = NewObject<UTestSaveObjectBasic>();
+	PopulateAllTypes(*OtherObj);
+
+	auto State = NewObject<USpudState>();
+	State->StoreGlobalObject(SavedObj, "TestObject");
+	State->StoreGlobalObject(OtherObj, "OtherObject");
+	TArray<uint8> SaveBytes;
+	FMemoryWriter Writer(SaveBytes);
+	State->SaveToArchive(Writer);
+
+	auto LoadedState = NewObject<USpudState>();
+	FMemoryReader Reader(SaveBytes);
+	LoadedState->LoadFromArchive(Reader, true);
+	const auto& Objects = LoadedState->SaveData.GlobalData.Objects;
+	TestEqual("Objects should not be decoded on load", Objects.Contents.Num(), 0);
+	TestEqual("All objects should be present", Objects.Encoded.Num(), 2);
+
+	auto LoadedObj = NewObject<UTestSaveObjectBasic>();
+	LoadedState->RestoreGlobalObject(LoadedObj, "TestObject");
+	CheckAllTypes(this, "LazyObject|", *LoadedObj, *SavedObj);
+	TestEqual("Only the restored object should be decoded", Objects.Contents.Num(), 1);
+
+	// Nothing was stored, so objects should be copied back out as they were read
+	TArray<uint8> ResaveBytes;
+	FMemoryWriter ResaveWriter(ResaveBytes);
+	LoadedState->SaveToArchive(ResaveWriter);
+	TestTrue("Unchanged save data should be identical", ResaveBytes == SaveBytes);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestUpdateSaveInfo, "SPUDTest.UpdateSaveInfo",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestUpdateSaveInfo::RunTest(const FString& Parameters)
+{
+	auto SavedObj = NewObject<UTestSaveObjectBasic>();
+	PopulateAllTypes(*SavedObj);
+	auto State = NewObject<USpudState>();
+	State->SetTitle(FText::FromString("Original"));
+	State->StoreGlobalObject(SavedObj, "TestObject");
+	TArray<uint8> SaveBytes;
+	FMemoryWriter Writer(SaveBytes);
+	State->SaveToArchive(Writer);
+
+	const FString Filename = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("SpudUpdateInfoTest.sav"));
+	FFileHelper::SaveArrayToFile(SaveBytes, *Filename);
+	auto ReadInfo = [&Filename]()
+	{
+		auto Info = NewObject<USpudSaveGameInfo>();
+		auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+		USpudState::LoadSaveInfoFromArchive(*Archive, *Info);
+		return Info;
+	};
+
+	// Fits in the padding
+	TestTrue("Title update should succeed", FSpudSaveData::UpdateSaveInfoInFile(Filename, [](FSpudSaveInfo& Info)
+	{
+		Info.Title = FText::FromString("Renamed");
+	}));
+	TestEqual("Title should be updated", ReadInfo()->Title.ToString(), FString("Renamed"));
+	TestEqual("File should be the same size", IFileManager::Get().FileSize(*Filename), static_cast<int64>(SaveBytes.Num()));
+
+	// Outgrows it
+	TArray<uint8> Screenshot;
+	Screenshot.Init(42, GSpudSaveInfoPadding * 2);
+	TestTrue("Screenshot update should succeed", FSpudSaveData::UpdateSaveInfoInFile(Filename, [&Screenshot](FSpudSaveInfo& Info)
+	{
+		Info.Screenshot.ImageData = Screenshot;
+	}));
+	TestTrue("File should have grown", IFileManager::Get().FileSize(*Filename) > SaveBytes.Num());
+	{
+		auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		FSpudSaveInfo Info;
+		FSpudSaveData::ReadSaveInfoFromArchive(ChunkedAr, Info);
+		TestTrue("Info should have been relocated", Info.RelocatedOffset > 0);
+		TestTrue("Relocated screenshot should be read", Info.Screenshot.ImageData == Screenshot);
+		TestEqual("Relocated title should be read", Info.Title.ToString(), FString("Renamed"));
+	}
+	const int64 RelocatedFileSize = IFileManager::Get().FileSize(*Filename);
+
+	// Outgrowing the relocated info replaces it rather than leaving it behind
+	Screenshot.Init(43, GSpudSaveInfoPadding * 3);
+	TestTrue("Bigger screenshot update should succeed", FSpudSaveData::UpdateSaveInfoInFile(Filename, [&Screenshot](FSpudSaveInfo& Info)
+	{
+		Info.Screenshot.ImageData = Screenshot;
+	}));
+	TestEqual("File should only have grown by the extra screenshot data", IFileManager::Get().FileSize(*Filename),
+	          RelocatedFileSize + GSpudSaveInfoPadding);
+	{
+		auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		FSpudSaveInfo Info;
+		FSpudSaveData::ReadSaveInfoFromArchive(ChunkedAr, Info);
+		TestTrue("Bigger screenshot should be read", Info.Screenshot.ImageData == Screenshot);
+	}
+
+	// The rest of the save is untouched
+	TArray<uint8> UpdatedBytes;
+	FFileHelper::LoadFileToArray(UpdatedBytes, *Filename);
+	auto LoadedState = NewObject<USpudState>();
+	FMemoryReader Reader(UpdatedBytes);
+	LoadedState->LoadFromArchive(Reader, true);
+	TestEqual("Loaded title should be updated", LoadedState->GetTitle().ToString(), FString("Renamed"));
+	auto LoadedObj = NewObject<UTestSaveObjectBasic>();
+	LoadedState->RestoreGlobalObject(LoadedObj, "TestObject");
+	CheckAllTypes(this, "UpdateSaveInfo|", *LoadedObj, *SavedObj);
+
+	// Fitting back in the original space gives the relocated space back
+	TestTrue("Screenshot removal should succeed", FSpudSaveData::UpdateSaveInfoInFile(Filename, [](FSpudSaveInfo& Info)
+	{
+		Info.Screenshot.ImageData.Empty();
+	}));
+	TestEqual("File should be back to its original size", IFileManager::Get().FileSize(*Filename), static_cast<int64>(SaveBytes.Num()));
+	TestEqual("Title should survive moving back", ReadInfo()->Title.ToString(), FString("Renamed"));
+
+	IFileManager::Get().Delete(*Filename);
+
+	// A corrupt stub pointing back at itself must not be followed
+	const int64 StubOffset = 8;
+	TArray<uint8> StubBytes;
+	StubBytes.SetNumZeroed(StubOffset);
+	// Appends after the leading bytes
+	FMemoryWriter StubWriter(StubBytes, false, true);
+	FSpudChunkedDataArchive StubWriteAr(StubWriter);
+	FSpudSaveInfo Stub;
+	Stub.Title = FText::FromString("Stub");
+	Stub.WriteToArchive(StubWriteAr, StubOffset);
+	AddExpectedError(TEXT("is missing"), EAutomationExpectedErrorFlags::Contains, 1);
+	FMemoryReader StubReader(StubBytes);
+	StubReader.Seek(StubOffset);
+	FSpudChunkedDataArchive StubReadAr(StubReader);
+	FSpudSaveInfo StubInfo;
+	StubInfo.ReadFromArchive(StubReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Stub title should still be read", StubInfo.Title.ToString(), FString("Stub"));
+	TestEqual("Stub shouldn't be treated as relocated", StubInfo.RelocatedOffset, static_cast<int64>(0));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestObjectSnapshot, "SPUDTest.ObjectSnapshot",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestObjectSnapshot::RunTest(const FString& Parameters)
+{
+	auto SavedObj = NewObject<UTestSaveObjectBasic>();
+	PopulateAllTypes(*SavedObj);
+	auto SavedParent = NewObject<UTestSaveObjectParent>();
+	SavedParent->UObjectVal1 = NewObject<UTestNestedChild1>();
+
+	auto State = NewObject<USpudState>();
+	TArray<uint8> Bytes;
+	State->StoreObjectSnapshot(TArray<UObject*> { SavedObj, nullptr, SavedParent }, Bytes);
+
+	auto LoadedObj = NewObject<UTestSaveObjectBasic>();
+	auto LoadedParent = NewObject<UTestSaveObjectParent>();
+	TestFalse("Restoring the wrong number of objects should fail",
+		State->RestoreObjectSnapshot(TArray<UObject*> { LoadedObj }, Bytes));
+	TestTrue("Snapshot should restore",
+		State->RestoreObjectSnapshot(TArray<UObject*> { LoadedObj, nullptr, LoadedParent }, Bytes));
+	CheckAllTypes(this, "Snapshot|", *LoadedObj, *SavedObj);
+	TestNotNull("Nested UObject should be restored", LoadedParent->UObjectVal1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestCanonicalOutput, "SPUDTest.CanonicalOutput",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestCanonicalOutput::RunTest(const FString& Parameters)
+{
+	// Different classes, so that class, property & name IDs depend on which is stored first
+	auto BasicObj = NewObject<UTestSaveObjectBasic>();
+	PopulateAllTypes(*BasicObj);
+	auto StructsObj = NewObject<UTestSaveObjectStructs>();
+	PopulateAllTypes(StructsObj->SimpleStruct);
+	PopulateAllTypes(StructsObj->NestedStruct.Nested);
+	auto ParentObj = NewObject<UTestSaveObjectParent>();
+	ParentObj->UObjectVal1 = NewObject<UTestNestedChild1>();
+	ParentObj->UObjectVal3 = NewObject<UTestNestedChild3>();
+
+	const bool bPrevCanonical = GSpudCanonicalOutput;
+	GSpudCanonicalOutput = true;
+
+	// Same state, stored in opposite orders
+	auto State = NewObject<USpudState>();
+	State->StoreGlobalObject(BasicObj, "Basic");
+	State->StoreGlobalObject(StructsObj, "Structs");
+	State->StoreGlobalObject(ParentObj, "Parent");
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	State->SaveToArchive(Writer);
+
+	auto OtherState = NewObject<USpudState>();
+	OtherState->StoreGlobalObject(ParentObj, "Parent");
+	OtherState->StoreGlobalObject(StructsObj, "Structs");
+	OtherState->StoreGlobalObject(BasicObj, "Basic");
+	TArray<uint8> OtherBytes;
+	FMemoryWriter OtherWriter(OtherBytes);
+	OtherState->SaveToArchive(OtherWriter);
+
+	GSpudCanonicalOutput = bPrevCanonical;
+
+	TestTrue("Identical state should produce identical bytes", Bytes == OtherBytes);
+
+	// Rebuilt data must still restore
+	auto LoadedState = NewObject<USpudState>();
+	FMemoryReader Reader(OtherBytes);
+	LoadedState->LoadFromArchive(Reader, true);
+	auto LoadedBasic = NewObject<UTestSaveObjectBasic>();
+	LoadedState->RestoreGlobalObject(LoadedBasic, "Basic");
+	CheckAllTypes(this, "Canonical|", *LoadedBasic, *BasicObj);
+	auto LoadedStructs = NewObject<UTestSaveObjectStructs>();
+	LoadedState->RestoreGlobalObject(LoadedStructs, "Structs");
+	CheckAllTypes(this, "CanonicalStruct|", LoadedStructs->SimpleStruct, StructsObj->SimpleStruct);
+	auto LoadedParent = NewObject<UTestSaveObjectParent>();
+	LoadedState->RestoreGlobalObject(LoadedParent, "Parent");
+	TestNotNull("Canonical nested UObject 1 should be restored", LoadedParent->UObjectVal1);
+	TestNotNull("Canonical nested UObject 3 should be restored", LoadedParent->UObjectVal3);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLevelSnapshot, "SPUDTest.LevelSnapshot",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestLevelSnapshot::RunTest(const FString& Parameters)
+{
+	auto AddActor = [](FSpudLevelSnapshot& Snapshot, const FString& Name, uint8 Value)
+	{
+		auto& ActorData = Snapshot.Level->LevelActors.Contents.FindOrAdd(Name);
+		ActorData.Name = Name;
+		ActorData.Properties.Data.Init(Value, 16);
+		ActorData.Properties.PropertyOffsets.Add(0);
+	};
+
+	// As the level was when loaded
+	FSpudLevelSnapshot Baseline;
+	Baseline.Reset("TestLevel");
+	AddActor(Baseline, "Door", 0);
+	AddActor(Baseline, "Chest", 0);
+
+	FSpudLevelSnapshot Snapshot;
+	Snapshot.Reset("TestLevel");
+	AddActor(Snapshot, "Door", 0);
+	AddActor(Snapshot, "Chest", 1);
+	Snapshot.Level->DestroyedActors.Add("Barrel");
+	TestEqual("Only the unchanged actor should be removed", Snapshot.RemoveUnchangedActors(Baseline), 1);
+
+	TArray<uint8> Bytes;
+	Snapshot.WriteToBuffer(Bytes);
+	FSpudLevelSnapshot Loaded;
+	TestTrue("Snapshot should read back", Loaded.ReadFromBuffer(Bytes));
+	TestEqual("Level name", Loaded.Level->Name, FString("TestLevel"));
+	TestTrue("Snapshot should be compact", Loaded.Level->Metadata.IsCompact());
+	TestNotNull("Changed actor should be present", Loaded.Level->LevelActors.Contents.Find("Chest"));
+	TestNull("Unchanged actor should not be present", Loaded.Level->LevelActors.Contents.Find("Door"));
+	TestEqual("Destroyed actors", Loaded.Level->DestroyedActors.Values.Num(), 1);
+	if (Loaded.Level->DestroyedActors.Values.Num() == 1)
+		TestEqual("Destroyed actor name", Loaded.Level->DestroyedActors.Values[0]->Name, FString("Barrel"));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBulkEntities, "SPUDTest.BulkEntities",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestBulkEntities::RunTest(const FString& Parameters)
+{
+	SpudPropertyUtil::RegisterBlittableStruct<FTestBlittableStruct>();
+
+	constexpr int32 NumEntities = 100000;
+	FSpudLevelData LevelData;
+	LevelData.Name = "BulkLevel";
+	LevelData.Status = LDS_Loaded;
+	{
+		FSpudBulkEntities Entities(LevelData.BulkEntities, LevelData.Metadata);
+		auto& Archetype = Entities.AddArchetype("Herd", NumEntities);
+		FTestBlittableStruct* Column = Entities.AddColumn<FTestBlittableStruct>(Archetype);
+		TestNotNull("Column should be added", Column);
+		TestNull("Column should only be added once", Entities.AddColumn<FTestBlittableStruct>(Archetype));
+		for (int32 i = 0; Column && i < NumEntities; ++i)
+		{
+			new (&Column[i]) FTestBlittableStruct();
+			Column[i].IntVal = i;
+			Column[i].bFlag = (i % 3) == 0;
+		}
+	}
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	FSpudChunkedDataArchive WriteAr(Writer);
+	LevelData.WriteToArchive(WriteAr);
+
+	FSpudLevelData LoadedData;
+	FMemoryReader Reader(Bytes);
+	FSpudChunkedDataArchive ReadAr(Reader);
+	LoadedData.ReadFromArchive(ReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+
+	const FSpudBulkEntities Loaded(LoadedData.BulkEntities, LoadedData.Metadata);
+	const FSpudBulkArchetypeData* Archetype = Loaded.FindArchetype("Herd");
+	TestNotNull("Archetype should be loaded", Archetype);
+	if (Archetype)
+	{
+		TArray<FTestBlittableStruct> Values;
+		TestTrue("Column should be read", Loaded.ReadColumn(*Archetype, Values));
+		TestEqual("Entity count", Values.Num(), NumEntities);
+		bool bAllMatch = Values.Num() == NumEntities;
+		for (int32 i = 0; bAllMatch && i < NumEntities; ++i)
+		{
+			bAllMatch = Values[i].IntVal == i && (bool)Values[i].bFlag == ((i % 3) == 0);
+		}
+		TestTrue("All entities should match", bAllMatch);
+	}
+
+	SpudPropertyUtil::UnregisterBlittableStruct(FTestBlittableStruct::StaticStruct());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBulkPadding, "SPUDTest.BulkPadding",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestBulkPadding::RunTest(const FString& Parameters)
+{
+	SpudPropertyUtil::RegisterBlittableStruct<FTestBlittableStruct>();
+
+	// Same field values, different garbage in the padding & unused bitfield bits
+	auto SetFields = [](FTestBlittableStruct& S, uint8 Garbage)
+	{
+		FMemory::Memset(&S, Garbage, sizeof(FTestBlittableStruct));
+		S.IntVal = 42;
+		S.FloatVal = 1.5f;
+		S.bFlag = true;
+		S.EnumVal = ETestEnum::Second;
+		S.VectorVal = FVector(1, 2, 3);
+	};
+
+	// Bulk columns are usually filled by copying whole structs
+	auto WriteColumn = [&SetFields](uint8 Garbage, TArray<uint8>& OutBytes)
+	{
+		FSpudLevelData LevelData;
+		LevelData.Name = "PaddingLevel";
+		LevelData.Status = LDS_Loaded;
+		{
+			FSpudBulkEntities Entities(LevelData.BulkEntities, LevelData.Metadata);
+			auto& Archetype = Entities.AddArchetype("Herd", 4);
+			if (FTestBlittableStruct* Column = Entities.AddColumn<FTestBlittableStruct>(Archetype))
+			{
+				for (int32 i = 0; i < 4; ++i)
+				{
+					FTestBlittableStruct S;
+					SetFields(S, Garbage);
+					FMemory::Memcpy(&Column[i], &S, sizeof(S));
+				}
+			}
+		}
+		FMemoryWriter Writer(OutBytes);
+		FSpudChunkedDataArchive WriteAr(Writer);
+		LevelData.WriteToArchive(WriteAr);
+	};
+	TArray<uint8> CleanBytes, DirtyBytes;
+	WriteColumn(0, CleanBytes);
+	WriteColumn(0xCD, DirtyBytes);
+	TestTrue("Bulk column padding should not be stored", CleanBytes == DirtyBytes);
+
+	SpudPropertyUtil::UnregisterBlittableStruct(FTestBlittableStruct::StaticStruct());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestRestoreStreamLevelBeforeVisible, "SPUDTest.RestoreStreamLevelBeforeVisible",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestRestoreStreamLevelBeforeVisible::RunTest(const FString& Parameters)
+{
+	// There's no world so the levels never really load, this checks how the load callback hands over to the restore
+	auto GameInstance = NewObject<UGameInstance>();
+	auto Subsystem = NewObject<USpudSubsystem>(GameInstance);
+	Subsystem->bRestoreStreamLevelsBeforeVisible = true;
+	auto Listener = NewObject<UTestStreamLevelListener>();
+	Subsystem->PostLoadStreamingLevel.AddDynamic(Listener, &UTestStreamLevelListener::OnPostLoadStreamingLevel);
+
+	// The latent load callback, called the same way the streaming system calls it
+	UFunction* PostLoadCallback = Subsystem->FindFunction("PostLoadStreamLevel");
+	if (!TestNotNull("Load callback should exist", PostLoadCallback))
+		return false;
+	const auto PostLoad = [Subsystem, PostLoadCallback](int32 LinkID)
+	{
+		Subsystem->ProcessEvent(PostLoadCallback, &LinkID);
+	};
+
+	// Requests are numbered from 0
+	Subsystem->AddRequestForStreamingLevel(Listener, "TestStreamLevelA", false);
+	Subsystem->AddRequestForStreamingLevel(Listener, "TestStreamLevelB", false);
+
+	// Already on the game thread, so restored straight away
+	PostLoad(0);
+	TestEqual("Restore should happen immediately on the game thread", Listener->PostLoadLevels.Num(), 1);
+
+	// From another thread it has to wait for the game thread
+	Async(EAsyncExecution::Thread, [&PostLoad]() { PostLoad(1); }).Wait();
+	TestEqual("Restore should not happen on the loading thread", Listener->PostLoadLevels.Num(), 1);
+	FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+	if (TestEqual("Restore should happen once back on the game thread", Listener->PostLoadLevels.Num(), 2))
+	{
+		TestEqual("First restored level", Listener->PostLoadLevels[0], FName("TestStreamLevelA"));
+		TestEqual("Second restored level", Listener->PostLoadLevels[1], FName("TestStreamLevelB"));
+	}
+	TestTrue("All restores should be on the game thread", Listener->bAllOnGameThread);
+
+	// Each request is only handled once
+	AddExpectedError(TEXT("not for a level we loaded"), EAutomationExpectedErrorFlags::Contains, 1);
+	PostLoad(1);
+	TestEqual("Callback for a finished request should be ignored", Listener->PostLoadLevels.Num(), 2);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestInstanceComponentData, "SPUDTest.InstanceComponentData",
+								 EAutomationTestFlags::EditorContext |
+								 EAutomationTestFlags::ClientContext |
+								 EAutomationTestFlags::ProductFilter)
+
+bool FTestInstanceComponentData::RunTest(const FString& Parameters)
+{
+	FSpudInstanceComponentData Data;
+	Data.Name = TEXT("Trees.Instances");
+	Data.NumInstances = 100;
+	Data.Removed.Init(false, Data.NumInstances);
+	// Single instances and runs, including both ends
+	for (int32 Index : { 0, 3, 4, 5, 10, 99 })
+		Data.Removed[Index] = true;
+	Data.Removed.SetRange(50, 10, true);
+	Data.Modified.Add(7, FTransform(FVector(1, 2, 3)));
+	Data.Modified.Add(20, FTransform(FRotator(0, 90, 0), FVector(4, 5, 6), FVector(2)));
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	FSpudChunkedDataArchive WriteAr(Writer);
+	Data.WriteToArchive(WriteAr);
+
+	// 16 removed instances in 5 runs should cost 4 runs more than all of them in one
+	FSpudInstanceComponentData OneRun = Data;
+	OneRun.Removed.Init(true, OneRun.NumInstances);
+	TArray<uint8> OneRunBytes;
+	FMemoryWriter OneRunWriter(OneRunBytes);
+	FSpudChunkedDataArchive OneRunAr(OneRunWriter);
+	OneRun.WriteToArchive(OneRunAr);
+	TestEqual("Removed instances should be stored as runs", Bytes.Num() - OneRunBytes.Num(),
+	          4 * 2 * static_cast<int32>(sizeof(int32)));
+
+	FSpudInstanceComponentData Loaded;
+	FMemoryReader Reader(Bytes);
+	FSpudChunkedDataArchive ReadAr(Reader);
+	Loaded.ReadFromArchive(ReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestFalse("Read should succeed", ReadAr.IsError());
+	TestEqual("Name", Loaded.Name, Data.Name);
+	TestEqual("Instance count", Loaded.NumInstances, Data.NumInstances);
+	TestTrue("Removed instances should match", Loaded.Removed == Data.Removed);
+	TestEqual("Modified count", Loaded.Modified.Num(), Data.Modified.Num());
+	for (auto&& Mod : Data.Modified)
+	{
+		const FTransform* LoadedXForm = Loaded.Modified.Find(Mod.Key);
+		if (TestNotNull(FString::Printf(TEXT("Modified instance %d"), Mod.Key), LoadedXForm))
+			TestTrue(FString::Printf(TEXT("Modified instance %d transform"), Mod.Key), LoadedXForm->Equals(Mod.Value));
+	}
+
+	// Indexes outside the instances the component had must not get through
+	Data.Modified.Add(100, FTransform::Identity);
+	Data.Modified.Add(-1, FTransform::Identity);
+	Bytes.Empty();
+	FMemoryWriter BadWriter(Bytes);
+	FSpudChunkedDataArchive BadWriteAr(BadWriter);
+	Data.WriteToArchive(BadWriteAr);
+	AddExpectedError(TEXT("is out of range"), EAutomationExpectedErrorFlags::Contains, 2);
+	FMemoryReader BadReader(Bytes);
+	FSpudChunkedDataArchive BadReadAr(BadReader);
+	Loaded.ReadFromArchive(BadReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Out of range modified instances should be dropped", Loaded.Modified.Num(), 2);
+	TestFalse("Out of range modified instance should be dropped", Loaded.Modified.Contains(100));
+
+	// A removed run whose end overflows, and an instance count too large to allocate
+	const auto WriteCorrupt = [](FSpudInstanceComponentData& Source, int32 LastRunCount)
+	{
+		TArray<uint8> Out;
+		FMemoryWriter CorruptWriter(Out);
+		FSpudChunkedDataArchive CorruptAr(CorruptWriter);
+		Source.WriteToArchive(CorruptAr);
+		// The last run's count is followed only by the modified count, which is zero
+		if (LastRunCount)
+			FMemory::Memcpy(Out.GetData() + Out.Num() - 2 * static_cast<int32>(sizeof(int32)), &LastRunCount, sizeof(int32));
+		return Out;
+	};
+	FSpudInstanceComponentData Corrupt;
+	Corrupt.Name = Data.Name;
+	Corrupt.NumInstances = 100;
+	Corrupt.Removed.Init(false, Corrupt.NumInstances);
+	Corrupt.Removed[99] = true;
+	AddExpectedError(TEXT("are out of range"), EAutomationExpectedErrorFlags::Contains, 1);
+	Bytes = WriteCorrupt(Corrupt, MAX_int32);
+	FMemoryReader OverflowReader(Bytes);
+	FSpudChunkedDataArchive OverflowAr(OverflowReader);
+	Loaded.ReadFromArchive(OverflowAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Overflowing removed run should be dropped", Loaded.Removed.CountSetBits(), 0);
+
+	Corrupt.NumInstances = FSpudInstanceComponentData::MaxInstances + 1;
+	Corrupt.Removed.Empty();
+	AddExpectedError(TEXT("Instance count"), EAutomationExpectedErrorFlags::Contains, 1);
+	Bytes = WriteCorrupt(Corrupt, 0);
+	FMemoryReader HugeReader(Bytes);
+	FSpudChunkedDataArchive HugeAr(HugeReader);
+	Loaded.ReadFromArchive(HugeAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Corrupt instance count should be ignored", Loaded.NumInstances, 0);
+	TestEqual("Nothing should be allocated for a corrupt instance count", Loaded.Removed.Num(), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLoadInPlace, "SPUDTest.LoadInPlace",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestLoadInPlace::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	auto Kept = TestWorld.Spawn<ATestSaveActor>("KeptActor", true);
+	auto Destroyed = TestWorld.Spawn<ATestSaveActor>("DestroyedActor", true);
+	auto Spawned = TestWorld.Spawn<ATestSaveActor>(NAME_None, false);
+	Kept->IntVal = 1;
+	Destroyed->IntVal = 2;
+	Spawned->IntVal = 3;
+
+	auto State = NewObject<USpudState>();
+	State->StoreLevel(World->PersistentLevel, false, true);
+	// As if it had been destroyed in the game being loaded
+	State->StoreLevelActorDestroyed(Destroyed);
+	// Runtime actors get their identity when stored
+	const FGuid SpawnedGuid = Spawned->SpudGuid;
+
+	// Play on a bit
+	Kept->IntVal = 10;
+	Spawned->IntVal = 30;
+	auto Extra = TestWorld.Spawn<ATestSaveActor>(NAME_None, false);
+	Extra->IntVal = 40;
+
+	if (!TestTrue("World should be restorable in place", State->CanRestoreLoadedWorldInPlace(World)))
+		return false;
+	State->ResetLoadedWorldForInPlaceRestore(World);
+	State->RestoreLoadedWorld(World);
+
+	TestEqual("Level actor should be restored", Kept->IntVal, 1);
+	TestFalse("Level actor destroyed in the save should be destroyed", IsValid(Destroyed));
+	TestFalse("Runtime actor should be replaced", IsValid(Spawned));
+	TestFalse("Runtime actor spawned after the save should be removed", IsValid(Extra));
+	const auto Respawned = TestWorld.GetActors<ATestSaveActor>({ Kept });
+	if (TestEqual("Only the saved runtime actor should be respawned", Respawned.Num(), 1))
+	{
+		TestEqual("Respawned actor should be restored", Respawned[0]->IntVal, 3);
+		TestEqual("Respawned actor should keep its identity", Respawned[0]->SpudGuid, SpawnedGuid);
+	}
+
+	// A level actor the save has state for can't be brought back without a reload
+	Kept->Destroy();
+	TestFalse("Missing level actor should need a reload", State->CanRestoreLoadedWorldInPlace(World));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestActorPool, "SPUDTest.ActorPool",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestActorPool::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+	ULevel* StreamLevel = TestWorld.AddLevel(TEXT("SpudTestStreamLevel"));
+	const FString LevelName = USpudState::GetLevelName(StreamLevel);
+
+	auto Original = TestWorld.Spawn<ATestPooledActor>(NAME_None, false, StreamLevel);
+	Original->IntVal = 5;
+	auto State = NewObject<USpudState>();
+	State->StoreLevel(StreamLevel, false, true);
+	// Unloading the level takes the actors placed in it along with it
+	Original->Destroy();
+
+	// Loading it again respawns the actor, into the persistent level so that it can outlive the streaming level
+	State->RestoreLevel(StreamLevel);
+	auto Actors = TestWorld.GetActors<ATestPooledActor>();
+	if (!TestEqual("Actor should be respawned", Actors.Num(), 1))
+		return false;
+	ATestPooledActor* Pooled = Actors[0];
+	TestEqual("Respawned actor should be restored", Pooled->IntVal, 5);
+	TestEqual("Respawned actor should be in the persistent level", Pooled->GetLevel(), World->PersistentLevel);
+
+	// Unload again, which returns it to the pool
+	Pooled->IntVal = 6;
+	State->StoreLevel(StreamLevel, false, true);
+	State->ReturnPooledActors(LevelName);
+	if (!TestTrue("Pooled actor should be kept", IsValid(Pooled)))
+		return false;
+	TestTrue("Pooled actor should be hidden", Pooled->IsHidden());
+	TestFalse("Pooled actor shouldn't tick", Pooled->IsActorTickEnabled());
+	TestFalse("Pooled actor's components shouldn't tick", Pooled->TickComponent->IsComponentTickEnabled());
+
+	// Reloading reuses it
+	State->RestoreLevel(StreamLevel);
+	Actors = TestWorld.GetActors<ATestPooledActor>();
+	if (TestEqual("Only one actor should exist", Actors.Num(), 1))
+		TestTrue("Pooled actor should be reused", Actors[0] == Pooled);
+	TestEqual("Reused actor should be restored", Pooled->IntVal, 6);
+	TestFalse("Reused actor should be visible", Pooled->IsHidden());
+	TestTrue("Reused actor should tick", Pooled->IsActorTickEnabled());
+	TestTrue("Reused actor's components should tick", Pooled->TickComponent->IsComponentTickEnabled());
+
+	// Resetting the state, e.g. to load a game, destroys idle actors rather than keeping them for the next world
+	State->ReturnPooledActors(LevelName);
+	State->ResetState();
+	TestFalse("Idle pooled actors should be destroyed on reset", IsValid(Pooled));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLoadInPlaceInstances, "SPUDTest.LoadInPlaceInstances",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestLoadInPlaceInstances::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	auto Trees = TestWorld.Spawn<ATestInstancesActor>("Trees", true);
+	UInstancedStaticMeshComponent* Instances = Trees->Instances;
+	for (int i = 0; i < 10; ++i)
+		Instances->AddInstance(FTransform(FVector(i * 100, 0, 0)));
+	auto IsHidden = [Instances](int32 Index)
+	{
+		FTransform XForm;
+		Instances->GetInstanceTransform(Index, XForm);
+		return XForm.GetScale3D().IsZero();
+	};
+
+	auto State = NewObject<USpudState>();
+	State->RemoveInstances(Instances, { 2 });
+	State->StoreLevel(World->PersistentLevel, false, true);
+	TArray<uint8> SaveBytes;
+	FMemoryWriter Writer(SaveBytes);
+	State->SaveToArchive(Writer);
+
+	// Play on a bit
+	State->RemoveInstances(Instances, { 5 });
+	State->SetInstanceTransform(Instances, 7, FTransform(FVector(0, 0, 500)));
+
+	// Load the save back in place, as the subsystem does
+	State->ResetState();
+	FMemoryReader Reader(SaveBytes);
+	State->LoadFromArchive(Reader, true);
+	State->ResetLoadedWorldForInPlaceRestore(World);
+	State->RestoreLoadedWorld(World);
+
+	TestTrue("Instance removed in the save should be hidden", IsHidden(2));
+	TestFalse("Instance removed after the save should be shown again", IsHidden(5));
+	FTransform XForm;
+	Instances->GetInstanceTransform(5, XForm);
+	TestTrue("Instance removed after the save should be back where it was", XForm.Equals(FTransform(FVector(500, 0, 0))));
+	Instances->GetInstanceTransform(7, XForm);
+	TestTrue("Instance moved after the save should be back where it was", XForm.Equals(FTransform(FVector(700, 0, 0))));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestComponentTable, "SPUDTest.ComponentTable",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestComponentTable::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	auto Actor = TestWorld.Spawn<ATestComponentsActor>("ComponentsActor", true);
+	Actor->First->IntVal = 1;
+	Actor->Second->IntVal = 2;
+
+	auto State = NewObject<USpudState>();
+	State->StoreLevel(World->PersistentLevel, false, true);
+	TArray<uint8> SaveBytes;
+	FMemoryWriter Writer(SaveBytes);
+	State->SaveToArchive(Writer);
+
+	auto LoadedState = NewObject<USpudState>();
+	FMemoryReader Reader(SaveBytes);
+	LoadedState->LoadFromArchive(Reader, true);
+	auto LevelData = LoadedState->SaveData.GetLevelData(USpudState::GetLevelName(World->PersistentLevel), false, FString());
+	if (!TestTrue("Level data should be loaded", LevelData.IsValid()))
+		return false;
+	auto ActorData = LevelData->LevelActors.Contents.Find(SpudPropertyUtil::GetLevelActorName(Actor));
+	if (!TestNotNull("Actor data should be loaded", ActorData))
+		return false;
+	auto& Components = ActorData->Components.Components;
+	if (!TestEqual("Both components should be stored", Components.Num(), 2))
+		return false;
+	// Components are found by name, not by position
+	Swap(Components[0], Components[1]);
+
+	Actor->First->IntVal = 0;
+	Actor->Second->IntVal = 0;
+	LoadedState->RestoreLevel(World->PersistentLevel);
+	TestEqual("First component should be restored", Actor->First->IntVal, 1);
+	TestEqual("Second component should be restored", Actor->Second->IntVal, 2);
+
+	// A corrupt count mustn't be trusted
+	TArray<uint8> TableBytes;
+	FMemoryWriter TableWriter(TableBytes);
+	FSpudChunkedDataArchive TableWriteAr(TableWriter);
+	ActorData->Components.WriteToArchive(TableWriteAr);
+	const int32 HugeNum = 100000000;
+	FMemory::Memcpy(TableBytes.GetData() + FSpudChunkHeader::GetHeaderSize(), &HugeNum, sizeof(int32));
+	AddExpectedError(TEXT("Component table is corrupt"), EAutomationExpectedErrorFlags::Contains, 1);
+	FSpudComponentTable CorruptTable;
+	FMemoryReader TableReader(TableBytes);
+	FSpudChunkedDataArchive TableReadAr(TableReader);
+	CorruptTable.ReadFromArchive(TableReadAr, SPUD_CURRENT_SYSTEM_VERSION);
+	TestEqual("Corrupt component table should be empty", CorruptTable.Components.Num(), 0);
+	TestEqual("Corrupt component table should still be skipped", TableReader.Tell(), static_cast<int64>(TableBytes.Num()));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestRestoreAsleep, "SPUDTest.RestoreAsleep",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestRestoreAsleep::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+
+	auto Resting = TestWorld.Spawn<ATestPhysicsActor>("RestingActor", true);
+	auto Moving = TestWorld.Spawn<ATestPhysicsActor>("MovingActor", true);
+	if (!TestTrue("Bodies should be created", Resting->Sphere->IsPhysicsStateCreated() && Moving->Sphere->IsPhysicsStateCreated()))
+		return false;
+	Resting->Sphere->PutAllRigidBodiesToSleep();
+	Moving->Sphere->WakeAllRigidBodies();
+
+	auto State = NewObject<USpudState>();
+	State->StoreLevel(World->PersistentLevel, false, true);
+	TArray<uint8> SaveBytes;
+	FMemoryWriter Writer(SaveBytes);
+	State->SaveToArchive(Writer);
+	auto LoadedState = NewObject<USpudState>();
+	FMemoryReader Reader(SaveBytes);
+	LoadedState->LoadFromArchive(Reader, true);
+
+	Resting->Sphere->WakeAllRigidBodies();
+	LoadedState->RestoreLevel(World->PersistentLevel);
+	TestFalse("Body asleep when stored should be asleep", Resting->Sphere->RigidBodyIsAwake());
+	TestTrue("Body awake when stored should be awake", Moving->Sphere->RigidBodyIsAwake());
+	// The setting would otherwise carry over to the actor's next body, e.g. if it's pooled
+	TestTrue("Component should still start awake", Resting->Sphere->BodyInstance.bStartAwake);
+
+	// Before the level is visible, sleeping is held back along with velocities
+	Resting->Sphere->WakeAllRigidBodies();
+	LoadedState->RestoreLevelBeforeVisible(World->PersistentLevel);
+	TestTrue("Sleep should be deferred", LoadedState->HasDeferredVelocities(World->PersistentLevel));
+	LoadedState->ApplyDeferredVelocities(World->PersistentLevel);
+	TestFalse("Body asleep when stored should be asleep after deferred restore", Resting->Sphere->RigidBodyIsAwake());
+	TestTrue("Component should still start awake after deferred restore", Resting->Sphere->BodyInstance.bStartAwake);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestBufferDestroyedActors, "SPUDTest.BufferDestroyedActors",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestBufferDestroyedActors::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	UWorld* World = TestWorld.World;
+	ULevel* StreamLevel = TestWorld.AddLevel(TEXT("SpudTestDestroyLevel"));
+	const FString PersistentName = USpudState::GetLevelName(World->PersistentLevel);
+	const FString StreamName = USpudState::GetLevelName(StreamLevel);
+
+	auto First = TestWorld.Spawn<ATestSaveActor>("FirstActor", true);
+	auto Second = TestWorld.Spawn<ATestSaveActor>("SecondActor", true);
+	auto Streamed = TestWorld.Spawn<ATestSaveActor>("StreamedActor", true, StreamLevel);
+	auto Kept = TestWorld.Spawn<ATestSaveActor>("KeptActor", true);
+
+	auto State = NewObject<USpudState>();
+	State->StoreLevel(World->PersistentLevel, false, true);
+	auto GetDestroyed = [State](const FString& LevelName)
+	{
+		TArray<FString> Names;
+		if (auto LevelData = State->SaveData.GetLevelData(LevelName, false, FString()))
+		{
+			for (auto&& Destroyed : LevelData->DestroyedActors.Values)
+				Names.Add(Destroyed->Name);
+		}
+		return Names;
+	};
+
+	State->BufferLevelActorDestroyed(First);
+	State->BufferLevelActorDestroyed(Streamed);
+	State->BufferLevelActorDestroyed(Second);
+	TestEqual("Buffered actors shouldn't be added to their level yet", GetDestroyed(PersistentName).Num(), 0);
+	TestEqual("Buffered actors shouldn't create level data", GetDestroyed(StreamName).Num(), 0);
+
+	// Storing a level adds everything buffered first, including for other levels
+	First->Destroy();
+	Second->Destroy();
+	Streamed->Destroy();
+	State->StoreLevel(World->PersistentLevel, false, true);
+	const TArray<FString> PersistentDestroyed = GetDestroyed(PersistentName);
+	TestEqual("Both persistent level actors should be destroyed", PersistentDestroyed.Num(), 2);
+	TestTrue("First actor should be destroyed", PersistentDestroyed.Contains(TEXT("FirstActor")));
+	TestTrue("Second actor should be destroyed", PersistentDestroyed.Contains(TEXT("SecondActor")));
+	const TArray<FString> StreamDestroyed = GetDestroyed(StreamName);
+	if (TestEqual("Streaming level actor should be destroyed in its own level", StreamDestroyed.Num(), 1))
+		TestEqual("Streaming level actor name", StreamDestroyed[0], FString(TEXT("StreamedActor")));
+
+	// An explicit flush works too, and flushing twice adds nothing more
+	State->BufferLevelActorDestroyed(Kept);
+	State->FlushDestroyedActors();
+	State->FlushDestroyedActors();
+	TestEqual("Flushed actor should be destroyed", GetDestroyed(PersistentName).Num(), 3);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestSaveGlobals, "SPUDTest.SaveGlobals",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestSaveGlobals::RunTest(const FString& Parameters)
+{
+	const FDateTime FullSaveTime(2024, 1, 1, 12, 0, 0);
+	auto Obj = NewObject<UTestSaveObjectBasic>();
+	Obj->IntVal = 1;
+	auto State = NewObject<USpudState>();
+	State->SaveData.GlobalData.CurrentLevel = TEXT("FullSaveLevel");
+	State->SetTimestamp(FullSaveTime);
+	State->StoreGlobalObject(Obj, "TestObject");
+	TArray<uint8> FullBytes;
+	FMemoryWriter FullWriter(FullBytes);
+	State->SaveToArchive(FullWriter);
+
+	// Carry on playing, then save just the globals
+	Obj->IntVal = 2;
+	State->SaveData.GlobalData.CurrentLevel = TEXT("LaterLevel");
+	State->StoreGlobalObject(Obj, "TestObject");
+	const auto SaveGlobals = [State](const FDateTime& Timestamp)
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Writer(Bytes);
+		State->SaveGlobalsToArchive(Writer, Timestamp);
+		return Bytes;
+	};
+	const TArray<uint8> NewerBytes = SaveGlobals(FullSaveTime + FTimespan::FromMinutes(1));
+	const TArray<uint8> OlderBytes = SaveGlobals(FullSaveTime - FTimespan::FromMinutes(1));
+	TestEqual("Saving globals shouldn't change the state's timestamp", State->GetTimestamp(), FullSaveTime);
+
+	const auto LoadWithGlobals = [this, &FullBytes](const TArray<uint8>& GlobalsBytes, bool& bOutReplaced)
+	{
+		auto Loaded = NewObject<USpudState>();
+		FMemoryReader FullReader(FullBytes);
+		Loaded->LoadFromArchive(FullReader, true);
+		FMemoryReader GlobalsReader(GlobalsBytes);
+		bOutReplaced = Loaded->LoadGlobalsFromArchive(GlobalsReader);
+		TestFalse("Globals should be read without error", GlobalsReader.IsError());
+		return Loaded;
+	};
+
+	bool bReplaced = false;
+	auto Loaded = LoadWithGlobals(NewerBytes, bReplaced);
+	TestTrue("Newer globals should replace those in the full save", bReplaced);
+	auto Restored = NewObject<UTestSaveObjectBasic>();
+	Loaded->RestoreGlobalObject(Restored, "TestObject");
+	TestEqual("Globals should be restored from the globals save", Restored->IntVal, 2);
+	TestEqual("Current level should still be that of the full save", Loaded->SaveData.GlobalData.CurrentLevel,
+	          FString(TEXT("FullSaveLevel")));
+	TestEqual("Loaded timestamp should be that of the full save", Loaded->GetTimestamp(), FullSaveTime);
+
+	Loaded = LoadWithGlobals(OlderBytes, bReplaced);
+	TestFalse("Older globals should be ignored", bReplaced);
+	Restored = NewObject<UTestSaveObjectBasic>();
+	Loaded->RestoreGlobalObject(Restored, "TestObject");
+	TestEqual("Globals should be restored from the full save", Restored->IntVal, 1);
+
+	// Through the subsystem, which writes the file in the background
+	const FString SlotName = TEXT("SpudTestGlobals");
+	const FString GlobalsFilename = USpudSubsystem::GetGlobalsSaveFilePath(SlotName);
+	IFileManager& FileMgr = IFileManager::Get();
+	FileMgr.Delete(*GlobalsFilename, false, true, true);
+	auto GameInstance = NewObject<UGameInstance>();
+	auto Subsystem = NewObject<USpudSubsystem>(GameInstance);
+	Obj->IntVal = 3;
+	Subsystem->AddPersistentGlobalObjectWithName(Obj, "TestObject");
+	if (!TestTrue("Globals save should be queued", Subsystem->SaveGlobals(SlotName)))
+		return false;
+	const double Timeout = FPlatformTime::Seconds() + 10.0;
+	while (!FileMgr.FileExists(*GlobalsFilename) && FPlatformTime::Seconds() < Timeout)
+		FPlatformProcess::Sleep(0.01f);
+	TArray<uint8> SubsystemBytes;
+	if (TestTrue("Globals file should be written", FFileHelper::LoadFileToArray(SubsystemBytes, *GlobalsFilename)))
+	{
+		Loaded = LoadWithGlobals(SubsystemBytes, bReplaced);
+		TestTrue("Globals saved now should be newer than the full save", bReplaced);
+		Restored = NewObject<UTestSaveObjectBasic>();
+		Loaded->RestoreGlobalObject(Restored, "TestObject");
+		TestEqual("Globals saved by the subsystem should be restored", Restored->IntVal, 3);
+	}
+	FileMgr.Delete(*GlobalsFilename, false, true, true);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLoadTelemetry, "SPUDTest.LoadTelemetry",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestLoadTelemetry::RunTest(const FString& Parameters)
+{
+	const FDateTime FullSaveTime(2024, 1, 1, 12, 0, 0);
+	auto Obj = NewObject<UTestSaveObjectBasic>();
+	auto State = NewObject<USpudState>();
+	State->SetTimestamp(FullSaveTime);
+	State->StoreGlobalObject(Obj, "TestObject");
+	PopulateTestLevelData(State->SaveData, "TelemetryLevel");
+	TArray<uint8> FullBytes;
+	FMemoryWriter FullWriter(FullBytes);
+	State->SaveToArchive(FullWriter);
+
+	FSpudOperationTelemetry Telemetry;
+	auto Loaded = NewObject<USpudState>();
+	Loaded->Telemetry = &Telemetry;
+	FMemoryReader FullReader(FullBytes);
+	Loaded->LoadFromArchive(FullReader, false);
+	TestTrue("Loading should count the bytes read", Telemetry.BytesRead > 0);
+
+	// Level data was copied out to its own file, reading it back is extra
+	const int64 AfterLoad = Telemetry.BytesRead;
+	TestTrue("Level data should be paged in", Loaded->GetLevelData("TelemetryLevel", false).IsValid());
+	const int64 LevelBytes = Telemetry.BytesRead - AfterLoad;
+	TestTrue("Paging in level data should count the bytes read", LevelBytes > 0);
+	Loaded->GetLevelData("TelemetryLevel", false);
+	TestEqual("Level data already in memory shouldn't be counted again", Telemetry.BytesRead, AfterLoad + LevelBytes);
+
+	// An older globals save is only read as far as its info
+	const auto LoadGlobals = [this, State, Loaded, &Telemetry](const FDateTime& Timestamp, int64& OutFileSize)
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Writer(Bytes);
+		State->SaveGlobalsToArchive(Writer, Timestamp);
+		OutFileSize = Bytes.Num();
+		const int64 Before = Telemetry.BytesRead;
+		FMemoryReader Reader(Bytes);
+		Loaded->LoadGlobalsFromArchive(Reader);
+		TestFalse("Globals should be read without error", Reader.IsError());
+		return Telemetry.BytesRead - Before;
+	};
+	int64 OlderSize = 0, NewerSize = 0;
+	const int64 OlderRead = LoadGlobals(FullSaveTime - FTimespan::FromMinutes(1), OlderSize);
+	const int64 NewerRead = LoadGlobals(FullSaveTime + FTimespan::FromMinutes(1), NewerSize);
+	TestTrue("Ignored globals data shouldn't be counted", OlderRead > 0 && OlderRead < OlderSize);
+	TestTrue("Used globals data should be counted", NewerRead > OlderRead);
+
+	Loaded->Telemetry = nullptr;
+	Loaded->RemoveAllActiveGameLevelFiles();
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTestLevelSnapshotActors, "SPUDTest.LevelSnapshotActors",
+	EAutomationTestFlags::EditorContext |
+	EAutomationTestFlags::ClientContext |
+	EAutomationTestFlags::ProductFilter)
+
+bool FTestLevelSnapshotActors::RunTest(const FString& Parameters)
+{
+	FSpudTestWorld TestWorld;
+	ULevel* ServerLevel = TestWorld.AddLevel(TEXT("SpudTestSnapshotLevel"));
+	ULevel* ClientLevel = TestWorld.AddLevel(TEXT("SpudTestSnapshotLevel"));
+	if (!TestEqual("Both instances should be the same level", USpudState::GetLevelName(ClientLevel),
+	               USpudState::GetLevelName(ServerLevel)))
+		return false;
+
+	auto ServerChanged = TestWorld.Spawn<ATestSaveActor>("ChangedActor", true, ServerLevel);
+	TestWorld.Spawn<ATestSaveActor>("UnchangedActor", true, ServerLevel);
+	auto ServerDestroyed = TestWorld.Spawn<ATestSaveActor>("DestroyedActor", true, ServerLevel);
+	auto ClientChanged = TestWorld.Spawn<ATestSaveActor>("ChangedActor", true, ClientLevel);
+	auto ClientUnchanged = TestWorld.Spawn<ATestSaveActor>("UnchangedActor", true, ClientLevel);
+	auto ClientDestroyed = TestWorld.Spawn<ATestSaveActor>("DestroyedActor", true, ClientLevel);
+
+	auto ServerState = NewObject<USpudState>();
+	FSpudLevelSnapshot Baseline;
+	ServerState->StoreLevelSnapshot(ServerLevel, Baseline);
+
+	// Play on the server
+	ServerChanged->IntVal = 42;
+	ServerChanged->StringVal = TEXT("Changed on the server");
+	ServerState->StoreLevelActorDestroyed(ServerDestroyed);
+	ServerDestroyed->Destroy();
+	auto ServerSpawned = TestWorld.Spawn<ATestSaveActor>(NAME_None, false, ServerLevel);
+	ServerSpawned->IntVal = 7;
+
+	FSpudLevelSnapshot Snapshot;
+	ServerState->StoreLevelSnapshot(ServerLevel, Snapshot, &Baseline);
+	TestEqual("Only the changed placed actor should be in the snapshot", Snapshot.Level->LevelActors.Contents.Num(), 1);
+	TestEqual("Runtime actors shouldn't be in the snapshot", Snapshot.Level->SpawnedActors.Contents.Num(), 0);
+	TArray<uint8> Data;
+	Snapshot.WriteToBuffer(Data);
+
+	// A late-joining client, which only has what was in the level when it loaded
+	ClientUnchanged->IntVal = -1;
+	auto ClientState = NewObject<USpudState>();
+	if (!TestTrue("Snapshot should restore to the client's level", ClientState->RestoreLevelSnapshot(ClientLevel, Data)))
+		return false;
+
+	TestEqual("Changed actor should be restored", ClientChanged->IntVal, 42);
+	TestEqual("Changed actor string should be restored", ClientChanged->StringVal, ServerChanged->StringVal);
+	TestEqual("Unchanged actor should be left alone", ClientUnchanged->IntVal, -1);
+	TestFalse("Actor destroyed on the server should be destroyed", IsValid(ClientDestroyed));
+	TestTrue("Server's actor should be untouched", IsValid(ServerChanged));
+	TestFalse("Restoring shouldn't add level data to the client state",
+	          ClientState->SaveData.GetLevelData(USpudState::GetLevelName(ClientLevel), false, FString()).IsValid());
+
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+/// A game world for tests which need actors, torn down when it goes out of scope
+struct FSpudTestWorld
+{
+	UWorld* World;
+
+	FSpudTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("SpudTestWorld"));
+		FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+		Context.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FSpudTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	/// Add a level standing in for a streaming level. It has its own package, so SPUD knows it by Name. Levels added
+	/// with the same Name are instances of the same level, like a server's and a client's copy
+	ULevel* AddLevel(const FString& Name)
+	{
+		UPackage* Package = CreatePackage(*(TEXT("/Temp/") + Name));
+		ULevel* Level = NewObject<ULevel>(Package, MakeUniqueObjectName(Package, ULevel::StaticClass(), TEXT("PersistentLevel")));
+		Level->OwningWorld = World;
+		World->AddLevel(Level);
+		return Level;
+	}
+
+	/// Spawn an actor as if it had been placed in the level (so it's identified by name), or spawned at runtime.
+	/// Spawns in the persistent level unless another is given
+	template <typename T>
+	T* Spawn(FName Name, bool bPlaced, ULevel* Level = nullptr)
+	{
+		FActorSpawnParameters Params;
+		Params.Name = Name;
+		Params.OverrideLevel = Level;
+		T* Actor = World->SpawnActor<T>(Params);
+		if (Actor && bPlaced)
+			Actor->SetFlags(RF_WasLoaded);
+		return Actor;
+	}
+
+	/// Live actors of a class in the world, other than those given
+	template <typename T>
+	TArray<T*> GetActors(const TArray<T*>& Except = TArray<T*>())
+	{
+		TArray<T*> Ret;
+		for (TActorIterator<T> It(World); It; ++It)
+		{
+			if (!Except.Contains(*It))
+				Ret.Add(*It);
+		}
+		return Ret;
+	}
+};
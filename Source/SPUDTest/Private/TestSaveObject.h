@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "ISpudObject.h"
+#include "SpudHelpers.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SphereComponent.h"
 #include "UObject/Object.h"
 #include "TestSaveObject.generated.h"
 
@@ -129,7 +132,7 @@ public:
 	UPROPERTY(SaveGame)
 	TArray<FText> TextArray;
 
-	// Arrays of custom structs or UObjects are not supported yet
+	// Arrays of UObjects are not supported yet, nor arrays of this struct since it contains FText & UObjects
 };
 
 // Test 2-level nesting
@@ -260,6 +263,122 @@ public:
 
 };
 
+/// Plain data struct, registered as blittable by tests
+USTRUCT(BlueprintType)
+struct FTestBlittableStruct
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	int32 IntVal = 0;
+
+	UPROPERTY(SaveGame)
+	float FloatVal = 0;
+
+	UPROPERTY(SaveGame)
+	uint8 bFlag : 1;
+
+	UPROPERTY(SaveGame)
+	ETestEnum EnumVal = ETestEnum::First;
+
+	UPROPERTY(SaveGame)
+	FVector VectorVal = FVector::ZeroVector;
+
+	FTestBlittableStruct() : bFlag(false) {}
+};
+
+UCLASS()
+class SPUDTEST_API UTestSaveObjectBlittable : public UObject
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	FTestBlittableStruct SingleStruct;
+
+	UPROPERTY(SaveGame)
+	TArray<FTestBlittableStruct> StructArray;
+
+	UPROPERTY(SaveGame)
+	int AfterStructVal;
+};
+
+/// Custom struct with strings, stored in columns when in an array
+USTRUCT(BlueprintType)
+struct FTestColumnarStruct
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	FString Name;
+
+	UPROPERTY(SaveGame)
+	FName Tag;
+
+	UPROPERTY(SaveGame)
+	int32 Count = 0;
+
+	UPROPERTY(SaveGame)
+	bool bEquipped = false;
+
+	UPROPERTY(SaveGame)
+	ETestEnum EnumVal = ETestEnum::First;
+
+	UPROPERTY(SaveGame)
+	FVector Location = FVector::ZeroVector;
+};
+
+UCLASS()
+class SPUDTEST_API UTestSaveObjectColumnar : public UObject
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	TArray<FTestColumnarStruct> Items;
+
+	UPROPERTY(SaveGame)
+	int AfterArrayVal;
+};
+
+UCLASS()
+class SPUDTEST_API UTestSaveObjectSharedNested : public UObject
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	UTestNestedUObject* First = nullptr;
+
+	UPROPERTY(SaveGame)
+	UTestNestedUObject* Second = nullptr;
+
+	UPROPERTY(SaveGame)
+	int AfterNestedVal;
+};
+
+UCLASS()
+class SPUDTEST_API UTestSaveObjectCompiled : public UObject
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	int IntVal;
+	UPROPERTY(SaveGame)
+	float FloatVal;
+	UPROPERTY(SaveGame)
+	bool bBoolVal;
+	UPROPERTY(SaveGame)
+	FString StringVal;
+	UPROPERTY(SaveGame)
+	ETestEnum EnumVal;
+	UPROPERTY(SaveGame)
+	FVector VectorVal;
+	UPROPERTY(SaveGame)
+	TArray<int> IntArray;
+	UPROPERTY(SaveGame)
+	TArray<bool> BoolArray;
+};
+
 UCLASS()
 class SPUDTEST_API UTestSaveObjectCustomData : public UObject, public ISpudObjectCallback
 {
@@ -355,3 +474,128 @@ public:
 	UPROPERTY(SaveGame)
 	UTestNestedChild5* UObjectVal5;
 };
+
+/// Records the streaming level events it's bound to, and whether they all happened on the game thread
+UCLASS()
+class SPUDTEST_API UTestStreamLevelListener : public UObject
+{
+	GENERATED_BODY()
+public:
+	TArray<FName> PostLoadLevels;
+	bool bAllOnGameThread = true;
+
+	UFUNCTION()
+	void OnPostLoadStreamingLevel(const FName& LevelName)
+	{
+		PostLoadLevels.Add(LevelName);
+		bAllOnGameThread = bAllOnGameThread && IsInGameThread();
+	}
+};
+
+/// Actor for tests which need a world. Spawned as a level actor or a runtime actor depending on the test
+UCLASS()
+class SPUDTEST_API ATestSaveActor : public ASpudActorBase
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	int IntVal = 0;
+
+	UPROPERTY(SaveGame)
+	FString StringVal;
+};
+
+UCLASS()
+class SPUDTEST_API UTestTickComponent : public UActorComponent
+{
+	GENERATED_BODY()
+public:
+	UTestTickComponent()
+	{
+		PrimaryComponentTick.bCanEverTick = true;
+		PrimaryComponentTick.bStartWithTickEnabled = true;
+	}
+};
+
+/// Runtime actor which is pooled when its streaming level unloads, rather than destroyed
+UCLASS()
+class SPUDTEST_API ATestPooledActor : public ATestSaveActor
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	UTestTickComponent* TickComponent;
+
+	ATestPooledActor()
+	{
+		PrimaryActorTick.bCanEverTick = true;
+		PrimaryActorTick.bStartWithTickEnabled = true;
+		TickComponent = CreateDefaultSubobject<UTestTickComponent>(TEXT("TickComponent"));
+	}
+
+	virtual bool ShouldPoolOnRespawn_Implementation() const override { return true; }
+};
+
+/// Level actor with instances which can be removed / moved through SPUD, like foliage
+UCLASS()
+class SPUDTEST_API ATestInstancesActor : public ASpudActorBase
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Instances;
+
+	ATestInstancesActor()
+	{
+		Instances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("Instances"));
+		RootComponent = Instances;
+	}
+};
+
+UCLASS()
+class SPUDTEST_API UTestSaveComponent : public UActorComponent
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	int IntVal = 0;
+};
+
+/// Level actor which stores the state of its components along with its own
+UCLASS()
+class SPUDTEST_API ATestComponentsActor : public ASpudActorBase
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	UTestSaveComponent* First;
+	UPROPERTY()
+	UTestSaveComponent* Second;
+
+	ATestComponentsActor()
+	{
+		First = CreateDefaultSubobject<UTestSaveComponent>(TEXT("First"));
+		Second = CreateDefaultSubobject<UTestSaveComponent>(TEXT("Second"));
+	}
+
+	virtual bool ShouldStoreComponents_Implementation() const override { return true; }
+};
+
+/// Level actor with a simulated physics body
+UCLASS()
+class SPUDTEST_API ATestPhysicsActor : public ASpudActorBase
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	USphereComponent* Sphere;
+
+	ATestPhysicsActor()
+	{
+		Sphere = CreateDefaultSubobject<USphereComponent>(TEXT("Sphere"));
+		Sphere->SetMobility(EComponentMobility::Movable);
+		Sphere->SetCollisionProfileName(UCollisionProfile::PhysicsActor_ProfileName);
+		Sphere->BodyInstance.bSimulatePhysics = true;
+		RootComponent = Sphere;
+	}
+};